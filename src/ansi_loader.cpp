@@ -76,17 +76,111 @@ const ANSILoader::FontListEntry ANSILoader::fontList[] = {
 // MARK: render
 ///////////////////////////////////////////////////////////////////////////////
 
-void* ANSILoader::render(const char* filename, int &width, int &height) {
+// allocation record of the most recently created image; the first colors
+// that libansilove allocates are the 16 palette entries, in palette order
+static thread_local struct AllocRecord {
+    int colors[ANSILoader::numPaletteSlots];
+    int count;
+} allocRecord;
+
+// color table of the most recently output image (count = 0: 32-bit image)
+static thread_local struct ColorTable {
+    int colors[GD_MAX_COLORS];
+    int count;
+} lastColorTable;
+
+//! check whether a set of palette slot colors can be identified unambiguously
+static bool slotsDistinct(const int* slots) {
+    for (int i = 1;  i < ANSILoader::numPaletteSlots;  ++i) {
+        for (int j = 0;  j < i;  ++j) {
+            if (slots[i] == slots[j]) { return false; }
+        }
+    }
+    return true;
+}
+
+//! check whether ANSI data contains colors that are given directly instead
+//! of as a palette slot (PabloDraw's "ESC[...t" 24-bit colors and SGR 38/48
+//! extended colors); these can coincide with a slot's color, so the palette
+//! can't be remapped by matching color values
+static bool hasDirectColors(const char* data, int size) {
+    for (int pos = 0;  (pos + 2) < size;  ++pos) {
+        if ((data[pos] != '\x1b') || (data[pos + 1] != '[')) { continue; }
+        int end = pos + 2;
+        while ((end < size) && (data[end] >= 0x20) && (data[end] < 0x40)) { ++end; }
+        if (end >= size) { break; }
+        if (data[end] == 't') { return true; }
+        if (data[end] == 'm') {
+            // look for a parameter of 38 or 48
+            int value = 0;
+            for (int i = pos + 2;  i <= end;  ++i) {
+                if ((data[i] >= '0') && (data[i] <= '9')) { value = std::min(value * 10 + (data[i] - '0'), 1000); continue; }
+                if ((value == 38) || (value == 48)) { return true; }
+                value = 0;
+            }
+        }
+        pos = end;
+    }
+    return false;
+}
+
+//! check whether two rendering modes only differ in their palettes;
+//! CED mode can't be among them, as it forces a different line width (and
+//! thus layout), and neither can the iCE colors option: it decides whether
+//! a blinking cell's background uses a bright or dark palette slot, and the
+//! same slots are used by foreground pixels, so the indices change too
+static bool isPaletteOnlyMode(ANSILoader::RenderMode mode) {
+    return (mode == ANSILoader::RenderMode::Normal) || (mode == ANSILoader::RenderMode::Workbench);
+}
+
+//! get libansilove's palette for a rendering mode, by rendering a tiny
+//! dummy file and recording the allocated colors
+static const int* getModePalette(ANSILoader::RenderMode mode) {
+    static int  cache[4][ANSILoader::numPaletteSlots];
+    static bool valid[4] = { false, false, false, false };
+    int m = int(mode) & 3;
+    if (!valid[m]) {
+        struct ansilove_ctx     ctx;
+        struct ansilove_options opt;
+        ::memset(static_cast<void*>(&ctx), 0, sizeof(ctx));
+        ::memset(static_cast<void*>(&opt), 0, sizeof(opt));
+        uint8_t dummy[2] = { ' ', 0 };
+        ctx.buffer = dummy;
+        ctx.maplen = ctx.length = 1;
+        opt.truecolor = true;
+        opt.bits      = 8;
+        opt.mode      = static_cast<uint8_t>(mode);
+        allocRecord.count = 0;
+        ansilove_ansi(&ctx, &opt);
+        ::free(static_cast<void*>(ctx.png.buffer));
+        if (allocRecord.count < ANSILoader::numPaletteSlots) { return nullptr; }
+        ::memcpy(cache[m], allocRecord.colors, sizeof(cache[m]));
+        valid[m] = true;
+    }
+    return cache[m];
+}
+
+
+void* ANSILoader::render(const char* filename, int &width, int &height, bool indexed) {
+    int size = 0;
+    char* data = StringUtil::loadTextFile(filename, size);
+    if (!data) {
+        paletteSize = 0;
+        m_canRemap = false;
+        hasSAUCE = false;
+        return nullptr;
+    }
+    return renderData(data, size, StringUtil::extractExtCode(filename), width, height, indexed);
+}
+
+void* ANSILoader::renderData(char* data, int size, uint32_t ext, int &width, int &height, bool indexed) {
     // ansilove context initialization (equivalent to ansilove_init())
     struct ansilove_ctx     ctx;
     struct ansilove_options opt;
     ::memset(static_cast<void*>(&ctx), 0, sizeof(ctx));
     ::memset(static_cast<void*>(&opt), 0, sizeof(opt));
-
-    // load the source file
-    uint32_t ext = StringUtil::extractExtCode(filename);
-    int size = 0;
-    char* data = StringUtil::loadTextFile(filename, size);
+    paletteSize = 0;
+    m_canRemap = false;
     if (!data) { hasSAUCE = false; return nullptr; }
     ctx.buffer = reinterpret_cast<uint8_t*>(data);
     ctx.maplen = ctx.length = static_cast<size_t>(size);
@@ -99,6 +193,7 @@ void* ANSILoader::render(const char* filename, int &width, int &height) {
             if (*pos == 9) { *pos = 32; }
         }
     }
+    bool directColors = hasDirectColors(data, size);
     auto sauceStatus = parseSAUCE(reinterpret_cast<char*>(ctx.buffer), size);
     #ifndef NDEBUG
         printf("SAUCE record status: %s\n", sauceStatus);
@@ -138,17 +233,78 @@ void* ANSILoader::render(const char* filename, int &width, int &height) {
     ::free(static_cast<void*>(ctx.buffer));
     width  =  ctx.png.length        & 0xFFFF;
     height = (ctx.png.length >> 16) & 0xFFFF;
+    void* result = static_cast<void*>(ctx.png.buffer);
+    if (!result || !lastColorTable.count) { return result; }
+
+    // the result is indexed; the palette can only be remapped later if it's
+    // a classic ANSI file (binary formats bring their own palettes) without
+    // directly specified colors, and the palette slots are unambiguous
+    for (int i = 0;  i < lastColorTable.count;  ++i) {
+        palette[i] = static_cast<uint32_t>(lastColorTable.colors[i]);
+    }
+    paletteSize = lastColorTable.count;
+    m_canRemap = !StringUtil::checkExt(ext, &fileExts[binaryExtOffset])
+              && isPaletteOnlyMode(options.mode)
+              && !directColors
+              && (allocRecord.count >= numPaletteSlots)
+              && slotsDistinct(allocRecord.colors);
+    if (m_canRemap) {
+        ::memcpy(m_slots, allocRecord.colors, sizeof(m_slots));
+    }
+    #ifndef NDEBUG
+        printf("ANSI canvas is indexed (%d colors), palette remapping %s\n", paletteSize, m_canRemap ? "possible" : "not possible");
+    #endif
+    if (indexed) { return result; }
+
+    // the caller wants a 32-bit image -> expand the indices
+    const uint8_t* idx = static_cast<const uint8_t*>(result);
+    uint32_t* bgra = static_cast<uint32_t*>(::malloc(size_t(width) * size_t(height) * sizeof(uint32_t)));
+    if (bgra) {
+        for (size_t i = size_t(width) * size_t(height);  i;  --i) {
+            bgra[i - 1u] = palette[idx[i - 1u]];
+        }
+    }
+    ::free(result);
+    paletteSize = 0;
+    return static_cast<void*>(bgra);
+}
 
-    // done!
-    return ctx.png.buffer;
+bool ANSILoader::remapPalette(RenderMode newMode) {
+    if (!m_canRemap || !paletteSize || !isPaletteOnlyMode(newMode)) { return false; }
+    if (newMode == options.mode) { return true; }
+    const int* newSlots = getModePalette(newMode);
+    if (!newSlots || !slotsDistinct(newSlots)) { return false; }
+    for (int i = 0;  i < paletteSize;  ++i) {
+        for (int j = 0;  j < numPaletteSlots;  ++j) {
+            if (static_cast<int>(palette[i]) == m_slots[j]) {
+                palette[i] = static_cast<uint32_t>(newSlots[j]);
+                break;
+            }
+        }
+    }
+    ::memcpy(m_slots, newSlots, sizeof(m_slots));
+    options.mode = newMode;
+    #ifndef NDEBUG
+        printf("ANSI palette remapped for rendering mode %d\n", int(newMode));
+    #endif
+    return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // MARK: UI
 ///////////////////////////////////////////////////////////////////////////////
 
-bool ANSILoader::ui() {
+ANSILoader::UIResult ANSILoader::ui() {
     bool changed = false;
+    bool paletteChanged = false;
+    auto setMode = [&] (RenderMode mode) {
+        if (remapPalette(mode)) {
+            paletteChanged = true;
+        } else {
+            options.mode = mode;
+            changed = true;
+        }
+    };
 
     if (ImGui::Checkbox("interpret tabs as spaces", &options.tabs2spaces)) { changed = true; }
 
@@ -200,11 +356,11 @@ bool ANSILoader::ui() {
 
     ImGui::AlignTextToFramePadding();
     ImGui::TextUnformatted("ANSI rendering mode:");
-    ImGui::SameLine(); if (ImGui::RadioButton("normal",    (options.mode == RenderMode::Normal)))    { options.mode = RenderMode::Normal;    changed = true; }
-    ImGui::SameLine(); if (ImGui::RadioButton("CED",       (options.mode == RenderMode::CED)))       { options.mode = RenderMode::CED;       changed = true; }
-    ImGui::SameLine(); if (ImGui::RadioButton("Workbench", (options.mode == RenderMode::Workbench))) { options.mode = RenderMode::Workbench; changed = true; }
+    ImGui::SameLine(); if (ImGui::RadioButton("normal",    (options.mode == RenderMode::Normal)))    { setMode(RenderMode::Normal); }
+    ImGui::SameLine(); if (ImGui::RadioButton("CED",       (options.mode == RenderMode::CED)))       { setMode(RenderMode::CED); }
+    ImGui::SameLine(); if (ImGui::RadioButton("Workbench", (options.mode == RenderMode::Workbench))) { setMode(RenderMode::Workbench); }
 
-    return changed;
+    return changed ? UIResult::Reload : paletteChanged ? UIResult::Palette : UIResult::None;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -259,7 +415,7 @@ const char* ANSILoader::parseSAUCE(char* data, int size) {
     uint8_t fileType = static_cast<uint8_t>(data[ 95]);
     uint8_t tInfo1   = static_cast<uint8_t>(data[ 96]);
     uint8_t tFlags   = static_cast<uint8_t>(data[105]);
-    data += 106;  // move to TInfoS; guaranteed to be null-terminated because we loaded the entire file with loadTextFile()
+    data += 106;  // move to TInfoS; guaranteed to be null-terminated (see renderData())
     #ifndef NDEBUG
         printf("SAUCE: DataType=%d FileType=%d TInfo1=%d TFlags=0x%02X TInfoS='%s'\n", dataType, fileType, tInfo1, tFlags, data);
     #endif
@@ -374,40 +530,82 @@ extern "C" gdImagePtr gdImageCreateTrueColor(int sx, int sy) {
     sy = std::min(sy, ANSILoader::maxSize);
     gdImagePtr im = static_cast<gdImagePtr>(::malloc(sizeof(gdImage)));
     if (!im) { return nullptr; }
-    im->data = static_cast<int*>(::malloc(sx * sy * sizeof(int)));
-    if (!im->data) {
-        ::free(static_cast<void*>(im->data));
+    im->data = nullptr;
+    im->index = static_cast<unsigned char*>(::malloc(size_t(sx) * size_t(sy)));
+    if (!im->index) {
         ::free(static_cast<void*>(im));
         return nullptr;
     }
     im->sx = sx;
     im->sy = sy;
+    im->numColors = 0;
+    allocRecord.count = 0;
     gdImageFill(im, 0, 0, 0xFF000000);
     return im;
 }
 
 extern "C" void gdImageDestroy(gdImagePtr im) {
     if (!im) { return; }
-    if (im->data) { ::free(static_cast<void*>(im->data)); im->data = nullptr; }
+    if (im->data)  { ::free(static_cast<void*>(im->data));  im->data  = nullptr; }
+    if (im->index) { ::free(static_cast<void*>(im->index)); im->index = nullptr; }
     im->sx = im->sy = 0;
     ::free(static_cast<void*>(im));
 }
 
 extern "C" int gdImageColorAllocate(gdImagePtr im, int r, int g, int b) {
     (void)im;
-    return (r << 16) | (g << 8) | b;
+    int color = (r << 16) | (g << 8) | b;
+    if (allocRecord.count < ANSILoader::numPaletteSlots) {
+        allocRecord.colors[allocRecord.count++] = color;
+    }
+    return color;
 }
 
 extern "C" void gdImageColorTransparent(gdImagePtr im, int color) {
     (void)im, (void)color;
 }
 
+//! convert an indexed image into a 32-bit image
+static bool gdConvertToTrueColor(gdImagePtr im) {
+    size_t n = size_t(im->sx) * size_t(im->sy);
+    im->data = static_cast<int*>(::malloc(n * sizeof(int)));
+    if (!im->data) { return false; }
+    #ifndef NDEBUG
+        printf("more than %d colors, converting ANSI canvas into a 32-bit image\n", GD_MAX_COLORS);
+    #endif
+    for (size_t i = 0;  i < n;  ++i) {
+        im->data[i] = im->colors[im->index[i]];
+    }
+    ::free(static_cast<void*>(im->index));
+    im->index = nullptr;
+    return true;
+}
+
+//! get the color table index for a color, adding it if necessary;
+//! returns -1 if the image is (or has just been converted into) 32-bit
+static int gdColorIndex(gdImagePtr im, int color) {
+    if (!im->index) { return -1; }
+    // drawing alternates between a few colors, so a linear search is fine
+    for (int i = 0;  i < im->numColors;  ++i) {
+        if (im->colors[i] == color) { return i; }
+    }
+    if (im->numColors < GD_MAX_COLORS) {
+        im->colors[im->numColors] = color;
+        return im->numColors++;
+    }
+    gdConvertToTrueColor(im);
+    return -1;
+}
+
 extern "C" void gdImageFill(gdImagePtr im, int x, int y, int nc) {
     (void)x, (void)y;
     if (!im) { return; }
-    int *p = im->data;
-    for (int n = im->sx * im->sy;  n;  --n) {
-        *p++ = nc;
+    size_t n = size_t(im->sx) * size_t(im->sy);
+    int idx = gdColorIndex(im, nc);
+    if (idx >= 0) {
+        ::memset(static_cast<void*>(im->index), idx, n);
+    } else if (im->data) {
+        std::fill(im->data, im->data + n, nc);
     }
 }
 
@@ -415,18 +613,27 @@ extern "C" void gdImageFilledRectangle(gdImagePtr im, int x1, int y1, int x2, in
     if (!im) { return; }
     x2 = std::min(x2 + 1, im->sx);
     y2 = std::min(y2 + 1, im->sy);
-    int *line = &im->data[im->sx * y1];
+    if (x2 <= x1) { return; }
+    int idx = gdColorIndex(im, color);
     for (int y = y1;  y < y2;  ++y) {
-        for (int x = x1;  x < x2;  ++x) {
-            line[x] = color;
+        size_t pos = size_t(im->sx) * size_t(y) + size_t(x1);
+        if (idx >= 0) {
+            ::memset(static_cast<void*>(&im->index[pos]), idx, size_t(x2 - x1));
+        } else if (im->data) {
+            std::fill(&im->data[pos], &im->data[pos + size_t(x2 - x1)], color);
         }
-        line += im->sx;
     }
 }
 
 extern "C" void gdImageSetPixel(gdImagePtr im, int x, int y, int color) {
     if (im && (x >= 0) && (y >= 0) && (x < im->sx) && (y < im->sy)) {
-        im->data[im->sx * y + x] = color;
+        size_t pos = size_t(im->sx) * size_t(y) + size_t(x);
+        int idx = gdColorIndex(im, color);
+        if (idx >= 0) {
+            im->index[pos] = static_cast<unsigned char>(idx);
+        } else if (im->data) {
+            im->data[pos] = color;
+        }
     }
 }
 
@@ -440,11 +647,21 @@ extern "C" void gdImageCopyResampled(gdImagePtr dst, gdImagePtr src, int dstX, i
 
 extern "C" void* gdImagePngPtr(gdImagePtr im, int *size) {
     // don't actually encode a .png here -- we just steal the data pointer
-    // and encode the image dimensions in the size parameter
+    // and encode the image dimensions in the size parameter; the color table
+    // of indexed images is stored away for ANSILoader::render()
     *size = im->sx | (im->sy << 16);
-    auto res = im->data;
-    im->data = nullptr;
-    return static_cast<void*>(res);
+    void* res;
+    if (im->index) {
+        res = static_cast<void*>(im->index);
+        im->index = nullptr;
+        lastColorTable.count = im->numColors;
+        ::memcpy(lastColorTable.colors, im->colors, sizeof(int) * size_t(im->numColors));
+    } else {
+        res = static_cast<void*>(im->data);
+        im->data = nullptr;
+        lastColorTable.count = 0;
+    }
+    return res;
 }
 
 void gdFree(void* ptr) {
@@ -32,6 +32,13 @@ public:  // types
         inline RenderOptions() = default;
     };
 
+    //! result code for ui()
+    enum class UIResult {
+        None = 0,  //!< nothing changed
+        Reload,    //!< options changed, the file needs to be rendered again
+        Palette,   //!< only the palette changed, the indices are still valid
+    };
+
     //! result code for setOption()
     enum class SetOptionResult {
         OK = 0,         //!< everything is fine
@@ -47,12 +54,17 @@ public:  // directly accessible member variables
     //! maximum output size
     static int maxSize;
 
+    //! number of palette entries that can be switched by remapPalette()
+    static constexpr int numPaletteSlots = 16;
+
     //! rendering options
     RenderOptions options;
 
     // metadata about the last rendered file
     double aspect   = 1.0;    //!< expected aspect ratio
     bool   hasSAUCE = false;  //!< SAUCE configuration information is available
+    int    paletteSize = 0;   //!< number of palette entries if the result is indexed (0 = 32-bit)
+    uint32_t palette[256];    //!< palette of an indexed result (BGRA byte order)
 
 public:  // type and font registry
 
@@ -76,11 +88,25 @@ public:  // methods
     //! reset options to defaults
     inline void loadDefaults() { options = defaults; }
 
-    //! render an ANSI file into a 32-bit image
-    void* render(const char* filename, int &width, int &height);
+    //! render an ANSI file into a 32-bit BGRA image or, if `indexed` is set
+    //! and the result has no more than 256 colors, an 8-bit indexed image
+    //! (check paletteSize to find out which one it is)
+    void* render(const char* filename, int &width, int &height, bool indexed=false);
 
-    //! run the UI for the ANSI options; return true if reloading is required
-    bool ui();
+    //! render ANSI data that's already in memory, like render()
+    //! \param data  malloc'd buffer with a null terminator after `size` bytes;
+    //!              ownership is transferred to the renderer
+    //! \param ext   extension code of the file type (see string_util.h)
+    void* renderData(char* data, int size, uint32_t ext, int &width, int &height, bool indexed=false);
+
+    //! change the rendering mode by only modifying the palette of the last
+    //! indexed result; returns false if the image needs to be rendered again
+    //! (because the mode changes more than just colors, or the palette
+    //! assignment is ambiguous)
+    bool remapPalette(RenderMode newMode);
+
+    //! run the UI for the ANSI options
+    UIResult ui();
 
     //! save configuration into a config file
     void saveConfig(FILE* f);
@@ -89,5 +115,8 @@ public:  // methods
     SetOptionResult setOption(const char* name, int value);
 
 private:
+    int  m_slots[numPaletteSlots];  //!< palette slot colors of the last result
+    bool m_canRemap = false;        //!< the last result supports remapPalette()
+
     const char* parseSAUCE(char* data, int size);
 };
@@ -0,0 +1,398 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+
+#include "string_util.h"
+
+#include "ansi_stream.h"
+
+// number of bytes to read at once
+static constexpr size_t readChunkSize = 65536;
+
+// maximum amount of data in the scrollback; streams without newlines
+// can't be cut, so reading stops when they grow beyond that size
+static constexpr size_t maxStreamSize = size_t(64) << 20;
+
+// maximum number of text rows in the scrollback; it's trimmed only when
+// it has grown by another quarter of that, so most renders just append
+// rows at the bottom, and only those need to be uploaded
+static constexpr int maxScrollback = 1000;
+
+// height of the tallest font in pixels; the scrollback is further limited
+// so that it fits into a texture
+static constexpr int maxFontHeight = 16;
+
+// time to wait for new data before checking for cancellation, in milliseconds
+static constexpr int pollTimeout = 50;
+
+// minimum time between two renders; the actual interval is extended to twice
+// the duration of the previous render, so long streams can't monopolize the
+// CPU and new data shows up with a latency proportional to the render time
+static constexpr std::chrono::milliseconds minRenderInterval(100);
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: input
+///////////////////////////////////////////////////////////////////////////////
+
+bool ANSIStream::isStream(const char* path) {
+    if (!path) { return false; }
+    if (!strcmp(path, "-")) { return true; }
+    #ifdef _WIN32
+        return false;
+    #else
+        struct stat st;
+        return !stat(path, &st) && S_ISFIFO(st.st_mode);
+    #endif
+}
+
+namespace {
+
+//! platform-specific non-blocking stream reader
+class StreamReader {
+public:
+    //! open standard input or a named pipe
+    bool open(const char* path);
+    void close();
+    //! read some data, waiting at most pollTimeout milliseconds for it
+    //! \returns the number of bytes read, 0 if there's no data yet,
+    //!          or a negative value at the end of the stream
+    int read(char* buffer, size_t size);
+    inline ~StreamReader() { close(); }
+
+private:
+    #ifdef _WIN32
+        HANDLE m_handle = INVALID_HANDLE_VALUE;
+    #else
+        int  m_fd = -1;
+        bool m_isFIFO = false;  //!< named pipe: writers may come and go
+    #endif
+};
+
+#ifdef _WIN32
+
+bool StreamReader::open(const char* path) {
+    // named pipes don't live in the file system on Windows, so only standard
+    // input is supported; it must not be a console, though, as reading from
+    // it would block indefinitely
+    if (strcmp(path, "-")) { return false; }
+    m_handle = GetStdHandle(STD_INPUT_HANDLE);
+    return (m_handle != INVALID_HANDLE_VALUE) && (GetFileType(m_handle) != FILE_TYPE_CHAR);
+}
+
+void StreamReader::close() {
+    m_handle = INVALID_HANDLE_VALUE;  // standard input is never closed
+}
+
+int StreamReader::read(char* buffer, size_t size) {
+    DWORD avail = 0;
+    if (PeekNamedPipe(m_handle, nullptr, 0, nullptr, &avail, nullptr)) {
+        if (!avail) { Sleep(DWORD(pollTimeout)); return 0; }
+        size = std::min(size, size_t(avail));
+    } else if (GetLastError() == ERROR_BROKEN_PIPE) {
+        return -1;
+    }   // otherwise, it's not a pipe, but a file, and reading won't block for long
+    DWORD n = 0;
+    if (!ReadFile(m_handle, static_cast<void*>(buffer), DWORD(size), &n, nullptr) || !n) { return -1; }
+    return int(n);
+}
+
+#else  // POSIX
+
+bool StreamReader::open(const char* path) {
+    if (!strcmp(path, "-")) {
+        m_fd = 0;
+        return true;
+    }
+    // open non-blocking, as a blocking open() would wait for the first writer
+    m_fd = ::open(path, O_RDONLY | O_NONBLOCK);
+    m_isFIFO = true;
+    return (m_fd >= 0);
+}
+
+void StreamReader::close() {
+    if (m_fd > 0) { ::close(m_fd); }
+    m_fd = -1;
+}
+
+int StreamReader::read(char* buffer, size_t size) {
+    struct pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, pollTimeout) <= 0) { return 0; }
+    ssize_t n = ::read(m_fd, static_cast<void*>(buffer), size);
+    if (n > 0) { return int(n); }
+    if (!n && m_isFIFO) {
+        // no writer connected to the named pipe (yet, or anymore);
+        // poll() returns immediately in this state, so wait a bit
+        usleep(pollTimeout * 1000);
+        return 0;
+    }
+    if ((n < 0) && ((errno == EAGAIN) || (errno == EINTR))) { return 0; }
+    return -1;
+}
+
+#endif
+
+}  // anonymous namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: control
+///////////////////////////////////////////////////////////////////////////////
+
+bool ANSIStream::start(const char* path, const ANSILoader::RenderOptions& options) {
+    stop();
+    if (!path) { return false; }
+    m_path = path;
+    m_options = options;
+    m_optionsChanged = false;
+    m_cancel = false;
+    m_thread = std::thread([this] { worker(); });
+    #ifndef NDEBUG
+        printf("ANSI stream: started reading '%s'\n", path);
+    #endif
+    return true;
+}
+
+void ANSIStream::setOptions(const ANSILoader::RenderOptions& options) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_options = options;
+        m_optionsChanged = true;
+    }
+    m_cv.notify_all();
+}
+
+void ANSIStream::stop() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cancel = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+    ::free(m_pending.data);
+    m_pending = Canvas();
+    m_data.clear();
+    m_base = 0;
+    m_rows = 0;
+    m_baseAttr = Attributes();
+    m_prev.clear();
+    m_prevWidth = m_prevHeight = 0;
+}
+
+bool ANSIStream::fetch(Canvas& canvas) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_pending.data) { return false; }
+    canvas = m_pending;
+    m_pending = Canvas();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: worker
+///////////////////////////////////////////////////////////////////////////////
+
+void ANSIStream::worker() {
+    typedef std::chrono::steady_clock clock;
+    StreamReader reader;
+    bool eof = !reader.open(m_path.c_str());
+    #ifndef NDEBUG
+        if (eof) { printf("ANSI stream: failed to open '%s'\n", m_path.c_str()); }
+    #endif
+    ANSILoader::RenderOptions options;
+    bool dirty = false;  // data or options changed since the last render
+    clock::time_point nextRender = clock::now();
+    std::vector<char> buffer(readChunkSize);
+
+    while (!m_cancel) {
+        // read new data
+        if (!eof) {
+            int n = reader.read(buffer.data(), buffer.size());
+            if (n > 0) {
+                append(buffer.data(), size_t(n));
+                dirty = true;
+            }
+            if ((n < 0) || ((m_data.size() - m_base) >= maxStreamSize)) {
+                #ifndef NDEBUG
+                    printf("ANSI stream: %s after %d bytes\n", (n < 0) ? "end of stream" : "size limit reached", int(m_data.size() - m_base));
+                #endif
+                reader.close();
+                eof = true;
+            }
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (eof && !dirty) {
+                // nothing more to read: sleep until the options change
+                m_cv.wait(lock, [this] { return m_cancel || m_optionsChanged; });
+            }
+            if (m_optionsChanged) {
+                m_optionsChanged = false;
+                dirty = true;
+            }
+            options = m_options;
+        }
+
+        // render, unless the previous render was too recent
+        clock::time_point now = clock::now();
+        if (!m_cancel && dirty && (m_data.size() > m_base) && (eof || (now >= nextRender))) {
+            render(options);
+            clock::time_point end = clock::now();
+            nextRender = end + std::max(std::chrono::duration_cast<clock::duration>(minRenderInterval), 2 * (end - now));
+            dirty = false;
+        } else if (m_data.size() <= m_base) {
+            dirty = false;
+        }
+    }
+}
+
+void ANSIStream::append(const char* data, size_t size) {
+    m_data.insert(m_data.end(), data, &data[size]);
+    m_rows += int(std::count(data, &data[size], '\n'));
+    int maxRows = std::max(1, std::min(maxScrollback, ANSILoader::maxSize / maxFontHeight));
+    if (m_rows <= (maxRows + maxRows / 4)) { return; }
+
+    // trim the scrollback: skip the oldest rows, but keep track of the
+    // character attributes in them, as they're still in effect afterwards
+    size_t pos = m_base;
+    const char* d = m_data.data();
+    while (m_rows > maxRows) {
+        if (d[pos] == '\n') {
+            --m_rows;
+        } else if ((d[pos] == '\x1b') && ((pos + 1u) < m_data.size()) && (d[pos + 1u] == '[')) {
+            size_t end = pos + 2u;
+            while ((end < m_data.size()) && (d[end] >= 0x20) && (d[end] < 0x40)) { ++end; }
+            if ((end < m_data.size()) && (d[end] == 'm')) { m_baseAttr.parse(&d[pos + 2u], end - pos - 2u); }
+            // skip the sequence, but not a character that cut it short
+            pos = ((end < m_data.size()) && (d[end] >= 0x40) && (d[end] < 0x7F)) ? end : (end - 1u);
+        }
+        ++pos;
+    }
+    m_base = pos;
+
+    // drop the skipped data once it makes up most of the buffer
+    if (m_base > (m_data.size() / 2u)) {
+        m_data.erase(m_data.begin(), m_data.begin() + ptrdiff_t(m_base));
+        m_base = 0;
+    }
+    #ifndef NDEBUG
+        printf("ANSI stream: scrollback trimmed to %d rows, %d bytes\n", m_rows, int(m_data.size() - m_base));
+    #endif
+}
+
+void ANSIStream::Attributes::parse(const char* params, size_t len) {
+    // split the parameters; empty ones count as zero
+    std::vector<int> p(1, 0);
+    for (size_t i = 0;  i < len;  ++i) {
+        if (params[i] == ';') { p.push_back(0); }
+        else if ((params[i] >= '0') && (params[i] <= '9')) { p.back() = p.back() * 10 + (params[i] - '0'); }
+        else { return; }  // private or unknown sequence
+    }
+    for (size_t i = 0;  i < p.size();  ++i) {
+        int v = p[i];
+        if (!v) { *this = Attributes(); }
+        else if (v == 1)  { bold = true; }
+        else if (v == 22) { bold = false; }
+        else if ((v == 5) || (v == 6)) { blink = true; }
+        else if (v == 25) { blink = false; }
+        else if (v == 7)  { invert = true; }
+        else if (v == 27) { invert = false; }
+        else if (v == 39) { fg.clear(); }
+        else if (v == 49) { bg.clear(); }
+        else if (((v >= 30) && (v <= 37)) || ((v >= 90) && (v <= 97)))  { fg = std::to_string(v); }
+        else if (((v >= 40) && (v <= 47)) || ((v >= 100) && (v <= 107))) { bg = std::to_string(v); }
+        else if (((v == 38) || (v == 48)) && ((i + 1u) < p.size())) {
+            // extended color: 38;5;INDEX or 38;2;R;G;B
+            size_t n = (p[i + 1u] == 5) ? 2u : (p[i + 1u] == 2) ? 4u : 1u;
+            std::string& color = (v == 38) ? fg : bg;
+            color = std::to_string(v);
+            for (size_t j = 1;  (j <= n) && ((i + j) < p.size());  ++j) {
+                color += ";" + std::to_string(p[i + j]);
+            }
+            i += n;
+        }
+    }
+}
+
+std::string ANSIStream::Attributes::sequence() const {
+    std::string s("\x1b[0");
+    if (bold)   { s += ";1"; }
+    if (blink)  { s += ";5"; }
+    if (invert) { s += ";7"; }
+    if (!fg.empty()) { s += ";" + fg; }
+    if (!bg.empty()) { s += ";" + bg; }
+    return s + "m";
+}
+
+bool ANSIStream::render(const ANSILoader::RenderOptions& options) {
+    // the renderer consumes a null-terminated copy of the scrollback,
+    // prefixed with the attributes that were in effect at its start
+    std::string prefix = m_baseAttr.sequence();
+    size_t size = prefix.size() + m_data.size() - m_base;
+    char* data = static_cast<char*>(::malloc(size + 1u));
+    if (!data) { return false; }
+    ::memcpy(static_cast<void*>(data), static_cast<const void*>(prefix.data()), prefix.size());
+    ::memcpy(static_cast<void*>(&data[prefix.size()]), static_cast<const void*>(&m_data[m_base]), m_data.size() - m_base);
+    data[size] = '\0';
+    ANSILoader loader;
+    loader.options = options;
+    int width = 0, height = 0;
+    uint8_t* img = static_cast<uint8_t*>(loader.renderData(data, int(size), StringUtil::makeExtCode("ans"), width, height));
+    if (!img) { return false; }
+
+    // find the first row that differs from the previous render; usually,
+    // new data only appends to (or modifies) the bottom of the canvas
+    size_t pitch = size_t(width) * 4u;
+    int firstChanged = 0;
+    if (width == m_prevWidth) {
+        int common = std::min(height, m_prevHeight);
+        while ((firstChanged < common) && !memcmp(&img[size_t(firstChanged) * pitch], &m_prev[size_t(firstChanged) * pitch], pitch)) {
+            ++firstChanged;
+        }
+        if ((firstChanged == height) && (height == m_prevHeight)) {
+            ::free(static_cast<void*>(img));
+            return true;  // nothing visible changed
+        }
+    }
+    m_prev.assign(img, &img[pitch * size_t(height)]);
+    m_prevWidth  = width;
+    m_prevHeight = height;
+    #ifndef NDEBUG
+        printf("ANSI stream: rendered %d bytes into %dx%d pixels, changes start at row %d\n", int(size), width, height, firstChanged);
+    #endif
+
+    // publish the new canvas; if the previous one hasn't been picked up yet,
+    // its changes need to be included in this one's
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending.data) {
+        if (m_pending.width != width) { firstChanged = 0; }
+        firstChanged = std::min(firstChanged, m_pending.firstChangedRow);
+        ::free(m_pending.data);
+    }
+    m_pending.data   = static_cast<void*>(img);
+    m_pending.width  = width;
+    m_pending.height = height;
+    m_pending.firstChangedRow = firstChanged;
+    m_pending.aspect = loader.aspect;
+    return true;
+}
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ansi_loader.h"
+
+//! progressive renderer for ANSI data that arrives over time, from standard
+//! input ("-") or a named pipe; the data is read and rendered in a background
+//! thread, and the main thread picks up the most recent canvas with fetch().
+//! Only a limited number of the most recent text rows (the scrollback) is
+//! kept and rendered, so the render time doesn't grow with the stream length.
+class ANSIStream {
+public:
+    //! one rendered canvas, as returned by fetch()
+    struct Canvas {
+        void*  data   = nullptr;  //!< BGRA pixels (malloc'd; the caller needs to free() them)
+        int    width  = 0;        //!< canvas width in pixels
+        int    height = 0;        //!< canvas height in pixels
+        int    firstChangedRow = 0;  //!< rows above this one are the same as in the previously fetched canvas
+        double aspect = 1.0;      //!< recommended aspect ratio
+    };
+
+    //! check whether a path refers to a stream instead of a regular file
+    static bool isStream(const char* path);
+
+    inline ANSIStream() : m_cancel(false) {}
+    inline ~ANSIStream() { stop(); }
+
+    //! start reading and rendering a stream
+    bool start(const char* path, const ANSILoader::RenderOptions& options);
+
+    //! render the stream again with other options
+    void setOptions(const ANSILoader::RenderOptions& options);
+
+    //! stop reading and discard the received data
+    void stop();
+
+    inline bool active() const { return m_thread.joinable(); }
+    inline const char* path() const { return m_path.c_str(); }
+
+    //! get the most recently rendered canvas, if it changed since the last call
+    bool fetch(Canvas& canvas);
+
+private:
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<bool> m_cancel;
+    std::string m_path;
+    // protected by m_mutex:
+    ANSILoader::RenderOptions m_options;
+    bool   m_optionsChanged = false;
+    Canvas m_pending;               //!< canvas that hasn't been fetched yet
+    //! character attributes set by SGR ("ESC[...m") sequences
+    struct Attributes {
+        bool bold = false, blink = false, invert = false;
+        std::string fg, bg;  //!< SGR parameters of the colors (empty = default)
+        void parse(const char* params, size_t len);
+        std::string sequence() const;  //!< SGR sequence that restores these attributes
+    };
+    // owned by the worker thread:
+    std::vector<char> m_data;       //!< data received so far, starting with the scrollback
+    size_t m_base = 0;              //!< start of the scrollback in m_data (always after a newline)
+    int    m_rows = 0;              //!< number of newlines after m_base
+    Attributes m_baseAttr;          //!< character attributes in effect at m_base
+    std::vector<uint8_t> m_prev;    //!< the previously rendered canvas
+    int m_prevWidth = 0, m_prevHeight = 0;
+
+    void worker();
+    void append(const char* data, size_t size);
+    bool render(const ANSILoader::RenderOptions& options);
+};
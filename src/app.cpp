@@ -12,6 +12,7 @@
 #endif
 
 #include <cstdint>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -19,6 +20,7 @@
 #include <cassert>
 
 #include <algorithm>
+#include <utility>
 
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
@@ -38,6 +40,9 @@
 #include "file_util.h"
 
 #include "ansi_loader.h"
+#include "exif_util.h"
+#include "tex_compress.h"
+#include "tile_export.h"
 #include "version.h"
 
 #include "app.h"
@@ -45,20 +50,35 @@
 #ifndef NDEBUG  // secondary debug switch for very verbose debug sources
     //#define DEBUG_UPDATE_VIEW
     //#define DEBUG_ANIMATION
+    //#define DEBUG_FRAME_TIMING
 #endif
 
 static constexpr int    defaultWindowWidth   = 1024;
 static constexpr int    defaultWindowHeight  =  768;
 static constexpr double zoomStepSize         =    1.4142135623730951;  // sqrt(2)
-static constexpr double animationSpeed       =    0.125;
+static constexpr double animationSpeed       =    0.125;  // per frame at the reference frame rate
+static constexpr double referenceFrameRate   =   60.0;  // frame rate that animation and scroll speeds are specified for
+static constexpr double maxFrameInterval     =    0.25; // longer frames are considered stalls and don't affect timing
+static constexpr double frameTimeSmoothing   =    0.05; // smoothing factor for the measured frame interval
+static constexpr double refreshSnapTolerance =    0.1;  // relative tolerance for snapping to the nominal refresh rate
+static constexpr double lateFrameThreshold   =    1.5;  // frames longer than this (relative to average) are "late"
+static constexpr double statsInterval        =    1.0;  // update interval for the timing statistics (seconds)
+static constexpr GLuint64 fenceTimeout       = 100000000;  // maximum time to wait for the GPU in low-latency mode (ns)
 static constexpr double cursorPanSpeedSlow   =    8.0;  // pixels per keypress (with Shift)
 static constexpr double cursorPanSpeedNormal =   64.0;  // pixels per keypress
 static constexpr double cursorPanSpeedFast   =  512.0;  // pixels per keypress (with Ctrl)
 static constexpr double cursorHideDelay      =    0.5;  // mouse cursor hide delay (seconds)
+static constexpr double areaFilterDelay      =    0.25; // time the view must be static before area filtering kicks in (seconds)
+static constexpr size_t minCompressPixels    = size_t(1) << 20;  // smaller images are never DXT1-compressed
+static constexpr size_t minPreviewPixels     = size_t(8) << 20;  // smaller images are decoded synchronously, without a preview
 
 static const double presetScrollSpeeds[] = { 1.0, 2.0, 3.0, 4.0, 6.0, 8.0, 12.0, 16.0, 24.0 };
 static constexpr int numPresetScrollSpeeds = int(sizeof(presetScrollSpeeds) / sizeof(*presetScrollSpeeds));
 
+// conversion table from EXIF orientation codes to orientation bit masks
+// (orFlipX = 1, orFlipY = 2, orTranspose = 4)
+static const int exifToOrient[9] = { 0, 0, 1, 3, 2, 4, 6, 7, 5 };
+
 static const uint32_t imageFileExts[] = {
     // file extensions for formats that are supported by stb_image
     StringUtil::makeExtCode("jpg"),
@@ -75,6 +95,18 @@ static const uint32_t imageFileExts[] = {
     0
 };
 
+// only regular image files can be followed, as they're decoded in a background thread
+static bool isFollowFileName(const char* name) {
+    return StringUtil::checkExt(name, imageFileExts);
+}
+
+static bool isImageFileName(const char* name) {
+    uint32_t ext = StringUtil::extractExtCode(name);
+    return StringUtil::checkExt(ext, imageFileExts)
+        || StringUtil::checkExt(ext, ANSILoader::fileExts)
+        || StringUtil::checkExt(ext, TermPlayer::fileExts);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // MARK: main
 ///////////////////////////////////////////////////////////////////////////////
@@ -83,6 +115,11 @@ int PixelViewApp::run(int argc, char *argv[]) {
     int windowWidth  = defaultWindowWidth;
     int windowHeight = defaultWindowHeight;
     int autoFullscreen = true;
+    const char* exportPath = nullptr;
+    const char* benchResolutions = nullptr;
+    bool exportJPEG = false;
+    bool follow = false;
+    double flipbookFPS = 0.0;
     char opt = 0;
     for (int argp = 1;  argp < argc;  ++argp) {
         const char* arg = argv[argp];
@@ -101,18 +138,51 @@ int PixelViewApp::run(int argc, char *argv[]) {
                     }
                 #endif
                 break; }
+            case 'x': opt = 1;
+                exportPath = arg;
+                break;
+            case 'p': opt = 1;
+                flipbookFPS = ::strtod(arg, nullptr);
+                break;
+            case 'b': opt = 1;
+                benchResolutions = arg;
+                break;
             default:
                 break;
         }
         switch (opt) {
             case 'h':
-                printf("Usage: pixelview [-f] [-w WxH] [INPUT]\n");
+                printf("Usage: pixelview [-f] [-w WxH] [-a] [-t] [-r] [-F] [-c] [-p FPS] [INPUT [COMPARE]]\n"
+                       "       pixelview -x OUTPUT [-j] INPUT\n"
+                       "       pixelview -b RES[,RES...] INPUT\n");
                 return 0;
                 break;
             case 'f':
                 m_fullscreen = true;
                 autoFullscreen = false;
                 break;
+            case 'a':
+                m_adaptiveVsync = true;
+                break;
+            case 't':
+                m_printStats = true;
+                break;
+            case 'r':
+                m_recursive = true;
+                break;
+            case 'F':
+                follow = true;
+                break;
+            case 'c':
+                m_compress = true;
+                break;
+            case 'j':
+                exportJPEG = true;
+                break;
+            case 'x':
+            case 'p':
+            case 'b':
+                break;  // argument is parsed in the next iteration
             case 'w':
                 m_fullscreen = false;
                 autoFullscreen = false;
@@ -120,20 +190,28 @@ int PixelViewApp::run(int argc, char *argv[]) {
             case 1:
                 break;  // already parsed, ignore
             default:
-                if (arg[0] == '-') {
+                if ((arg[0] == '-') && arg[1]) {
                     #ifndef NDEBUG
                         printf("command line error: unrecognized option '%s'\n", arg);
                     #endif
                 } else if (!m_fileName) {
                     m_fileName = StringUtil::copy(arg, 4);
+                } else if (!m_cmpFileName) {
+                    m_cmpFileName = StringUtil::copy(arg);
                 } else {
                     #ifndef NDEBUG
-                        printf("command line error: more than one filename specified\n");
+                        printf("command line error: more than two filenames specified\n");
                     #endif
                 }
                 break;
         }
     }
+    if (exportPath) {
+        return runExport(exportPath, exportJPEG);
+    }
+    if (benchResolutions) {
+        return runBenchmark(benchResolutions);
+    }
     if (autoFullscreen && m_fileName) {
         #ifdef NDEBUG
             m_fullscreen = true;
@@ -149,6 +227,7 @@ int PixelViewApp::run(int argc, char *argv[]) {
 
     GLFWmonitor* monitor = glfwGetPrimaryMonitor();
     const GLFWvidmode* mode = glfwGetVideoMode(monitor);
+    updateRefreshRate(mode);
     glfwWindowHint(GLFW_REFRESH_RATE, mode->refreshRate);
     glfwWindowHint(GLFW_RED_BITS,     mode->redBits);
     glfwWindowHint(GLFW_GREEN_BITS,   mode->greenBits);
@@ -202,88 +281,11 @@ int PixelViewApp::run(int argc, char *argv[]) {
         { static_cast<PixelViewApp*>(glfwGetWindowUserPointer(window))->handleDropEvent(path_count, paths); });
 
     glfwMakeContextCurrent(m_window);
-    glfwSwapInterval(1);
-
-    #ifdef GL_HEADER_IS_GLAD
-        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-            fprintf(stderr, "failed to load OpenGL 3.3 functions\n");
-            return 1;
-        }
-    #else
-        #error no valid GL header / loader
-    #endif
-
-    if (!GLutil::init()) {
-        fprintf(stderr, "OpenGL initialization failed\n");
-        return 1;
-    }
-    GLutil::enableDebugMessages();
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    int maxTexSize = 0;
-    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
-    ANSILoader::restrictMaximumSize(maxTexSize);
-
-    ImGui::CreateContext();
-    m_io = &ImGui::GetIO();
-    m_io->IniFilename = nullptr;
-    ImGui_ImplGlfw_InitForOpenGL(m_window, true);
-    ImGui_ImplOpenGL3_Init(nullptr);
+    m_canAdaptiveVsync = glfwExtensionSupported("WGL_EXT_swap_control_tear")
+                      || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+    updateSwapInterval();
 
-    glGenTextures(1, &m_tex);
-    glBindTexture(GL_TEXTURE_2D, m_tex);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glBindTexture(GL_TEXTURE_2D, 0);
-    GLutil::checkError("texture setup");
-
-    {
-        GLutil::Shader vs(GL_VERTEX_SHADER,
-             "#version 330 core"
-        "\n" "uniform vec4 uArea;"
-        "\n" "out vec2 vPos;"
-        "\n" "void main() {"
-        "\n" "  vec2 pos = vec2(float(gl_VertexID & 1), float((gl_VertexID & 2) >> 1));"
-        "\n" "  vPos = pos;"
-        "\n" "  gl_Position = vec4(uArea.xy * pos + uArea.zw, 0., 1.);"
-        "\n" "}"
-        "\n");
-        if (!vs.good()) {
-            fprintf(stderr, "vertex shader compilation failed\n");
-            return 1;
-        }
-        GLutil::Shader fs(GL_FRAGMENT_SHADER,
-             "#version 330 core"
-        "\n" "uniform vec2 uSize;"
-        "\n" "uniform sampler2D uTex;"
-        "\n" "in vec2 vPos;"
-        "\n" "out vec4 oColor;"
-        "\n" "float mapPos(in float pos, in float deriv) {"
-        "\n" "  float d = abs(deriv);"
-        "\n" "  if (d >= 1.03125) { return pos; }"
-        "\n" "  float i = floor(pos + 0.5);"
-        "\n" "  return i + clamp((pos - i) / d, -0.5, 0.5);"
-        "\n" "}"
-        "\n" "void main() {"
-        "\n" "  vec2 rpos = vPos * uSize;"
-        "\n" "  vec2 mpos = vec2(mapPos(rpos.x, dFdx(rpos).x),"
-        "\n" "                   mapPos(rpos.y, dFdy(rpos).y));"
-        "\n" "  oColor = texture(uTex, mpos / uSize, -0.25);"
-        "\n" "}"
-        "\n");
-        if (!fs.good()) {
-            fprintf(stderr, "fragment shader compilation failed\n");
-            return 1;
-        }
-        m_prog.link(vs, fs);
-        if (!m_prog.good()) {
-            fprintf(stderr, "program linking failed\n");
-            return 1;
-        }
-        m_locArea = glGetUniformLocation(m_prog, "uArea");
-        m_locSize = glGetUniformLocation(m_prog, "uSize");
-    }
+    if (!initRendering()) { return 1; }
 
     // set a default window geometry when switching back from fullscreen
     m_windowGeometry.width  = defaultWindowWidth;
@@ -294,22 +296,64 @@ int PixelViewApp::run(int argc, char *argv[]) {
     // initialize screen geometry and load document
     updateScreenSize();
     updateCursor();
+    if (follow && m_fileName) {
+        // follow mode: watch the input directory, or the directory containing
+        // the input file; in the former case, the newest file is shown first
+        FileUtil::Directory dir(m_fileName);
+        if (dir.good()) {
+            dir.close();
+            m_follower.start(m_fileName, isFollowFileName, true);
+            ::free((void*)m_fileName);
+            m_fileName = nullptr;
+        } else {
+            char* dirName = StringUtil::pathDirName(m_fileName);
+            m_follower.start(dirName, isFollowFileName, false);
+            ::free(dirName);
+        }
+    }
+    if (m_recursive && m_fileName) {
+        // recursive mode: the input may be the root directory itself,
+        // otherwise the tree below the input file's directory is used
+        FileUtil::Directory dir(m_fileName);
+        if (dir.good()) {
+            dir.close();
+            m_treeWalker.start(m_fileName, isImageFileName);
+            ::free((void*)m_fileName);
+            m_fileName = nullptr;
+            // the first file is loaded by updateTreeNav() as soon as the
+            // scanner has found it
+            m_treeNavAbsolute = true;
+            m_treeNavOrder = -1;
+            m_treeNavFrom.clear();
+        } else {
+            char* root = StringUtil::pathDirName(m_fileName);
+            m_treeWalker.start(root, isImageFileName);
+            ::free(root);
+        }
+    }
     if (m_fileName) {
         loadImage();
     }
+    if (m_cmpFileName) {
+        loadCompareImage(m_cmpFileName);
+    }
+    if ((flipbookFPS > 0.0) && m_fileName) {
+        m_flipbook.fps = std::max(1.0, std::min(flipbookFPS, 240.0));
+        startFlipbook();
+    }
 
     // main loop
     while (m_active && !glfwWindowShouldClose(m_window)) {
+        double frameStart = glfwGetTime();
         glfwPollEvents();
+        updateStream();
+        updateFollower();
+        updateLoader();
+        updateTreeNav();
         double now = glfwGetTime();
-        #if 0  // DEBUG timing issues
-            static double prev = 0.0;
-            double dt = now - prev;
-            prev = now;
-            if (fabs(dt - 1./60) > 0.003f) {
-                printf("timing glitch: frame took %.3f ms\n", dt * 1000.0);
-            }
-        #endif
+        updatePlayer(now);
+        updateFlipbook(now);
+        updateSprite(now);
 
         // hide the cursor
         if ((m_hideCursorAt > 0.0) && (now > m_hideCursorAt) && !m_panning) {
@@ -317,32 +361,65 @@ int PixelViewApp::run(int argc, char *argv[]) {
             m_hideCursorAt = 0.0;
         }
 
-        // process the UI
-        if (!m_cursorVisible) {
-            ImGui::SetMouseCursor(ImGuiMouseCursor_None);
+        // process the UI; if there's nothing to show (which is the common
+        // case in fullscreen mode), bypass ImGui completely, as even building
+        // and rendering an empty frame costs a noticeable amount of CPU time
+        bool useImGui = needImGui();
+        if (useImGui != m_imguiActive) {
+            setImGuiActive(useImGui);
+        }
+        if (useImGui) {
+            if (!m_cursorVisible) {
+                ImGui::SetMouseCursor(ImGuiMouseCursor_None);
+            }
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+            if (m_showHelp)   { uiHelpWindow(); }
+            if (m_showConfig) { uiConfigWindow(); }
+            if (m_statusType) { uiStatusWindow(); }
+            if (m_showInfo)   { uiInfoWindow(); }
+            if (m_showTiming) { uiTimingWindow(); }
+            if (m_showMinimap) { uiMinimap(); }
+            #ifndef NDEBUG
+                if (m_showDemo) { ImGui::ShowDemoWindow(&m_showDemo); }
+            #endif
+            ImGui::Render();
+        } else {
+            // without ImGui, we need to manage cursor visibility ourselves
+            int cursorMode = m_cursorVisible ? GLFW_CURSOR_NORMAL : GLFW_CURSOR_HIDDEN;
+            if (cursorMode != m_cursorMode) {
+                glfwSetInputMode(m_window, GLFW_CURSOR, cursorMode);
+                m_cursorMode = cursorMode;
+            }
         }
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-        if (m_showHelp)   { uiHelpWindow(); }
-        if (m_showConfig) { uiConfigWindow(); }
-        if (m_statusType) { uiStatusWindow(); }
-        if (m_showInfo)   { uiInfoWindow(); }
-        #ifndef NDEBUG
-            if (m_showDemo) { ImGui::ShowDemoWindow(&m_showDemo); }
-        #endif
-        ImGui::Render();
 
         // start display rendering
         GLutil::clearError();
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glViewport(0, 0, int(m_io->DisplaySize.x), int(m_io->DisplaySize.y));
+        glViewport(0, 0, int(m_screenWidth), int(m_screenHeight));
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // auto-scroll
+        // in low-latency mode, get the most recent mouse position for panning
+        // as late as possible, i.e. right before drawing
+        if (m_lowLatency && m_panning) {
+            double x = 0.0, y = 0.0;
+            glfwGetCursorPos(m_window, &x, &y);
+            updatePan(x, y);
+        }
+
+        // auto-scroll; the scroll speed is specified in pixels per frame at
+        // the reference frame rate, and the fractional part of the resulting
+        // per-frame step is accumulated, so we always move by whole pixels
         if (isScrolling()) {
-            m_x0 -= m_scrollX * m_scrollSpeed;
-            m_y0 -= m_scrollY * m_scrollSpeed;
+            double step = m_scrollSpeed * m_frameDelta * referenceFrameRate;
+            double istep = std::floor(step + 0.5);
+            if (std::fabs(step - istep) < 0.001) { step = istep; }
+            m_scrollAccum += step;
+            double move = std::floor(m_scrollAccum);
+            m_scrollAccum -= move;
+            m_x0 -= m_scrollX * move;
+            m_y0 -= m_scrollY * move;
             if ((m_x0 > 0.0) || (m_x0 < m_minX0)) { m_scrollX = 0.0; }
             if ((m_y0 > 0.0) || (m_y0 < m_minY0)) { m_scrollY = 0.0; }
             updateView();
@@ -351,9 +428,10 @@ int PixelViewApp::run(int argc, char *argv[]) {
         // apply smooth transitions
         if (m_animate) {
             double sad = 0.0;
+            double speed = 1.0 - std::pow(1.0 - animationSpeed, m_frameDelta * referenceFrameRate);
             for (int i = 0;  i < 4;  ++i) {
                 double diff = m_targetArea.m[i] - m_currentArea.m[i];
-                m_currentArea.m[i] += animationSpeed * diff;
+                m_currentArea.m[i] += speed * diff;
                 sad += std::fabs(diff);
             }
             if (sad < (std::min(m_targetArea.m[0], -m_targetArea.m[1]) * (1.0 / 256))) {
@@ -367,46 +445,50 @@ int PixelViewApp::run(int argc, char *argv[]) {
         }
 
         // draw the image
-        if (imgValid()) {
-            glUseProgram(m_prog);
-            glBindTexture(GL_TEXTURE_2D, m_tex);
-            glUniform2f(m_locSize, float(m_imgWidth), float(m_imgHeight));
-            const Area *areas;
-            int count;
-            if ((m_viewMode == vmPanel) && !m_panelAreas.empty()) {
-                areas = m_panelAreas.data();
-                count = int(m_panelAreas.size());
-            } else {
-                areas = &m_currentArea;
-                count = 1;
-            }
-            while (count--) {
-                glUniform4f(m_locArea, float(areas->m[0]), float(areas->m[1]), float(areas->m[2]), float(areas->m[3]));
-                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-                ++areas;
-            }
-        }
+        drawContent(now);
 
         // draw the GUI and finish the frame
         GLutil::checkError("content draw");
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        GLutil::checkError("GUI draw");
+        if (useImGui) {
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            GLutil::checkError("GUI draw");
+        }
+        m_cpuTime = glfwGetTime() - frameStart;
+        if (m_lowLatency) {
+            // wait until the GPU has actually finished drawing the frame,
+            // so the driver can't queue up multiple frames in advance
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout);
+            glDeleteSync(fence);
+        }
         glfwSwapBuffers(m_window);
+        if (m_printStats && (m_lastFrameTime <= 0.0)) {
+            // glfwGetTime() starts at glfwInit(), so this is the startup time
+            printf("first frame presented after %.1f ms (%s)\n", 1000.0 * glfwGetTime(), m_imguiInitialized ? "with UI" : "without UI");
+            fflush(stdout);
+        }
+        updateFrameTiming(glfwGetTime());
     }
 
     // clean up
     #ifndef NDEBUG
         fprintf(stderr, "exiting ...\n");
     #endif
+    m_treeWalker.stop();
+    m_stream.stop();
+    m_follower.stop();
+    m_loader.stop();
+    stopFlipbook();
     ::free((void*)m_fileName);
+    ::free((void*)m_cmpFileName);
     ::free((void*)m_infoStr);
     clearStatus();
-    glUseProgram(0);
-    m_prog.free();
-    GLutil::done();
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
+    doneRendering();
+    if (m_imguiInitialized) {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
     glfwDestroyWindow(m_window);
     glfwTerminate();
     #ifndef NDEBUG
@@ -415,13 +497,427 @@ int PixelViewApp::run(int argc, char *argv[]) {
     return 0;
 }
 
+int PixelViewApp::runExport(const char* outPath, bool jpeg) {
+    if (!m_fileName) {
+        fprintf(stderr, "no input file specified for export\n");
+        return 1;
+    }
+    if (StringUtil::extractExtCode(m_fileName) == StringUtil::makeExtCode("pxv")) {
+        StringUtil::pathRemoveExt(m_fileName);
+    }
+
+    // load the image, using the ANSI rendering options from the config file
+    m_ansi.loadDefaults();
+    double relX = -1.0, relY = -1.0;
+    char* extStart = &m_fileName[strlen(m_fileName)];
+    strcpy(extStart, ".pxv");  // this is fine: we allocated enough extra bytes
+    loadConfig(m_fileName, relX, relY);
+    *extStart = '\0';
+    int width = 0, height = 0;
+    uint8_t* data;
+    if (StringUtil::checkExt(m_fileName, ANSILoader::fileExts)) {
+        data = static_cast<uint8_t*>(m_ansi.render(m_fileName, width, height));
+        if (data) {
+            // the ANSI renderer produces BGRA, but the tile writer wants RGBA
+            for (size_t i = size_t(width) * size_t(height) * 4u;  i;  i -= 4u) {
+                std::swap(data[i - 4u], data[i - 2u]);
+            }
+        }
+    } else {
+        size_t size = 0;
+        FileUtil::ReadStats rs;
+        void* file = FileUtil::readFile(m_fileName, size, 0, nullptr, &rs);
+        data = (file && (size <= size_t(INT_MAX))) ? stbi_load_from_memory(static_cast<const stbi_uc*>(file), int(size), &width, &height, nullptr, 4) : nullptr;
+        ::free(file);
+        if (file) {
+            printf("read %.1f MiB in %.2f seconds (%.0f MiB/s, %d thread(s))\n", double(rs.bytes) / 1048576.0,
+                   rs.seconds, rs.throughput() / 1048576.0, rs.threads);
+        }
+    }
+    if (!data) {
+        fprintf(stderr, "failed to load image '%s'\n", m_fileName);
+        return 1;
+    }
+
+    TileExport::Options opt;
+    opt.layout = TileExport::layoutFromPath(outPath);
+    opt.jpeg = jpeg;
+    TileExport::Stats stats;
+    printf("exporting %dx%d image '%s' into '%s' ...\n", width, height, m_fileName, outPath);
+    bool ok = TileExport::exportPyramid(data, width, height, outPath, opt, stats);
+    ::free(data);
+    printf("%d levels, %d tiles written, %d errors, %.2f seconds\n", stats.levels, stats.tiles, stats.errors, stats.seconds);
+    if (!ok) {
+        fprintf(stderr, "tile export failed\n");
+    }
+    return ok ? 0 : 1;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: rendering
+///////////////////////////////////////////////////////////////////////////////
+
+bool PixelViewApp::initRendering() {
+    #ifdef GL_HEADER_IS_GLAD
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            fprintf(stderr, "failed to load OpenGL 3.3 functions\n");
+            return false;
+        }
+    #else
+        #error no valid GL header / loader
+    #endif
+
+    if (!GLutil::init()) {
+        fprintf(stderr, "OpenGL initialization failed\n");
+        return false;
+    }
+    GLutil::enableDebugMessages();
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    int maxTexSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+    ANSILoader::restrictMaximumSize(maxTexSize);
+
+    // note: ImGui is initialized lazily, when the first UI element is shown
+
+    // regular display program: trilinear filtering with some extra
+    // sharpness for magnification (non-integer pixel edges are antialiased);
+    // in comparison mode, it samples both images (to keep the derivatives
+    // valid) and then picks the one for the current side of the split;
+    // in sprite mode, only a part (uCell) of the main image is shown, and
+    // sampling is restricted to it, so neighboring cells can't bleed in:
+    // the mipmap level is limited to the cell's alignment (uCellLod), so
+    // none of the texels used straddles the cell's edges, and the sampling
+    // position stays half a texel of the coarser level away from them
+    if (!linkDisplayProgram(m_prog, "display",
+         "#version 330 core"
+    "\n" "uniform vec2 uSize;"
+    "\n" "uniform vec2 uSizeB;"
+    "\n" "uniform vec4 uCell;"
+    "\n" "uniform float uCellLod;"
+    "\n" "uniform sampler2D uTex;"
+    "\n" "uniform sampler2D uTexB;"
+    "\n" "uniform int uCompare;"
+    "\n" "uniform float uSplit;"
+    "\n" "in vec2 vPos;"
+    "\n" "in vec2 vPosB;"
+    "\n" "out vec4 oColor;"
+    "\n" "float mapPos(in float pos, in float deriv) {"
+    "\n" "  float d = abs(deriv);"
+    "\n" "  if (d >= 1.03125) { return pos; }"
+    "\n" "  float i = floor(pos + 0.5);"
+    "\n" "  return i + clamp((pos - i) / d, -0.5, 0.5);"
+    "\n" "}"
+    "\n" "vec4 fetch(in sampler2D tex, in vec2 pos, in vec2 size, in vec4 cell, in float cellLod) {"
+    "\n" "  vec2 rpos = (cell.xy + pos * cell.zw) * size;"
+    "\n" "  vec2 mpos = vec2(mapPos(rpos.x, fwidth(rpos.x)),"
+    "\n" "                   mapPos(rpos.y, fwidth(rpos.y)));"
+    "\n" "  vec2 lo = cell.xy * size;"
+    "\n" "  vec2 hi = (cell.xy + cell.zw) * size;"
+    "\n" "  if (cellLod < 0.) {"
+    "\n" "    mpos = clamp(mpos, lo + .5, max(lo + .5, hi - .5));"
+    "\n" "    return texture(tex, mpos / size, -0.25);"
+    "\n" "  }"
+    "\n" "  vec2 fw = fwidth(rpos);"
+    "\n" "  float lod = clamp(log2(max(fw.x, fw.y)) - 0.25, 0., cellLod);"
+    "\n" "  float margin = .5 * exp2(ceil(lod));"
+    "\n" "  vec2 c = .5 * (lo + hi);"
+    "\n" "  mpos = clamp(mpos, min(lo + margin, c), max(hi - margin, c));"
+    "\n" "  return textureLod(tex, mpos / size, lod);"
+    "\n" "}"
+    "\n" "void main() {"
+    "\n" "  if (uCompare == 0) {"
+    "\n" "    oColor = fetch(uTex, vPos, uSize, uCell, uCellLod);"
+    "\n" "    return;"
+    "\n" "  }"
+    "\n" "  vec4 a = fetch(uTex,  vPos,  uSize,  uCell, uCellLod);"
+    "\n" "  vec4 b = fetch(uTexB, vPosB, uSizeB, vec4(0., 0., 1., 1.), -1.);"
+    "\n" "  bool right = (gl_FragCoord.x >= uSplit);"
+    "\n" "  vec2 p = right ? vPosB : vPos;"
+    "\n" "  oColor = (any(lessThan(p, vec2(0.))) || any(greaterThan(p, vec2(1.)))) ? vec4(0., 0., 0., 1.) : right ? b : a;"
+    "\n" "  if (abs(gl_FragCoord.x - uSplit) < 1.) { oColor = vec4(1.); }"
+    "\n" "}"
+    "\n")) { return false; }
+
+    // area-averaging program for minification: computes the exact average of
+    // all texels covered by the screen pixel's footprint; to keep the number
+    // of fetches bounded, it uses the finest mipmap level where the footprint
+    // is at most 8 texels wide; in sprite mode, the footprint is clipped to
+    // the cell, and the level is limited to the cell's alignment
+    if (!linkDisplayProgram(m_areaProg, "area filter",
+         "#version 330 core"
+    "\n" "uniform vec2 uSize;"
+    "\n" "uniform vec4 uCell;"
+    "\n" "uniform float uCellLod;"
+    "\n" "uniform sampler2D uTex;"
+    "\n" "in vec2 vPos;"
+    "\n" "out vec4 oColor;"
+    "\n" "void main() {"
+    "\n" "  vec2 rpos = (uCell.xy + vPos * uCell.zw) * uSize;"
+    "\n" "  vec2 fp = max(fwidth(rpos), vec2(1.));"
+    "\n" "  int lod = int(max(0., ceil(log2(max(fp.x, fp.y) / 8.))));"
+    "\n" "  if (uCellLod >= 0.) { lod = min(lod, int(uCellLod)); }"
+    "\n" "  ivec2 lsize = textureSize(uTex, lod);"
+    "\n" "  vec2 scale = vec2(lsize) / uSize;"
+    "\n" "  vec2 clo = uCell.xy * vec2(lsize), chi = (uCell.xy + uCell.zw) * vec2(lsize);"
+    "\n" "  vec2 lo = clamp((rpos - 0.5 * fp) * scale, clo, chi);"
+    "\n" "  vec2 hi = clamp((rpos + 0.5 * fp) * scale, clo, chi);"
+    "\n" "  ivec2 i0 = ivec2(floor(lo)), i1 = ivec2(ceil(hi)) - 1;"
+    "\n" "  vec4 sum = vec4(0.);"
+    "\n" "  float wsum = 0.;"
+    "\n" "  for (int y = i0.y;  y <= i1.y;  ++y) {"
+    "\n" "    float wy = min(hi.y, float(y + 1)) - max(lo.y, float(y));"
+    "\n" "    for (int x = i0.x;  x <= i1.x;  ++x) {"
+    "\n" "      float w = wy * (min(hi.x, float(x + 1)) - max(lo.x, float(x)));"
+    "\n" "      sum += w * texelFetch(uTex, clamp(ivec2(x, y), ivec2(0), lsize - 1), lod);"
+    "\n" "      wsum += w;"
+    "\n" "    }"
+    "\n" "  }"
+    "\n" "  oColor = sum / max(wsum, 1e-6);"
+    "\n" "}"
+    "\n")) { return false; }
+    m_areaFBO.init();
+
+    if (!m_upscaler.init()) {
+        fprintf(stderr, "upscaler initialization failed, upscaling filters will not be available\n");
+    }
+    return true;
+}
+
+void PixelViewApp::doneRendering() {
+    glUseProgram(0);
+    setCompareEntry(nullptr);
+    setImageEntry(nullptr);
+    m_texCache.clear();
+    m_upscaler.free();
+    m_areaFBO.free();
+    if (m_areaTex) { glDeleteTextures(1, &m_areaTex); }
+    m_areaProg.prog.free();
+    m_prog.prog.free();
+    GLutil::done();
+}
+
+void PixelViewApp::drawContent(double now, bool useAreaCache) {
+    if (!imgValid()) { return; }
+    const Area *areas;
+    int count;
+    if ((m_viewMode == vmPanel) && !m_panelAreas.empty()) {
+        areas = m_panelAreas.data();
+        count = int(m_panelAreas.size());
+    } else {
+        areas = &m_currentArea;
+        count = 1;
+    }
+    if (isComparing()) {
+        // comparison mode: both images are drawn as they are, in one pass
+        drawImage(m_prog, m_texCache.texture(m_imgEntry), m_sheetWidth, m_sheetHeight, m_orient, areas, count, m_cmpEntry, spriteRect());
+    } else {
+        // get the (possibly upscaled) texture; the upscaler only runs
+        // if the image or filter changed, otherwise it's a cache hit
+        int texWidth = m_sheetWidth, texHeight = m_sheetHeight;
+        GLuint tex = m_texCache.texture(m_imgEntry);
+        if (!m_loader.pending()) {  // don't upscale previews
+            tex = m_upscaler.get(tex, m_imgEntry->serial, m_upscale, texWidth, texHeight);
+        }
+        if (!useAreaCache || !drawAreaCache(now, tex, texWidth, texHeight, areas, count)) {
+            drawImage(m_prog, tex, texWidth, texHeight, m_orient, areas, count, nullptr, spriteRect());
+        }
+    }
+}
+
+bool PixelViewApp::linkDisplayProgram(DisplayProgram& p, const char* name, const char* fsSrc) {
+    GLutil::Shader vs(GL_VERTEX_SHADER,
+         "#version 330 core"
+    "\n" "uniform vec4 uArea;"
+    "\n" "uniform int uOrient;"
+    "\n" "uniform float uShift;"
+    "\n" "out vec2 vPos;"
+    "\n" "out vec2 vPosB;"
+    "\n" "vec2 orient(in vec2 pos) {"
+    "\n" "  vec2 p = ((uOrient & 4) != 0) ? pos.yx : pos;"
+    "\n" "  if ((uOrient & 1) != 0) { p.x = 1. - p.x; }"
+    "\n" "  if ((uOrient & 2) != 0) { p.y = 1. - p.y; }"
+    "\n" "  return p;"
+    "\n" "}"
+    "\n" "void main() {"
+    "\n" "  vec2 pos = vec2(float(gl_VertexID & 1), float((gl_VertexID & 2) >> 1));"
+    "\n" "  pos.x *= 1. + uShift;"
+    "\n" "  vPos = orient(pos);"
+    "\n" "  vPosB = orient(pos - vec2(uShift, 0.));"
+    "\n" "  gl_Position = vec4(uArea.xy * pos + uArea.zw, 0., 1.);"
+    "\n" "}"
+    "\n");
+    if (!vs.good()) {
+        fprintf(stderr, "%s vertex shader compilation failed\n", name);
+        return false;
+    }
+    GLutil::Shader fs(GL_FRAGMENT_SHADER, fsSrc);
+    if (!fs.good()) {
+        fprintf(stderr, "%s fragment shader compilation failed\n", name);
+        return false;
+    }
+    p.prog.link(vs, fs);
+    if (!p.prog.good()) {
+        fprintf(stderr, "%s program linking failed\n", name);
+        return false;
+    }
+    p.locArea    = p.prog.getUniformLocation("uArea");
+    p.locSize    = p.prog.getUniformLocation("uSize");
+    p.locOrient  = p.prog.getUniformLocation("uOrient");
+    p.locShift   = p.prog.getUniformLocation("uShift");
+    p.locSizeB   = p.prog.getUniformLocation("uSizeB");
+    p.locCompare = p.prog.getUniformLocation("uCompare");
+    p.locSplit   = p.prog.getUniformLocation("uSplit");
+    p.locCell    = p.prog.getUniformLocation("uCell");
+    p.locCellLod = p.prog.getUniformLocation("uCellLod");
+    p.prog.use();
+    glUniform1i(p.prog.getUniformLocation("uTex"),  0);
+    glUniform1i(p.prog.getUniformLocation("uTexB"), 1);
+    glUniform4f(p.locCell, 0.0f, 0.0f, 1.0f, 1.0f);
+    glUniform1f(p.locCellLod, -1.0f);
+    glUseProgram(0);
+    return true;
+}
+
+void PixelViewApp::drawImage(const DisplayProgram& p, GLuint tex, int texWidth, int texHeight, int orient, const Area* areas, int count, const TextureCache::Entry* cmp, const TexRect* rect) {
+    GLuint cmpTex = m_texCache.texture(cmp);  // (before setting up anything, as it may render)
+    glUseProgram(p.prog);
+    if (cmp) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, cmpTex);
+        glActiveTexture(GL_TEXTURE0);
+        glUniform2f(p.locSizeB, float(cmp->width), float(cmp->height));
+        glUniform1f(p.locSplit, float((m_compareMode == cmWipe) ? (m_wipePos * m_screenWidth) : (0.5 * m_screenWidth)));
+    }
+    glUniform1i(p.locCompare, cmp ? int(m_compareMode) : 0);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glUniform2f(p.locSize, float(texWidth), float(texHeight));
+    glUniform1i(p.locOrient, orient);
+    if (rect) {
+        // the coarsest mipmap level whose texels don't straddle the cell's
+        // edges is given by the number of trailing zero bits of its position
+        // and size in texels (which includes the upscaling factor)
+        int bits = int(std::lround(rect->x * texWidth))  | int(std::lround(rect->w * texWidth))
+                 | int(std::lround(rect->y * texHeight)) | int(std::lround(rect->h * texHeight));
+        int cellLod = 0;
+        while (bits && !(bits & 1)) { bits >>= 1;  ++cellLod; }
+        glUniform4f(p.locCell, float(rect->x), float(rect->y), float(rect->w), float(rect->h));
+        glUniform1f(p.locCellLod, float(cellLod));
+    } else {
+        glUniform4f(p.locCell, 0.0f, 0.0f, 1.0f, 1.0f);
+        glUniform1f(p.locCellLod, -1.0f);
+    }
+    while (count--) {
+        // in side-by-side mode, the comparison image is shifted by half a
+        // screen width (= 1.0 in NDC) to the right of the main image
+        glUniform1f(p.locShift, (cmp && (m_compareMode == cmSideBySide)) ? float(1.0 / areas->m[0]) : 0.0f);
+        glUniform4f(p.locArea, float(areas->m[0]), float(areas->m[1]), float(areas->m[2]), float(areas->m[3]));
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        ++areas;
+    }
+    if (cmp) {
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+}
+
+bool PixelViewApp::drawAreaCache(double now, GLuint tex, int texWidth, int texHeight, const Area* areas, int count) {
+    // check whether anything changed since the last frame; if so, restart
+    // the countdown until we consider the view to be static
+    ViewState& v = m_lastView;
+    int w = int(m_screenWidth), h = int(m_screenHeight);
+    uint32_t serial = m_imgEntry->serial ^ (uint32_t(m_upscale) << 24);
+    const TexRect* rect = spriteRect();
+    static const TexRect fullRect = {0.0, 0.0, 1.0, 1.0};
+    if (!rect) { rect = &fullRect; }
+    if ((tex != v.tex) || (serial != v.serial) || (texWidth != v.texWidth) || (texHeight != v.texHeight) || (m_orient != v.orient)
+    || (w != v.screenWidth) || (h != v.screenHeight) || (count != int(v.areas.size()))
+    || memcmp(static_cast<const void*>(rect), static_cast<const void*>(&v.rect), sizeof(TexRect))
+    || memcmp(static_cast<const void*>(areas), static_cast<const void*>(v.areas.data()), size_t(count) * sizeof(Area))) {
+        v.tex = tex;
+        v.serial = serial;
+        v.texWidth = texWidth;
+        v.texHeight = texHeight;
+        v.orient = m_orient;
+        v.screenWidth = w;
+        v.screenHeight = h;
+        v.rect = *rect;
+        v.areas.assign(areas, areas + count);
+        m_viewChangedAt = now;
+        m_areaCacheValid = false;
+        return false;
+    }
+
+    if (!m_areaCacheValid) {
+        if (((now - m_viewChangedAt) < areaFilterDelay) || m_animate || isScrolling() || m_panning || !m_areaProg.prog.good()) {
+            return false;
+        }
+
+        // only bother if the image is actually being minified
+        double tw = (isTransposed() ? texHeight : texWidth)  * (isTransposed() ? rect->h : rect->w);
+        double th = (isTransposed() ? texWidth  : texHeight) * (isTransposed() ? rect->w : rect->h);
+        bool minified = false;
+        for (int i = 0;  i < count;  ++i) {
+            if (((std::fabs(areas[i].m[0]) * 0.5 * m_screenWidth)  < (tw * 0.9999))
+            ||  ((std::fabs(areas[i].m[1]) * 0.5 * m_screenHeight) < (th * 0.9999))) { minified = true; }
+        }
+        if (!minified) {
+            m_viewChangedAt = now + 1E+9;  // don't check again until the view changes
+            return false;
+        }
+
+        // (re-)allocate the cache texture
+        #ifndef NDEBUG
+            double t0 = glfwGetTime();
+        #endif
+        GLutil::clearError();
+        if (!m_areaTex) {
+            glGenTextures(1, &m_areaTex);
+            glBindTexture(GL_TEXTURE_2D, m_areaTex);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        if ((w != m_areaTexWidth) || (h != m_areaTexHeight)) {
+            glBindTexture(GL_TEXTURE_2D, m_areaTex);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+            m_areaTexWidth = w;
+            m_areaTexHeight = h;
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // render the area-filtered image into it
+        bool ok = !GLutil::checkError("area filter texture allocation") && m_areaFBO.begin(m_areaTex);
+        if (ok) {
+            glClear(GL_COLOR_BUFFER_BIT);
+            drawImage(m_areaProg, tex, texWidth, texHeight, m_orient, areas, count, nullptr, rect);
+        }
+        m_areaFBO.end();
+        ok = ok && !GLutil::checkError("area filter rendering");
+        #ifndef NDEBUG
+            printf("area filter: %s (%dx%d) in %.1f ms\n", ok ? "rendered" : "FAILED", w, h, (glfwGetTime() - t0) * 1000.0);
+        #endif
+        if (!ok) {
+            m_viewChangedAt = now + 1E+9;  // don't retry until the view changes
+            return false;
+        }
+        m_areaCacheValid = true;
+    }
+
+    // present the cached image 1:1 (bottom-up, as it's an FBO texture)
+    static const Area fullScreen = {{ 2.0, 2.0, -1.0, -1.0 }};
+    drawImage(m_prog, m_areaTex, m_areaTexWidth, m_areaTexHeight, 0, &fullScreen, 1);
+    return true;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // MARK: events
 ///////////////////////////////////////////////////////////////////////////////
 
 void PixelViewApp::handleKeyEvent(int key, int scancode, int action, int mods) {
     (void)scancode;
-    if (((action != GLFW_PRESS) && (action != GLFW_REPEAT)) || m_io->WantCaptureKeyboard) { return; }
+    if (((action != GLFW_PRESS) && (action != GLFW_REPEAT)) || imguiWantsKeyboard()) { return; }
     if (key != GLFW_KEY_ESCAPE) { m_escapePressed = false; }
     bool ctrl = !!(mods & GLFW_MOD_CONTROL);
     switch (key) {
@@ -429,6 +925,7 @@ void PixelViewApp::handleKeyEvent(int key, int scancode, int action, int mods) {
         case GLFW_KEY_F2:  m_showConfig = !m_showConfig; updateCursor(); break;
         case GLFW_KEY_F1:  m_showHelp   = !m_showHelp;   updateCursor(); break;
         case GLFW_KEY_F3:  m_showInfo   = !m_showInfo;   updateCursor(); updateInfo(); break;
+        case GLFW_KEY_F4:  m_showTiming = !m_showTiming; break;
         case GLFW_KEY_F9:  m_showDemo   = !m_showDemo;   updateCursor(); break;
         case GLFW_KEY_F5:  loadImage();  break;
         case GLFW_KEY_F6:  saveConfig(); break;
@@ -436,9 +933,23 @@ void PixelViewApp::handleKeyEvent(int key, int scancode, int action, int mods) {
         case GLFW_KEY_F10:
         case GLFW_KEY_Q: m_active = false; break;
         case GLFW_KEY_I: if (canDoIntegerZoom()) { m_integer = !m_integer; viewCfg("a"); } break;
+        case GLFW_KEY_M: m_showMinimap = !m_showMinimap; break;
         case GLFW_KEY_P: if (m_viewMode == vmPanel) { viewCfg("fsx"); } else { m_viewMode = vmPanel; viewCfg("sx"); } break;
         case GLFW_KEY_S: if (ctrl) { saveConfig(); } else if (isScrolling()) { m_scrollX = m_scrollY = 0.0; } else { startScroll(); } break;
         case GLFW_KEY_T: cycleTopView(); break;
+        case GLFW_KEY_R: rotateView(!!(mods & GLFW_MOD_SHIFT)); break;
+        case GLFW_KEY_H: mirrorView(false); break;
+        case GLFW_KEY_V: mirrorView(true);  break;
+        case GLFW_KEY_C: cycleCompareMode(); break;
+        case GLFW_KEY_X: swapCompareImages(); break;
+        case GLFW_KEY_SPACE:
+        case GLFW_KEY_K: togglePlayback(); break;
+        case GLFW_KEY_J: seekPlayback((mods & GLFW_MOD_SHIFT) ? (-60.0) : (-10.0)); break;
+        case GLFW_KEY_L: seekPlayback((mods & GLFW_MOD_SHIFT) ? (+60.0) : (+10.0)); break;
+        case GLFW_KEY_U: changePlaybackSpeed(0.5); break;
+        case GLFW_KEY_O: changePlaybackSpeed(2.0); break;
+        case GLFW_KEY_G: toggleSpriteMode(); break;
+        case GLFW_KEY_B: if (mods & GLFW_MOD_SHIFT) { toggleFlipbookMode(); } else if (m_flipbook.active()) { stopFlipbook(); } else { startFlipbook(); } break;
         case GLFW_KEY_Z:
         case GLFW_KEY_Y:
         case GLFW_KEY_KP_DIVIDE:   cycleViewMode(true);   break;
@@ -474,12 +985,20 @@ void PixelViewApp::handleMouseButtonEvent(int button, int action, int mods) {
     (void)mods;
     if (action == GLFW_RELEASE) {
         m_panning = false;
-    } else if (!m_io->WantCaptureMouse && ((button == GLFW_MOUSE_BUTTON_LEFT) || (button == GLFW_MOUSE_BUTTON_MIDDLE))) {
-        double x = m_io->DisplaySize.x * 0.5;
-        double y = m_io->DisplaySize.y * 0.5;
+        m_wipeDragging = false;
+    } else if (!imguiWantsMouse() && (button == GLFW_MOUSE_BUTTON_RIGHT) && isComparing() && (m_compareMode == cmWipe)) {
+        double x = 0.0, y = 0.0;
+        glfwGetCursorPos(m_window, &x, &y);
+        m_wipePos = std::min(1.0, std::max(0.0, x / m_screenWidth));
+        m_wipeDragging = true;
+    } else if (!imguiWantsMouse() && ((button == GLFW_MOUSE_BUTTON_LEFT) || (button == GLFW_MOUSE_BUTTON_MIDDLE))) {
+        double x = m_screenWidth  * 0.5;
+        double y = m_screenHeight * 0.5;
         glfwGetCursorPos(m_window, &x, &y);
         m_panX = m_x0 - x;
         m_panY = m_y0 - y;
+        m_panCursorX = x;
+        m_panCursorY = y;
         m_scrollX = m_scrollY = 0.0;
         m_panning = true;
     }
@@ -488,20 +1007,37 @@ void PixelViewApp::handleMouseButtonEvent(int button, int action, int mods) {
 
 void PixelViewApp::handleCursorPosEvent(double xpos, double ypos) {
     updateCursor(true);
+    if (m_wipeDragging) {
+        m_wipePos = std::min(1.0, std::max(0.0, xpos / m_screenWidth));
+    }
+    if (!m_lowLatency) {
+        // (in low-latency mode, panning is handled in the main loop instead)
+        updatePan(xpos, ypos);
+    }
+}
+
+void PixelViewApp::updatePan(double xpos, double ypos) {
+    // nothing to do if the cursor didn't move; in low-latency mode, this is
+    // called every frame, and a pan to the same position would needlessly
+    // force a redraw and count as input for the latency statistics
+    if ((xpos == m_panCursorX) && (ypos == m_panCursorY)) { return; }
     if (m_panning && ((glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_LEFT)   == GLFW_PRESS)
                   ||  (glfwGetMouseButton(m_window, GLFW_MOUSE_BUTTON_MIDDLE) == GLFW_PRESS))) {
         m_x0 = xpos + m_panX;
         m_y0 = ypos + m_panY;
+        m_panCursorX = xpos;
+        m_panCursorY = ypos;
+        m_inputTime = glfwGetTime();
         viewCfg("fsx");
     }
 }
 
 void PixelViewApp::handleScrollEvent(double xoffset, double yoffset) {
     (void)xoffset;
-    if (m_io->WantCaptureMouse) { return; }
+    if (imguiWantsMouse()) { return; }
     updateCursor(true);
-    double xpos = m_io->DisplaySize.x * 0.5;
-    double ypos = m_io->DisplaySize.y * 0.5;
+    double xpos = m_screenWidth  * 0.5;
+    double ypos = m_screenHeight * 0.5;
     glfwGetCursorPos(m_window, &xpos, &ypos);
     changeZoom(yoffset, xpos, ypos);
     m_escapePressed = false;
@@ -510,6 +1046,10 @@ void PixelViewApp::handleScrollEvent(double xoffset, double yoffset) {
 void PixelViewApp::handleDropEvent(int path_count, const char* paths[]) {
     if ((path_count < 1) || !paths || !paths[0] || !paths[0][0]) { return; }
     loadImage(paths[0]);
+    if ((path_count > 1) && paths[1] && paths[1][0]) {
+        // two files dropped at once -> compare them
+        loadCompareImage(paths[1]);
+    }
     m_escapePressed = false;
 }
 
@@ -609,11 +1149,40 @@ void PixelViewApp::cycleTopView() {
     updateView(false);
 }
 
+void PixelViewApp::rotateView(bool ccw) {
+    // rotating the screen by 90 degrees means swapping the axes and mirroring
+    // one of them; which one depends on the direction and whether the texture
+    // axes are already swapped
+    bool flipX = (isTransposed() != ccw);
+    m_orient ^= orTranspose | (flipX ? orFlipX : orFlipY);
+    computePanelGeometry();
+    viewCfg("sx");
+}
+
+void PixelViewApp::mirrorView(bool vertical) {
+    m_orient ^= (isTransposed() != vertical) ? orFlipY : orFlipX;
+    viewCfg("sx");
+}
+
+int PixelViewApp::orientFromEXIF(int exif) {
+    return ((exif >= 1) && (exif <= 8)) ? exifToOrient[exif] : 0;
+}
+
+int PixelViewApp::orientToEXIF(int orient) {
+    for (int exif = 1;  exif <= 8;  ++exif) {
+        if (exifToOrient[exif] == orient) { return exif; }
+    }
+    return 1;
+}
+
 void PixelViewApp::startScroll(double speed, double dx, double dy) {
     if (speed != 0.0) {
         // speed is specified -> set the speed
         m_scrollSpeed = speed;
     }
+    if (!isScrolling()) {
+        m_scrollAccum = 0.0;
+    }
     if (m_viewMode == vmPanel) {
         // no scrolling allowed in panel mode
         m_scrollX = m_scrollY = 0.0;
@@ -669,14 +1238,148 @@ void PixelViewApp::toggleFullscreen() {
         GLFWmonitor *monitor = glfwGetPrimaryMonitor();
         const GLFWvidmode* mode = glfwGetVideoMode(monitor);
         glfwSetWindowMonitor(m_window, monitor, 0, 0, mode->width, mode->height, mode->refreshRate);
+        updateRefreshRate(mode);
         m_fullscreen = true;
     }
     updateCursor();
-    glfwSwapInterval(1);
+    updateSwapInterval();
     updateScreenSize();
     viewCfg("x");
 }
 
+void PixelViewApp::updateRefreshRate(const GLFWvidmode* mode) {
+    if (mode && (mode->refreshRate > 0)) {
+        m_refreshInterval = 1.0 / mode->refreshRate;
+        m_frameInterval = m_frameDelta = m_refreshInterval;
+    }
+}
+
+void PixelViewApp::updateSwapInterval() {
+    m_adaptiveVsync = m_adaptiveVsync && m_canAdaptiveVsync;
+    glfwSwapInterval(m_adaptiveVsync ? (-1) : 1);
+}
+
+void PixelViewApp::updateFrameTiming(double now) {
+    // 'now' is the time when the last frame has been presented, so dt is
+    // the interval between the last two presents, i.e. the time the previous
+    // frame has actually been visible on screen
+    double dt = now - m_lastFrameTime;
+    m_lastFrameTime = now;
+
+    // update statistics
+    if ((now - m_statsStart) >= statsInterval) {
+        if (m_printStats && (m_stats.frames > 0)) {
+            printf("%6.1f fps | frame avg %6.2f ms, max %6.2f ms | CPU avg %6.3f ms, max %6.3f ms | %d missed | %s\n",
+                   m_stats.frames / m_stats.intervalSum,
+                   1000.0 * m_stats.intervalSum / m_stats.frames, 1000.0 * m_stats.intervalMax,
+                   1000.0 * m_stats.cpuSum / m_stats.frames, 1000.0 * m_stats.cpuMax,
+                   m_stats.missed, m_imguiActive ? "UI" : "no UI");
+            fflush(stdout);
+        }
+        m_statsShown = m_stats;
+        m_stats = FrameStats();
+        m_statsStart = now;
+    }
+    if ((dt <= 0.0) || (dt > maxFrameInterval)) {
+        // first frame or a major stall (e.g. loading a file): don't let it
+        // spoil the estimate, and don't try to compensate for it either
+        m_frameDelta = m_frameInterval;
+        m_inputTime = 0.0;
+        return;
+    }
+    m_stats.frames++;
+    m_stats.intervalSum += dt;
+    m_stats.intervalMax = std::max(m_stats.intervalMax, dt);
+    m_stats.cpuSum += m_cpuTime;
+    m_stats.cpuMax = std::max(m_stats.cpuMax, m_cpuTime);
+    if (m_inputTime > 0.0) {
+        // input-to-present latency: time from acquiring the mouse position
+        // that has been used in the frame until the frame has been presented
+        double latency = now - m_inputTime;
+        m_stats.latencyCount++;
+        m_stats.latencySum += latency;
+        m_stats.latencyMax = std::max(m_stats.latencyMax, latency);
+        m_inputTime = 0.0;
+    }
+
+    // check whether the frame has been presented on a vsync; if so, how many
+    // vsyncs did it take? (more than one = missed vsync)
+    double vsyncs = std::floor(dt / m_refreshInterval + 0.5);
+    bool locked = (vsyncs >= 1.0) && (std::fabs(dt - vsyncs * m_refreshInterval) < (refreshSnapTolerance * m_refreshInterval));
+    bool late = locked ? (vsyncs > 1.0) : (dt > (lateFrameThreshold * m_frameInterval));
+    int missed = !late ? 0 : std::max(1, int(vsyncs) - 1);
+    m_stats.missed += missed;
+    m_missedTotal += missed;
+    #ifdef DEBUG_FRAME_TIMING
+        if (late) { printf("timing glitch: frame took %.3f ms (%d vsync(s) missed)\n", dt * 1000.0, missed); }
+    #endif
+
+    // update the average frame interval, but only with regular frames
+    if (!late) {
+        m_frameInterval += frameTimeSmoothing * (dt - m_frameInterval);
+    } else if (locked) {
+        m_frameInterval += frameTimeSmoothing * (dt / vsyncs - m_frameInterval);
+    }
+
+    // determine the amount of time the next frame shall advance animations
+    // and scrolling by:
+    // - if the frame was presented on a vsync, use the nominal refresh
+    //   interval, as it is free of any jitter; this keeps per-frame motion
+    //   perfectly constant in the usual case
+    // - if the frame was late, advance by the time it actually took,
+    //   so scrolling catches up with where it should be
+    // - otherwise (no vsync), use the smoothed measured interval
+    if (locked) {
+        m_frameDelta = vsyncs * m_refreshInterval;
+    } else if (late) {
+        m_frameDelta = dt;
+    } else {
+        m_frameDelta = m_frameInterval;
+    }
+}
+
+void PixelViewApp::initImGui() {
+    // creating the context, building the font atlas and compiling the shaders
+    // takes a while, so this is deferred until the UI is actually needed
+    #ifndef NDEBUG
+        double t0 = glfwGetTime();
+    #endif
+    ImGui::CreateContext();
+    m_io = &ImGui::GetIO();
+    m_io->IniFilename = nullptr;
+    ImGui_ImplGlfw_InitForOpenGL(m_window, true);
+    ImGui_ImplOpenGL3_Init(nullptr);
+    m_imguiInitialized = true;
+    #ifndef NDEBUG
+        printf("ImGui initialized in %.1f ms\n", 1000.0 * (glfwGetTime() - t0));
+    #endif
+}
+
+void PixelViewApp::setImGuiActive(bool active) {
+    m_imguiActive = active;
+    if (active) {
+        // the backend installs its callbacks itself on initialization
+        if (m_imguiInitialized) {
+            ImGui_ImplGlfw_InstallCallbacks(m_window);
+        } else {
+            initImGui();
+        }
+        // ImGui didn't see any events while it was inactive, so bring it up
+        // to date: forget about keys it still considers to be pressed, and
+        // tell it where the mouse is right now
+        m_io->ClearInputKeys();
+        double x = 0.0, y = 0.0;
+        glfwGetCursorPos(m_window, &x, &y);
+        m_io->AddMousePosEvent(float(x), float(y));
+    } else {
+        ImGui_ImplGlfw_RestoreCallbacks(m_window);
+        m_cursorMode = 0;  // ImGui may have changed the cursor mode behind our back
+    }
+    #ifdef DEBUG_FRAME_TIMING
+        printf("ImGui %s\n", active ? "activated" : "deactivated");
+    #endif
+}
+
 void PixelViewApp::updateCursor(bool startTimeout) {
     if (!m_fullscreen || anyUIvisible()) {
         m_hideCursorAt = 0.0;
@@ -701,6 +1404,14 @@ void PixelViewApp::loadImage(const char* filename) {
 }
 
 void PixelViewApp::loadImage(bool soft) {
+    if (m_stream.active() && (soft || (m_fileName && !strcmp(m_fileName, m_stream.path())))) {
+        // reloading a stream means rendering the data received so far again
+        m_stream.setOptions(m_ansi.options);
+        return;
+    }
+    m_stream.stop();
+    m_loader.cancel();
+    if (!soft) { m_player.unload();  stopFlipbook(); }
     m_imgWidth = m_imgHeight = 0;
     m_viewWidth = m_viewHeight = 0.0;
     m_isANSI = false;
@@ -714,15 +1425,18 @@ void PixelViewApp::loadImage(bool soft) {
             StringUtil::pathRemoveExt(m_fileName);
         }
 
-        // change the window title
-        const char* title = StringUtil::concat(PRODUCT_NAME " - ", StringUtil::pathBaseName(m_fileName));
-        glfwSetWindowTitle(m_window, title);
-        ::free((void*)title);
+        updateWindowTitle();
 
         // load default configuration
         m_aspect = 1.0;
+        m_orient = 0;
+        m_orientSet = false;
         m_viewMode = m_prevViewMode = vmFit;
         m_x0 = m_y0 = 0.0;
+        m_upscale = Upscaler::Filter::None;
+        m_sprite = SpriteGrid();
+        m_spritePaused = false;
+        m_spriteFrame = 0;
         m_ansi.loadDefaults();
 
         // try to load the configuration file
@@ -732,48 +1446,85 @@ void PixelViewApp::loadImage(bool soft) {
         *extStart = '\0';
     }
 
-    // load the actual image
+    // streams (standard input or named pipes) are read and rendered in the
+    // background; the canvas is picked up by updateStream() in the main loop
+    if (ANSIStream::isStream(m_fileName)) {
+        m_isANSI = true;
+        unloadImage();
+        if (!m_stream.start(m_fileName, m_ansi.options)) {
+            setFileStatus(stError, "failed to open stream: ");
+        }
+        return;
+    }
+
+    // load the actual image; regular image files may already be in the
+    // texture cache, while ANSI files are always rendered again, as the result
+    // depends on the rendering options and SAUCE metadata
+    TextureCache::Entry* entry = nullptr;
     void* data = nullptr;
+    bool tooLarge = false;
     if (StringUtil::checkExt(m_fileName, ANSILoader::fileExts)) {
         m_isANSI = true;
         #ifndef NDEBUG
             printf("loading ANSI file: '%s'\n", m_fileName);
         #endif
-        data = m_ansi.render(m_fileName, m_imgWidth, m_imgHeight);
+        data = m_ansi.render(m_fileName, m_imgWidth, m_imgHeight, true);
         if (data && (m_aspect == 1.0)) {
             // use the ANSI renderer's recommended aspect ratio if it's not changed explicitly
             m_aspect = m_ansi.aspect;
         }
+    } else if (StringUtil::checkExt(m_fileName, TermPlayer::fileExts)) {
+        // terminal recordings are rendered at the current playback position
+        // (i.e. the beginning, unless the rendering options changed);
+        // updatePlayer() keeps the texture up to date during playback
+        m_isANSI = true;
+        if (m_player.loaded() || m_player.load(m_fileName)) {
+            int width = 0, height = 0, firstRow = 0, endRow = 0;
+            m_player.invalidate();
+            const void* frame = m_player.render(m_ansi.options, width, height, firstRow, endRow);
+            entry = m_texCache.add(nullptr, frame, width, height, true);
+            tooLarge = frame && !entry;
+            if (entry && (m_aspect == 1.0)) { m_aspect = m_player.aspect; }
+        }
     } else {
-        #ifndef NDEBUG
-            printf("loading image: '%s'\n", m_fileName);
-        #endif
-        data = stbi_load(m_fileName, &m_imgWidth, &m_imgHeight, nullptr, 4);
+        entry = loadImageFile(m_fileName, tooLarge, true);
     }
-    if (!data) {
+    if (!soft) {
+        // apply EXIF orientation, unless overridden by the config file
+        m_exifOrient = orientFromEXIF(m_isANSI ? 0 : ExifUtil::readOrientation(m_fileName));
+        if (!m_orientSet) { m_orient = m_exifOrient; }
+    }
+    if (!data && !entry) {
         #ifndef NDEBUG
             printf("image loading failed\n");
         #endif
-        setFileStatus(stError, "failed to load image: ");
+        setFileStatus(stError, tooLarge ? "image too large: " : "failed to load image: ");
         unloadImage();
         return;
     }
 
     // upload texture
-    glBindTexture(GL_TEXTURE_2D, m_tex);
-    GLutil::checkError("before uploading image texture");
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_imgWidth, m_imgHeight, 0, m_isANSI ? GL_BGRA : GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glFlush();
-    glFinish();
-    ::free(data);
-    if (GLutil::checkError("after uploading image texture")) {
-        setFileStatus(stError, "image too large: ");
-        unloadImage();
-        return;
+    if (!entry) {
+        if (m_ansi.paletteSize) {
+            entry = m_texCache.addIndexed(nullptr, static_cast<const uint8_t*>(data), m_imgWidth, m_imgHeight, m_ansi.palette, m_ansi.paletteSize);
+        } else {
+            entry = m_texCache.add(nullptr, data, m_imgWidth, m_imgHeight, true);
+        }
+        ::free(data);
+        if (!entry) {
+            setFileStatus(stError, "image too large: ");
+            unloadImage();
+            return;
+        }
+    }
+    setImageEntry(entry);
+    if (m_loader.pending()) {
+        // the entry is only a preview -> lay out the view for the full image
+        // already, so nothing moves when updateLoader() swaps it in
+        m_sheetWidth  = m_loader.width();
+        m_sheetHeight = m_loader.height();
+        updateSpriteGeometry();
     }
-    glGenerateMipmap(GL_TEXTURE_2D);
-    GLutil::checkError("mipmap generation");
-    glBindTexture(GL_TEXTURE_2D, 0);
     #ifndef NDEBUG
         printf("loaded image successfully (%dx%d pixels)\n", m_imgWidth, m_imgHeight);
     #endif
@@ -794,14 +1545,558 @@ void PixelViewApp::loadImage(bool soft) {
     updateInfo();
 }
 
+void PixelViewApp::updateStream() {
+    ANSIStream::Canvas canvas;
+    if (!m_stream.active() || !m_stream.fetch(canvas)) { return; }
+
+    // if the view is at the bottom of the canvas, stay there, so the most
+    // recent output is always visible; otherwise, the view doesn't move
+    bool first = !m_imgEntry;
+    bool follow = !first && (m_viewMode == vmFree) && !m_orient && (m_y0 <= (m_minY0 + 0.5));
+
+    // upload the changed part of the canvas; a new texture is only required
+    // if the canvas width changed (e.g. due to different rendering options)
+    if (m_texCache.update(m_imgEntry, canvas.data, canvas.width, canvas.height, canvas.firstChangedRow, canvas.height, true)) {
+        setImageEntry(m_imgEntry);  // update the image size
+    } else {
+        setImageEntry(m_texCache.add(nullptr, canvas.data, canvas.width, canvas.height, true));
+    }
+    ::free(canvas.data);
+    if (first && (m_aspect == 1.0)) {
+        m_aspect = m_ansi.aspect = canvas.aspect;
+    }
+
+    computePanelGeometry();
+    if (first) { viewCfg("xsn"); }
+    updateView(false);
+    if (follow) {
+        m_y0 = m_minY0;
+        updateView(false);
+    }
+    updateInfo();
+}
+
+void PixelViewApp::updateFollower() {
+    DirFollower::Frame frame;
+    if (!m_follower.active() || !m_follower.fetch(frame)) { return; }
+    const char* path = frame.path.c_str();
+
+    // the frame has already been decoded in the background, so only the
+    // upload remains; it goes into the texture cache like a normally loaded
+    // file, so loadImage() and later navigation will find it there
+    TextureCache::Entry* entry = m_texCache.find(path);
+    if (!entry) { entry = m_texCache.findContent(path, frame.hash, frame.fileSize, &frame.fp); }
+    if (!entry) {
+        entry = m_texCache.add(path, frame.data, frame.width, frame.height);
+        m_texCache.setContent(entry, frame.hash, frame.fileSize, &frame.fp);
+    }
+    ::free(frame.data);
+    if (!entry) {
+        #ifndef NDEBUG
+            printf("follow mode: failed to upload '%s'\n", path);
+        #endif
+        return;
+    }
+
+    if (m_imgEntry && !m_isANSI && !m_stream.active() && (entry->width == m_sheetWidth) && (entry->height == m_sheetHeight)) {
+        // same geometry as the current image (the common case when following
+        // a sequence of rendered frames) -> swap the texture, keep the view
+        m_loader.cancel();
+        ::free((void*)m_fileName);
+        m_fileName = StringUtil::copy(path, 4);
+        updateWindowTitle();
+        setImageEntry(entry);
+        updateInfo();
+    } else {
+        loadImage(path);
+    }
+    #ifndef NDEBUG
+        printf("follow mode: showing '%s' (%d file(s) skipped so far)\n", path, m_follower.dropped());
+    #endif
+}
+
+void PixelViewApp::updateLoader() {
+    ImageLoader::Result r;
+    if (!m_loader.fetch(r)) { return; }
+    if (!m_fileName || (r.path != m_fileName)) {
+        ::free(r.data);  // stale result (shouldn't happen, as loadImage() cancels)
+        return;
+    }
+    const char* path = r.path.c_str();
+
+    // upload the full image and replace the preview with it
+    TextureCache::Entry* entry = nullptr;
+    if (!r.compressed.data.empty()) {
+        entry = m_texCache.addCompressed(path, r.compressed);
+        if (entry) { entry->encodeTime = r.encodeTime; }
+    } else if (r.data) {
+        entry = m_texCache.add(path, r.data, r.width, r.height);
+    }
+    m_texCache.setContent(entry, r.hash, r.fileSize, &r.fp);
+    if (entry && r.data) {
+        m_texCache.retain(entry, r.data);  // keep the pixels for the next reload
+    } else {
+        ::free(r.data);
+    }
+    if (!entry) {
+        setFileStatus(stError, (r.data || !r.compressed.data.empty()) ? "image too large: " : "failed to load image: ");
+        unloadImage();
+        return;
+    }
+    #ifndef NDEBUG
+        printf("background decode finished (%dx%d pixels)\n", entry->width, entry->height);
+    #endif
+
+    // the geometry is normally the same as predicted by the preview;
+    // if it isn't (e.g. the file has been modified in the meantime),
+    // the view needs to be updated
+    bool resized = (entry->width != m_sheetWidth) || (entry->height != m_sheetHeight);
+    setImageEntry(entry);
+    if (resized) {
+        computePanelGeometry();
+        updateView(false);
+    }
+    updateInfo();
+}
+
+void PixelViewApp::updateWindowTitle() {
+    const char* title = StringUtil::concat(PRODUCT_NAME " - ", StringUtil::pathBaseName(m_fileName));
+    glfwSetWindowTitle(m_window, title);
+    ::free((void*)title);
+}
+
+void PixelViewApp::updatePlayer(double now) {
+    if (!m_player.loaded() || !m_imgEntry) { return; }
+    m_player.advance(now);
+    int width = 0, height = 0, firstRow = 0, endRow = 0;
+    const void* frame = m_player.render(m_ansi.options, width, height, firstRow, endRow);
+    if (!frame || m_texCache.update(m_imgEntry, frame, width, height, firstRow, endRow, true)) { return; }
+
+    // the terminal has been resized, or the texture is also used as the
+    // comparison image -> upload into a new texture
+    bool resized = (width != m_sheetWidth) || (height != m_sheetHeight);
+    setImageEntry(m_texCache.add(nullptr, frame, width, height, true));
+    if (resized) {
+        computePanelGeometry();
+        updateView(false);
+        updateInfo();
+    }
+}
+
+void PixelViewApp::togglePlayback() {
+    if (m_flipbook.active()) {
+        m_flipbook.paused = !m_flipbook.paused;
+        showPlaybackStatus();
+        return;
+    }
+    if (spriteActive()) {
+        m_spritePaused = !m_spritePaused;
+        if (!m_spritePaused) { restartSpriteClock(); }
+        showPlaybackStatus();
+        return;
+    }
+    if (!m_player.loaded()) { return; }
+    if (m_player.paused && (m_player.position() >= m_player.duration())) {
+        m_player.seek(0.0);  // restart at the end of the recording
+    }
+    m_player.paused = !m_player.paused;
+    showPlaybackStatus();
+}
+
+void PixelViewApp::seekPlayback(double delta) {
+    if (m_flipbook.active()) {
+        // single frames (with Shift: ten frames) instead of seconds
+        m_flipbook.step((delta < 0.0) ? ((delta < -10.0) ? -10 : -1) : ((delta > 10.0) ? 10 : 1));
+        return;
+    }
+    if (spriteActive()) {
+        // same for sprite sheet cells
+        int n = spriteFrames();
+        m_spriteFrame = ((m_spriteFrame + ((delta < 0.0) ? ((delta < -10.0) ? -10 : -1) : ((delta > 10.0) ? 10 : 1))) % n + n) % n;
+        restartSpriteClock();
+        showPlaybackStatus();
+        return;
+    }
+    if (!m_player.loaded()) { return; }
+    m_player.seek(m_player.position() + delta);
+    showPlaybackStatus();
+}
+
+void PixelViewApp::changePlaybackSpeed(double factor) {
+    if (m_flipbook.active()) {
+        m_flipbook.fps = std::max(1.0, std::min(m_flipbook.fps * factor, 240.0));
+        m_flipbook.resync();
+        showPlaybackStatus();
+        return;
+    }
+    if (spriteActive()) {
+        m_sprite.fps = std::max(0.5, std::min(m_sprite.fps * factor, 240.0));
+        restartSpriteClock();
+        showPlaybackStatus();
+        return;
+    }
+    if (!m_player.loaded()) { return; }
+    m_player.speed = std::max(1.0 / 16, std::min(m_player.speed * factor, 64.0));
+    showPlaybackStatus();
+}
+
+void PixelViewApp::showPlaybackStatus() {
+    if (m_flipbook.active()) {
+        char msg[80];
+        snprintf(msg, sizeof(msg), "%s at frame %d / %d, %g fps, %s",
+                 m_flipbook.paused ? "paused" : "playing", m_flipbook.current() + 1, m_flipbook.count(),
+                 m_flipbook.fps, m_flipbook.pingPong ? "ping-pong" : "loop");
+        setStatus(stSuccess, mtCopy, msg);
+        return;
+    }
+    if (spriteActive()) {
+        char msg[80];
+        snprintf(msg, sizeof(msg), "%s at cell %d / %d, %g fps",
+                 m_spritePaused ? "paused" : "playing", m_spriteFrame + 1, spriteFrames(), m_sprite.fps);
+        setStatus(stSuccess, mtCopy, msg);
+        return;
+    }
+    int pos = int(m_player.position()), dur = int(m_player.duration() + 0.5);
+    char msg[80];
+    snprintf(msg, sizeof(msg), "%s at %d:%02d / %d:%02d, speed %gx",
+             m_player.paused ? "paused" : "playing", pos / 60, pos % 60, dur / 60, dur % 60, m_player.speed);
+    setStatus(stSuccess, mtCopy, msg);
+}
+
+void PixelViewApp::startFlipbook() {
+    if (!m_fileName || m_isANSI || m_stream.active()) { return; }
+    std::vector<std::string> frames;
+    int index = Flipbook::findSequence(m_fileName, isFollowFileName, frames);
+    if ((index < 0) || (frames.size() < 2u)) {
+        setStatus(stError, mtConst, "no image sequence found");
+        return;
+    }
+    // if the current image is only a preview, it needs to be decoded again
+    bool preview = m_loader.pending();
+    m_loader.cancel();
+    m_flipbook.start(std::move(frames), index);
+    if (preview) { m_flipbook.seek(index); }
+    showPlaybackStatus();
+}
+
+void PixelViewApp::stopFlipbook() {
+    if (!m_flipbook.active()) { return; }
+    m_flipbook.stop();
+    for (auto& e : m_flipRing) {
+        m_texCache.release(e);  // the entry on display stays alive, as m_imgEntry holds a reference
+        e = nullptr;
+    }
+    m_flipRingPos = 0;
+    updateInfo();
+}
+
+void PixelViewApp::toggleFlipbookMode() {
+    if (!m_flipbook.active()) { return; }
+    m_flipbook.pingPong = !m_flipbook.pingPong;
+    m_flipbook.resync();
+    showPlaybackStatus();
+}
+
+void PixelViewApp::updateFlipbook(double now) {
+    Flipbook::Frame frame;
+    if (!m_flipbook.advance(now, frame)) { return; }
+
+    // upload into the next texture of the ring; neither the texture on
+    // display nor the one before it (which the GPU may still be reading
+    // from while frames are queued) are touched, so the upload never has
+    // to wait for the GPU
+    int pos = (m_flipRingPos + 1) % flipRingSize;
+    TextureCache::Entry*& e = m_flipRing[pos];
+    if (!m_texCache.update(e, frame.data, frame.width, frame.height, 0, frame.height)) {
+        // first use, different size, or also used as the comparison image
+        m_texCache.release(e);
+        e = m_texCache.add(nullptr, frame.data, frame.width, frame.height);
+        m_texCache.acquire(e);
+    }
+    ::free(frame.data);
+    if (!e) { return; }
+    m_flipRingPos = pos;
+
+    // all frames share the same view settings; only if the size changes,
+    // the geometry needs to be recomputed
+    bool resized = (e->width != m_sheetWidth) || (e->height != m_sheetHeight);
+    ::free((void*)m_fileName);
+    m_fileName = StringUtil::copy(m_flipbook.path(frame.index), 4);
+    updateWindowTitle();
+    setImageEntry(e);
+    if (resized) {
+        computePanelGeometry();
+        updateView(false);
+    }
+    updateInfo();
+}
+
+int PixelViewApp::spriteColumns() const {
+    int step = m_sprite.cellWidth + m_sprite.spacing;
+    if ((m_sprite.cellWidth < 1) || (step < 1)) { return 0; }
+    return std::max(0, (m_sheetWidth - m_sprite.margin + m_sprite.spacing) / step);
+}
+
+int PixelViewApp::spriteFrames() const {
+    if (!m_sprite.enabled || m_isANSI || !m_imgEntry) { return 0; }
+    int step = m_sprite.cellHeight + m_sprite.spacing;
+    if ((m_sprite.cellHeight < 1) || (step < 1)) { return 0; }
+    int rows = std::max(0, (m_sheetHeight - m_sprite.margin + m_sprite.spacing) / step);
+    int cells = spriteColumns() * rows - std::max(m_sprite.first, 0);
+    if (cells <= 0) { return 0; }
+    return (m_sprite.count > 0) ? std::min(m_sprite.count, cells) : cells;
+}
+
+void PixelViewApp::updateSpriteGeometry() {
+    // in sprite mode, everything (zoom, panning, the minimap etc.) works in
+    // terms of a single cell; only the texture keeps the whole sheet
+    if (spriteActive()) {
+        m_imgWidth  = m_sprite.cellWidth;
+        m_imgHeight = m_sprite.cellHeight;
+        m_spriteFrame = std::min(m_spriteFrame, spriteFrames() - 1);
+    } else {
+        m_imgWidth  = m_sheetWidth;
+        m_imgHeight = m_sheetHeight;
+        m_spriteFrame = 0;
+    }
+}
+
+void PixelViewApp::restartSpriteClock() {
+    m_spriteStart = glfwGetTime() - (double(m_spriteFrame) + 0.5) / m_sprite.fps;
+}
+
+void PixelViewApp::toggleSpriteMode() {
+    if (m_isANSI || !m_imgEntry) { return; }
+    m_sprite.enabled = !m_sprite.enabled;
+    m_spritePaused = false;
+    m_spriteFrame = 0;
+    restartSpriteClock();
+    updateSpriteGeometry();
+    computePanelGeometry();
+    viewCfg("sx");
+    updateInfo();
+    if (!m_sprite.enabled) {
+        setStatus(stSuccess, mtConst, "sprite sheet animation off");
+    } else if (!spriteActive()) {
+        setStatus(stError, mtConst, "sprite sheet grid doesn't contain any cells");
+    } else {
+        showPlaybackStatus();
+    }
+}
+
+void PixelViewApp::updateSprite(double now) {
+    int n = spriteFrames();
+    if (n <= 0) { return; }
+    if (!m_spritePaused) {
+        double t = std::floor((now - m_spriteStart) * m_sprite.fps);
+        m_spriteFrame = int(std::fmod(std::max(t, 0.0), double(n)));
+    }
+
+    // this is all there is to the animation: the cell is selected by the
+    // uCell uniform, so the texture is never touched
+    int cols = std::max(spriteColumns(), 1);
+    int cell = std::max(m_sprite.first, 0) + m_spriteFrame;
+    double sw = double(std::max(m_sheetWidth, 1)), sh = double(std::max(m_sheetHeight, 1));
+    m_spriteRect.x = double(m_sprite.margin + (cell % cols) * (m_sprite.cellWidth  + m_sprite.spacing)) / sw;
+    m_spriteRect.y = double(m_sprite.margin + (cell / cols) * (m_sprite.cellHeight + m_sprite.spacing)) / sh;
+    m_spriteRect.w = double(m_sprite.cellWidth)  / sw;
+    m_spriteRect.h = double(m_sprite.cellHeight) / sh;
+}
+
+TextureCache::Entry* PixelViewApp::loadImageFile(const char* filename, bool &tooLarge, bool async) {
+    // regular image files are looked up by path first, then by content:
+    // if another file with identical content is already in the cache
+    // (e.g. a copy in another directory), it's not decoded and uploaded again
+    tooLarge = false;
+    // if the file is currently shown and has been modified (i.e. it's being
+    // reloaded), its texture can be updated in place with only the changes;
+    // this needs to be checked before find() makes the entry unreachable
+    TextureCache::Entry* prev = (m_imgEntry && m_imgEntry->pixels && m_imgEntry->path && !strcmp(m_imgEntry->path, filename)) ? m_imgEntry : nullptr;
+    // in recursive mode, the fingerprint from the tree scan is used
+    // instead of querying it again, which is slow on network filesystems;
+    // this doesn't apply when the file on display is reloaded explicitly,
+    // because the point of that is noticing changes made after the scan
+    FileUtil::FileFingerprint scanned;
+    bool inTree = m_treeWalker.contains(filename);
+    bool shown = m_imgEntry && m_imgEntry->path && !strcmp(m_imgEntry->path, filename);
+    bool known = inTree && !shown && m_treeWalker.fingerprint(filename, scanned);
+    TextureCache::Entry* entry = m_texCache.find(filename, known ? &scanned : nullptr);
+    if (entry) { return entry; }
+    #ifndef NDEBUG
+        printf("loading image: '%s'\n", filename);
+    #endif
+    size_t size = 0;
+    HashUtil::Digest hash;
+    FileUtil::FileFingerprint fp;
+    void* file = TextureCache::loadFile(filename, size, hash, &fp, &m_readStats);
+    if (!file) { return nullptr; }
+    if (inTree) { m_treeWalker.setFingerprint(filename, fp); }
+    #ifndef NDEBUG
+        printf("read %.1f MiB in %.1f ms (%.0f MiB/s, %d thread(s))\n", double(size) / 1048576.0,
+               1000.0 * m_readStats.seconds, m_readStats.throughput() / 1048576.0, m_readStats.threads);
+    #endif
+    entry = m_texCache.findContent(filename, hash, size, &fp);
+
+    // in compression mode, a compressed version of the file may already be
+    // in the disk cache, in which case it doesn't need to be decoded at all
+    bool compress = m_compress && m_texCache.canCompress();
+    char* cacheFile = compress ? TexCompress::cachePath(hash, size) : nullptr;
+    if (!entry && cacheFile) {
+        TexCompress::Image img;
+        if (TexCompress::loadCache(cacheFile, img)) {
+            entry = m_texCache.addCompressed(filename, img);
+            m_texCache.setContent(entry, hash, size, &fp);
+        }
+    }
+
+    // large images are decoded in the background if requested; until
+    // they're done, a low-resolution preview is shown in their place
+    int width = 0, height = 0;
+    if (!entry && async && !prev && (size <= size_t(INT_MAX))
+    && stbi_info_from_memory(static_cast<const stbi_uc*>(file), int(size), &width, &height, nullptr)
+    && ((size_t(width) * size_t(height)) >= minPreviewPixels)) {
+        int pw = 0, ph = 0;
+        void* preview = ImageLoader::loadPreview(static_cast<const uint8_t*>(file), size, hash, width, height, pw, ph);
+        if (preview) {
+            entry = m_texCache.add(nullptr, preview, pw, ph);
+            ::free(preview);
+        }
+        if (!entry) {
+            // no preview available -> show a black placeholder instead
+            static const uint32_t black = 0xFF000000u;
+            entry = m_texCache.add(nullptr, static_cast<const void*>(&black), 1, 1);
+        }
+        if (entry) {
+            bool canCompress = compress && ((size_t(width) * size_t(height)) >= minCompressPixels);
+            m_loader.start(filename, file, size, hash, fp, width, height, canCompress);
+            ::free(cacheFile);
+            return entry;
+        }
+    }
+
+    if (!entry && (size <= size_t(INT_MAX))) {
+        void* data = stbi_load_from_memory(static_cast<const stbi_uc*>(file), int(size), &width, &height, nullptr, 4);
+        if (data) {
+            if (prev && m_texCache.reload(prev, filename, data, width, height)) {
+                entry = prev;
+            } else if (compress && ((size_t(width) * size_t(height)) >= minCompressPixels)
+                   && TexCompress::isOpaque(static_cast<const uint8_t*>(data), width, height)) {
+                double t0 = glfwGetTime();
+                TexCompress::Image img;
+                if (TexCompress::encode(static_cast<const uint8_t*>(data), width, height, img)) {
+                    double encodeTime = glfwGetTime() - t0;
+                    entry = m_texCache.addCompressed(filename, img);
+                    if (entry) { entry->encodeTime = encodeTime; }
+                    TexCompress::saveCache(cacheFile, img);
+                    #ifndef NDEBUG
+                        printf("compressed %dx%d image in %.0f ms\n", width, height, 1000.0 * encodeTime);
+                    #endif
+                }
+            }
+            if (!entry) { entry = m_texCache.add(filename, data, width, height); }
+            m_texCache.setContent(entry, hash, size, &fp);
+            m_texCache.retain(entry, data);  // keep the pixels for the next reload
+            tooLarge = !entry;
+        }
+    }
+    ::free(cacheFile);
+    ::free(file);
+    return entry;
+}
+
+void PixelViewApp::updateTreeNav() {
+    if (!m_treeNavOrder) { return; }
+    if (m_treeNavFrom != (m_fileName ? m_fileName : "")) {
+        m_treeNavOrder = 0;  // another file has been loaded in the meantime
+        return;
+    }
+    char* path = nullptr;
+    if (m_treeWalker.find(m_fileName, m_treeNavAbsolute, m_treeNavOrder, path) == TreeWalker::FindResult::Pending) {
+        return;  // try again in the next frame
+    }
+    m_treeNavOrder = 0;
+    #ifndef NDEBUG
+        printf("tree walker: %s '%s'\n", path ? "found" : "no file next to", path ? path : (m_fileName ? m_fileName : "(none)"));
+    #endif
+    if (path) { loadImage(path); }
+    ::free(path);
+}
+
 void PixelViewApp::unloadImage() {
-    m_imgWidth = m_imgHeight = 0;
-    glBindTexture(GL_TEXTURE_2D, m_tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    setImageEntry(nullptr);
     updateInfo();
 }
 
+void PixelViewApp::setImageEntry(TextureCache::Entry* entry) {
+    m_texCache.acquire(entry);
+    m_texCache.release(m_imgEntry);
+    m_imgEntry = entry;
+    m_sheetWidth  = entry ? entry->width  : 0;
+    m_sheetHeight = entry ? entry->height : 0;
+    updateSpriteGeometry();
+}
+
+void PixelViewApp::loadCompareImage(const char* filename) {
+    // the comparison image is always loaded with default settings; since
+    // it shares the view state with the main image, it's stretched to the
+    // main image's geometry if the sizes differ
+    TextureCache::Entry* entry = nullptr;
+    if (StringUtil::checkExt(filename, ANSILoader::fileExts)) {
+        int width = 0, height = 0;
+        #ifndef NDEBUG
+            printf("loading comparison ANSI file: '%s'\n", filename);
+        #endif
+        ANSILoader ansi;
+        ansi.loadDefaults();
+        void* data = ansi.render(filename, width, height);
+        if (data) {
+            entry = m_texCache.add(nullptr, data, width, height, true);
+            ::free(data);
+        }
+    } else {
+        bool tooLarge;
+        entry = loadImageFile(filename, tooLarge);
+    }
+    if (!entry) {
+        setStatus(stError, mtSteal, StringUtil::concat("failed to load comparison image: ", StringUtil::pathBaseName(filename)));
+        return;
+    }
+    setCompareEntry(entry);
+    if (m_compareMode == cmOff) { m_compareMode = cmSideBySide; }
+}
+
+void PixelViewApp::setCompareEntry(TextureCache::Entry* entry) {
+    m_texCache.acquire(entry);
+    m_texCache.release(m_cmpEntry);
+    m_cmpEntry = entry;
+    if (!entry) { m_compareMode = cmOff; }
+}
+
+void PixelViewApp::cycleCompareMode() {
+    if (!m_cmpEntry) {
+        // no comparison image yet -> use a snapshot of the current image,
+        // e.g. to compare it against a re-rendered version with other settings
+        // (but not if it's only a preview)
+        if (!m_imgEntry || m_loader.pending()) { return; }
+        setCompareEntry(m_imgEntry);
+        m_compareMode = cmSideBySide;
+        setStatus(stSuccess, mtConst, "using the current image as comparison reference");
+        return;
+    }
+    m_compareMode = CompareMode((int(m_compareMode) + 1) % 3);
+}
+
+void PixelViewApp::swapCompareImages() {
+    if (!m_cmpEntry || !m_imgEntry || m_loader.pending()) { return; }
+    TextureCache::Entry* e = m_cmpEntry;
+    m_texCache.acquire(e);
+    setCompareEntry(m_imgEntry);
+    setImageEntry(e);
+    m_texCache.release(e);
+    computePanelGeometry();
+    updateView(false);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // MARK: config & nav
 ///////////////////////////////////////////////////////////////////////////////
@@ -819,6 +2114,17 @@ void PixelViewApp::saveConfig() {
 }
 
 void PixelViewApp::loadSibling(bool absolute, int order) {
+    if (m_treeWalker.contains(m_fileName)) {
+        // recursive mode: navigate through the whole directory tree; if the
+        // scanner hasn't got to the requested file yet, the navigation is
+        // finished later by updateTreeNav(), so the UI never freezes
+        m_treeNavAbsolute = absolute;
+        m_treeNavOrder = order;
+        m_treeNavFrom = m_fileName;
+        updateTreeNav();
+        return;
+    }
+
     const char* dirName = StringUtil::pathDirName(m_fileName);
     if (!dirName) { return; }
     #ifndef NDEBUG
@@ -839,12 +2145,7 @@ void PixelViewApp::loadSibling(bool absolute, int order) {
     };
 
     while (dir.nextNonDot()) {
-        bool ok = !dir.currentItemIsDir();
-        if (ok) {
-            uint32_t ext = StringUtil::extractExtCode(dir.currentItemName());
-            ok = StringUtil::checkExt(ext, imageFileExts)
-              || StringUtil::checkExt(ext, ANSILoader::fileExts);
-        }
+        bool ok = !dir.currentItemIsDir() && isImageFileName(dir.currentItemName());
         if (ok && (compareName(m_fileName) != order)) {
             ok = false;  // item is on the "wrong" side of the current file
         }
@@ -910,8 +2211,8 @@ void PixelViewApp::updateView(bool usePivot, double pivotX, double pivotY) {
     double pivotRelY = (m_viewHeight > 1.0) ? ((pivotY - m_y0) / m_viewHeight) : 0.5;
 
     // compute raw image size with aspect ratio correction
-    double rawWidth  = m_imgWidth  * std::max(m_aspect, 1.0);
-    double rawHeight = m_imgHeight / std::min(m_aspect, 1.0);
+    double rawWidth  = viewImgWidth()  * std::max(viewAspect(), 1.0);
+    double rawHeight = viewImgHeight() / std::min(viewAspect(), 1.0);
     bool isInt = wantIntegerZoom();
     bool autofit = (m_viewMode == vmFit) || (m_viewMode == vmFill);
     #ifdef DEBUG_UPDATE_VIEW
@@ -1001,8 +2302,8 @@ void PixelViewApp::computePanelGeometry() {
     m_panelAreas.clear();
 
     // compute raw image size with aspect ratio correction
-    double rawMajor = m_imgWidth * m_aspect;
-    double rawMinor = m_imgHeight;
+    double rawMajor = viewImgWidth() * viewAspect();
+    double rawMinor = viewImgHeight();
     double dispMajor = m_screenWidth;
     double dispMinor = m_screenHeight;
 
@@ -1066,5 +2367,30 @@ void PixelViewApp::updateInfo() {
         sprintf(size, " (%dx%d)", m_imgWidth, m_imgHeight);
         status = size;
     }
+    if (m_imgEntry && m_imgEntry->compressedBytes && (m_imgWidth > 0) && (m_imgHeight > 0)) {
+        static char size[160];
+        double saved = double(m_imgEntry->uncompressedBytes() - m_imgEntry->compressedBytes) / 1048576.0;
+        if (m_imgEntry->encodeTime > 0.0) {
+            snprintf(size, sizeof(size), " (%dx%d, DXT1, encoded in %.0f ms, %.1f MiB saved)", m_imgWidth, m_imgHeight, 1000.0 * m_imgEntry->encodeTime, saved);
+        } else {
+            snprintf(size, sizeof(size), " (%dx%d, DXT1 from disk cache, %.1f MiB saved)", m_imgWidth, m_imgHeight, saved);
+        }
+        status = size;
+    }
+    if (m_flipbook.active() && (m_flipbook.current() >= 0) && (m_imgWidth > 0) && (m_imgHeight > 0)) {
+        static char size[80];
+        snprintf(size, sizeof(size), " (%dx%d, frame %d / %d)", m_imgWidth, m_imgHeight, m_flipbook.current() + 1, m_flipbook.count());
+        status = size;
+    }
+    if (spriteActive()) {
+        static char size[80];
+        snprintf(size, sizeof(size), " (%dx%d cells of %dx%d sheet, %d frames)", m_imgWidth, m_imgHeight, m_sheetWidth, m_sheetHeight, spriteFrames());
+        status = size;
+    }
+    if (m_loader.pending() && (m_imgWidth > 0) && (m_imgHeight > 0)) {
+        static char size[64];
+        snprintf(size, sizeof(size), " (%dx%d, loading ...)", m_imgWidth, m_imgHeight);
+        status = size;
+    }
     m_infoStr = StringUtil::concat(StringUtil::pathBaseName(m_fileName), status);
 }
@@ -12,6 +12,14 @@
 #include "imgui.h"
 
 #include "ansi_loader.h"
+#include "ansi_stream.h"
+#include "term_player.h"
+#include "upscaler.h"
+#include "texture_cache.h"
+#include "tree_walker.h"
+#include "dir_follower.h"
+#include "image_loader.h"
+#include "flipbook.h"
 
 class PixelViewApp {
     // GLFW and ImGui stuff
@@ -19,10 +27,26 @@ class PixelViewApp {
     ImGuiIO* m_io = nullptr;
 
     // rendering stuff
-    GLuint m_tex = 0;
-    GLutil::Program m_prog;
-    GLint m_locArea;
-    GLint m_locSize;
+    TextureCache m_texCache;
+    TextureCache::Entry* m_imgEntry = nullptr;  //!< texture of the main image
+    TextureCache::Entry* m_cmpEntry = nullptr;  //!< texture of the comparison image
+    struct DisplayProgram {
+        GLutil::Program prog;
+        GLint locArea    = -1;
+        GLint locSize    = -1;
+        GLint locOrient  = -1;
+        GLint locShift   = -1;
+        GLint locSizeB   = -1;
+        GLint locCompare = -1;
+        GLint locSplit   = -1;
+        GLint locCell    = -1;
+        GLint locCellLod = -1;
+    };
+    //! part of a texture, in texture coordinates (0...1)
+    struct TexRect { double x, y, w, h; };
+    DisplayProgram m_prog;      //!< regular display program
+    DisplayProgram m_areaProg;  //!< exact area-averaging program for static minified views
+    Upscaler m_upscaler;
 
     // UI state
     bool m_fullscreen = false;
@@ -32,13 +56,25 @@ class PixelViewApp {
     bool m_showHelp = false;
     bool m_showConfig = false;
     bool m_showInfo = false;
+    bool m_showTiming = false;
+    bool m_showMinimap = false;
     bool m_showDemo = false;
     inline bool anyUIvisible() const { return m_showHelp || m_showConfig || m_showDemo; }
-    int m_imgWidth = 0;
+    inline bool needImGui() const { return anyUIvisible() || (m_statusType != stNone) || m_showInfo || m_showTiming || m_showMinimap; }
+    bool m_imguiInitialized = false;  //!< ImGui context and backends have been created
+    bool m_imguiActive = false;       //!< ImGui callbacks are installed and frames are built
+    int m_cursorMode = 0;             //!< GLFW cursor mode set while ImGui is inactive (0 = unknown)
+    inline bool imguiWantsKeyboard() const { return m_imguiActive && m_io->WantCaptureKeyboard; }
+    inline bool imguiWantsMouse()    const { return m_imguiActive && m_io->WantCaptureMouse; }
+    int m_imgWidth = 0;     //!< size of the displayed image (in sprite mode: size of one cell)
     int m_imgHeight = 0;
+    int m_sheetWidth = 0;   //!< size of the whole image (differs from m_imgWidth in sprite mode)
+    int m_sheetHeight = 0;
     bool m_panning = false;
     double m_panX = 0.0;
     double m_panY = 0.0;
+    double m_panCursorX = 0.0;  //!< cursor position of the last pan update
+    double m_panCursorY = 0.0;
     bool m_cursorVisible = true;
     double m_hideCursorAt = 0.0;
     enum StatusType { stNone = 0, stSuccess, stError };
@@ -49,6 +85,54 @@ class PixelViewApp {
     char* m_infoStr = nullptr;
     bool m_isANSI = false;
 
+    // comparison mode
+    enum CompareMode {
+        cmOff = 0,     //!< comparison mode disabled
+        cmSideBySide,  //!< main image on the left half, comparison image on the right half
+        cmWipe,        //!< both images at the same position, split at a movable divider
+    };
+    CompareMode m_compareMode = cmOff;
+    double m_wipePos = 0.5;       //!< wipe divider position, relative to the screen width
+    bool m_wipeDragging = false;
+    char* m_cmpFileName = nullptr;  //!< comparison image file name from the command line
+    bool m_recursive = false;       //!< navigate through subdirectories
+    TreeWalker m_treeWalker;
+    int m_treeNavOrder = 0;         //!< order of a pending tree navigation (see loadSibling(); 0 = none)
+    bool m_treeNavAbsolute = false;
+    std::string m_treeNavFrom;      //!< file shown when the pending tree navigation has been requested
+    DirFollower m_follower;         //!< shows the newest file of a directory as it appears
+    bool m_compress = false;        //!< store large opaque images as DXT1-compressed textures
+    ImageLoader m_loader;           //!< decodes large images in the background while a preview is shown
+    inline bool isComparing() const { return (m_compareMode != cmOff) && m_cmpEntry && (m_viewMode != vmPanel); }
+
+    // frame timing
+    double m_lastFrameTime   = 0.0;
+    double m_refreshInterval = 1.0 / 60;  //!< nominal refresh interval of the display
+    double m_frameInterval   = 1.0 / 60;  //!< smoothed measured frame interval
+    double m_frameDelta      = 1.0 / 60;  //!< frame interval used for animation and scrolling
+    bool m_adaptiveVsync = false;
+    bool m_canAdaptiveVsync = false;
+    bool m_lowLatency = false;  //!< sample mouse late and don't queue frames
+    double m_inputTime = 0.0;   //!< time of the input that the next frame is based on
+    struct FrameStats {
+        int    frames      = 0;
+        int    missed      = 0;    //!< number of missed vsyncs
+        double intervalSum = 0.0;
+        double intervalMax = 0.0;
+        int    latencyCount = 0;   //!< number of frames with panning input
+        double latencySum   = 0.0;
+        double latencyMax   = 0.0;
+        double cpuSum = 0.0;       //!< CPU time spent on building the frames
+        double cpuMax = 0.0;
+    };
+    FrameStats m_stats;       //!< statistics currently being collected
+    FrameStats m_statsShown;  //!< statistics of the last complete interval
+    double m_statsStart = 0.0;
+    int m_missedTotal = 0;
+    double m_cpuTime = 0.0;     //!< CPU time spent on the last frame, up to the buffer swap
+    bool m_printStats = false;  //!< print timing statistics to stdout
+    FileUtil::ReadStats m_readStats;  //!< statistics of the last file that has been read
+
     // image view settings
     enum ViewMode {
         vmFree = 0,  //!< free pan/zoom
@@ -65,7 +149,53 @@ class PixelViewApp {
     double m_x0 = 0.0;
     double m_y0 = 0.0;
     double m_scrollSpeed = 4.0;
+    Upscaler::Filter m_upscale = Upscaler::Filter::None;
     ANSILoader m_ansi;
+    ANSIStream m_stream;  //!< progressive renderer for streamed ANSI input
+    TermPlayer m_player;  //!< player for terminal session recordings
+    Flipbook m_flipbook;  //!< player for image sequences
+    static constexpr int flipRingSize = 3;
+    TextureCache::Entry* m_flipRing[flipRingSize] = {};  //!< textures that flipbook frames are uploaded into, in turn
+    int m_flipRingPos = 0;  //!< index of the ring entry on display
+
+    // sprite sheet animation: the image is divided into a grid of cells,
+    // and only one cell at a time is shown, by changing the texture
+    // coordinates in the display shader; the texture stays as it is
+    struct SpriteGrid {
+        bool   enabled    = false;
+        int    cellWidth  = 16;    //!< size of one cell in pixels
+        int    cellHeight = 16;
+        int    margin     = 0;     //!< offset of the first cell from the image's top-left corner
+        int    spacing    = 0;     //!< gap between adjacent cells
+        int    first      = 0;     //!< first cell of the animation
+        int    count      = 0;     //!< number of cells in the animation (0 = all up to the end)
+        double fps        = 10.0;  //!< animation speed
+    };
+    SpriteGrid m_sprite;
+    bool m_spritePaused = false;
+    int m_spriteFrame = 0;          //!< current cell, relative to m_sprite.first
+    double m_spriteStart = 0.0;     //!< time at which the animation was at cell 0
+    TexRect m_spriteRect = {0.0, 0.0, 1.0, 1.0};  //!< texture coordinates of the current cell
+    int spriteColumns() const;
+    int spriteFrames() const;       //!< number of cells in the animation (0 = sprite mode off)
+    inline bool spriteActive() const { return spriteFrames() > 0; }
+    inline const TexRect* spriteRect() const { return spriteActive() ? &m_spriteRect : nullptr; }
+
+    // image orientation; this is a bit mask that describes how the texture
+    // coordinates are derived from the on-screen position, so rotation and
+    // mirroring happen purely in the vertex shader
+    enum OrientationFlags {
+        orFlipX     = 1,  //!< mirror the texture X axis
+        orFlipY     = 2,  //!< mirror the texture Y axis
+        orTranspose = 4,  //!< swap texture X and Y axes (applied before mirroring)
+    };
+    int m_orient = 0;
+    int m_exifOrient = 0;      //!< orientation derived from EXIF data
+    bool m_orientSet = false;  //!< orientation has been set by the config file
+    inline bool isTransposed() const { return !!(m_orient & orTranspose); }
+    inline int viewImgWidth()  const { return isTransposed() ? m_imgHeight : m_imgWidth;  }
+    inline int viewImgHeight() const { return isTransposed() ? m_imgWidth  : m_imgHeight; }
+    inline double viewAspect() const { return isTransposed() ? (1.0 / m_aspect) : m_aspect; }
 
     // image view state
     double m_screenWidth  = 0.0;
@@ -76,6 +206,7 @@ class PixelViewApp {
     double m_minY0 = 0.0;
     double m_scrollX = 0.0;
     double m_scrollY = 0.0;
+    double m_scrollAccum = 0.0;  //!< sub-pixel part of the scroll position
     double m_minZoom = 1.0/16;
     struct Area { double m[4]; };
     Area m_currentArea = {{2.0, -2.0, -1.0, 1.0}};
@@ -87,20 +218,66 @@ class PixelViewApp {
     inline bool canUsePanelMode() const { return !m_panelAreas.empty(); }
     inline bool wantIntegerZoom() const { return m_integer && canDoIntegerZoom(); }
     inline bool isScrolling() const { return (m_scrollX != 0.0) || (m_scrollY != 0.0); }
+
+    // area-filtered downscaling cache: once the view has been static for a
+    // moment, the area-averaged image is rendered into a screen-sized texture
+    // that is then displayed instead of running the display shader
+    struct ViewState {
+        GLuint tex = 0;
+        uint32_t serial = 0;
+        int texWidth = 0, texHeight = 0;
+        int orient = 0;
+        int screenWidth = 0, screenHeight = 0;
+        TexRect rect = {0.0, 0.0, 1.0, 1.0};
+        std::vector<Area> areas;
+    };
+    ViewState m_lastView;
+    double m_viewChangedAt = 0.0;
+    bool m_areaCacheValid = false;
+    GLutil::FBO m_areaFBO;
+    GLuint m_areaTex = 0;
+    int m_areaTexWidth = 0;
+    int m_areaTexHeight = 0;
     struct WindowGeometry {
         int xpos,  ypos;
         int width, height;
     } m_windowGeometry;
 
     // main functions
-    inline bool imgValid() const { return (m_imgWidth > 0) && (m_imgHeight > 0); }
+    inline bool imgValid() const { return m_imgEntry && (m_imgWidth > 0) && (m_imgHeight > 0); }
     void loadSibling(bool absolute, int order);
     void loadImage(const char* filename);
     void loadImage(bool soft=false);
     void loadConfig(const char* filename, double &relX, double &relY);
+    int runExport(const char* outPath, bool jpeg);
+    int runBenchmark(const char* resolutions);
     void saveConfig();
     bool saveConfig(const char* filename);
     void unloadImage();
+    void updateStream();
+    void updateFollower();
+    void updateLoader();
+    void updateTreeNav();
+    void updateWindowTitle();
+    void updatePlayer(double now);
+    void togglePlayback();
+    void seekPlayback(double delta);
+    void changePlaybackSpeed(double factor);
+    void showPlaybackStatus();
+    void startFlipbook();
+    void stopFlipbook();
+    void updateFlipbook(double now);
+    void toggleFlipbookMode();
+    void updateSprite(double now);
+    void updateSpriteGeometry();
+    void restartSpriteClock();
+    void toggleSpriteMode();
+    void setImageEntry(TextureCache::Entry* entry);
+    TextureCache::Entry* loadImageFile(const char* filename, bool &tooLarge, bool async=false);
+    void loadCompareImage(const char* filename);
+    void setCompareEntry(TextureCache::Entry* entry);
+    void cycleCompareMode();
+    void swapCompareImages();
     void updateInfo();
     void updateView(bool usePivot, double pivotX, double pivotY);
     void setArea(Area& a, double x0, double y0, double vw, double vh);
@@ -109,6 +286,10 @@ class PixelViewApp {
     void cursorPan(double dx, double dy, int mods);
     void cycleViewMode(bool with1x);
     void cycleTopView();
+    void rotateView(bool ccw);
+    void mirrorView(bool vertical);
+    static int orientFromEXIF(int exif);
+    static int orientToEXIF(int orient);
     void changeZoom(double direction, double pivotX, double pivotY);
     inline void changeZoom(double direction) { changeZoom(direction, m_screenWidth * 0.5, m_screenHeight * 0.5); }
     void startScroll(double speed, double dx, double dy);
@@ -116,6 +297,17 @@ class PixelViewApp {
     inline void startScroll(double speed) { startScroll(speed, 0.0, 0.0); }
     inline void startScroll(double dx, double dy) { startScroll(0.0, dx, dy); }
     void updateScreenSize();
+    bool initRendering();
+    void doneRendering();
+    void drawContent(double now, bool useAreaCache=true);
+    bool linkDisplayProgram(DisplayProgram& p, const char* name, const char* fsSrc);
+    void drawImage(const DisplayProgram& p, GLuint tex, int texWidth, int texHeight, int orient, const Area* areas, int count, const TextureCache::Entry* cmp=nullptr, const TexRect* rect=nullptr);
+    bool drawAreaCache(double now, GLuint tex, int texWidth, int texHeight, const Area* areas, int count);
+    void updateRefreshRate(const GLFWvidmode* mode);
+    void updateSwapInterval();
+    void updateFrameTiming(double now);
+    void initImGui();
+    void setImGuiActive(bool active);
     void toggleFullscreen();
     void updateCursor(bool startTimeout=false);
     enum StatusMessageType { mtConst, mtCopy, mtSteal };
@@ -138,11 +330,14 @@ class PixelViewApp {
     void uiConfigWindow();
     void uiStatusWindow();
     void uiInfoWindow();
+    void uiTimingWindow();
+    void uiMinimap();
 
     // event handling
     void handleKeyEvent(int key, int scancode, int action, int mods);
     void handleMouseButtonEvent(int button, int action, int mods);
     void handleCursorPosEvent(double xpos, double ypos);
+    void updatePan(double xpos, double ypos);
     void handleScrollEvent(double xoffset, double yoffset);
     void handleDropEvent(int path_count, const char* paths[]);
     void handleResizeEvent(int width, int height);
@@ -0,0 +1,251 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#ifdef _MSC_VER
+    #define _CRT_SECURE_NO_WARNINGS  // prevent MSVC warnings
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <vector>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include "gl_header.h"
+#include "gl_util.h"
+
+#include "string_util.h"
+#include "version.h"
+
+#include "app.h"
+
+static constexpr int    benchWarmupFrames = 3;    // frames rendered before measuring (shader and mipmap setup)
+static constexpr int    benchMinFrames    = 10;   // minimum number of measured frames per mode
+static constexpr double benchMinTime      = 0.5;  // minimum measurement time per mode (seconds)
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! parse a single output resolution: either WIDTHxHEIGHT or a common
+//! shorthand like 1080p, 4K or 8K
+static bool parseResolution(const char* s, int &width, int &height) {
+    static const struct { const char* name; int width, height; } presets[] = {
+        { "720p",  1280,  720 },
+        { "1080p", 1920, 1080 },
+        { "1440p", 2560, 1440 },
+        { "2160p", 3840, 2160 }, { "4k", 3840, 2160 },
+        { "4320p", 7680, 4320 }, { "8k", 7680, 4320 },
+    };
+    for (const auto& p : presets) {
+        if (!StringUtil::compareCI(s, p.name)) {
+            width  = p.width;
+            height = p.height;
+            return true;
+        }
+    }
+    char* end = nullptr;
+    width = int(::strtol(s, &end, 10));
+    if (!end || (StringUtil::ce_tolower(*end) != 'x')) { return false; }
+    height = int(::strtol(&end[1], &end, 10));
+    return end && !*end && (width > 0) && (height > 0);
+}
+
+int PixelViewApp::runBenchmark(const char* resolutions) {
+    if (!m_fileName) {
+        fprintf(stderr, "no input file specified for benchmark\n");
+        return 1;
+    }
+
+    // parse the list of output resolutions
+    struct Resolution { int width, height; };
+    std::vector<Resolution> outputs;
+    char* list = StringUtil::copy(resolutions);
+    for (char* tok = list;  tok && *tok;) {
+        char* next = strchr(tok, ',');
+        if (next) { *next++ = '\0'; }
+        Resolution r;
+        if (!parseResolution(tok, r.width, r.height)) {
+            fprintf(stderr, "invalid benchmark resolution '%s'\n", tok);
+            ::free(list);
+            return 1;
+        }
+        outputs.push_back(r);
+        tok = next;
+    }
+    ::free(list);
+    if (outputs.empty()) {
+        fprintf(stderr, "no benchmark resolution specified\n");
+        return 1;
+    }
+
+    // create an invisible window, just to get an OpenGL context; all
+    // rendering goes into an offscreen framebuffer, so neither the window
+    // size nor vsync have any influence on the results
+    if (!glfwInit()) {
+        const char* err = "unknown error";
+        glfwGetError(&err);
+        fprintf(stderr, "glfwInit failed: %s\n", err);
+        return 1;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    #ifndef NDEBUG
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+    #endif
+    m_window = glfwCreateWindow(64, 64, PRODUCT_NAME " benchmark", nullptr, nullptr);
+    if (m_window == nullptr) {
+        const char* err = "unknown error";
+        glfwGetError(&err);
+        fprintf(stderr, "glfwCreateWindow failed: %s\n", err);
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(m_window);
+    glfwSwapInterval(0);
+    if (!initRendering()) {
+        glfwDestroyWindow(m_window);
+        glfwTerminate();
+        return 1;
+    }
+    int maxTexSize = 0, maxViewport[2] = { 0, 0 };
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    printf("renderer: %s, OpenGL %s\n", reinterpret_cast<const char*>(glGetString(GL_RENDERER)),
+                                        reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+    // load the image with its saved view settings (orientation, aspect
+    // ratio, upscaling etc.); large images are decoded in the background,
+    // and the benchmark must not measure the preview
+    m_screenWidth  = outputs[0].width;
+    m_screenHeight = outputs[0].height;
+    loadImage();
+    while (m_loader.pending()) {
+        glfwWaitEventsTimeout(0.01);
+        updateLoader();
+    }
+    bool ok = imgValid();
+    if (!ok) {
+        fprintf(stderr, "failed to load image '%s'\n", m_fileName);
+    } else {
+        printf("image: '%s', %dx%d pixels%s\n", m_fileName, m_imgWidth, m_imgHeight,
+               (m_imgEntry && m_imgEntry->compressedBytes) ? " (DXT1)" : "");
+    }
+
+    // the sweep: all view modes, and a few zoom levels in free mode
+    static const struct { const char* name; ViewMode mode; bool integer; double zoom; } modes[] = {
+        { "fit",           vmFit,   false, 0.0  },
+        { "fit, integer",  vmFit,   true,  0.0  },
+        { "fill",          vmFill,  false, 0.0  },
+        { "fill, integer", vmFill,  true,  0.0  },
+        { "free",          vmFree,  false, 0.25 },
+        { "free",          vmFree,  false, 0.5  },
+        { "free",          vmFree,  false, 1.0  },
+        { "free",          vmFree,  false, 2.0  },
+        { "free",          vmFree,  false, 8.0  },
+        { "panel",         vmPanel, false, 0.0  },
+    };
+
+    GLuint target = 0, query = 0;
+    glGenTextures(1, &target);
+    glGenQueries(1, &query);
+    GLutil::FBO fbo;
+    fbo.init();
+    GLutil::clearError();
+    for (const auto& out : outputs) {
+        if (!ok) { break; }
+        printf("\n%dx%d output:\n", out.width, out.height);
+        if ((out.width > maxTexSize) || (out.height > maxTexSize) || (out.width > maxViewport[0]) || (out.height > maxViewport[1])) {
+            printf("  skipped, exceeds the maximum framebuffer size of the OpenGL implementation\n");
+            continue;
+        }
+        glBindTexture(GL_TEXTURE_2D, target);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, out.width, out.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        if (!fbo.begin(target)) {
+            printf("  skipped, failed to create the offscreen framebuffer\n");
+            GLutil::clearError();
+            continue;
+        }
+        glViewport(0, 0, out.width, out.height);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        m_screenWidth  = out.width;
+        m_screenHeight = out.height;
+        computePanelGeometry();
+        printf("  %-14s %9s %9s %9s %9s\n", "mode", "zoom", "fps", "CPU ms", "GPU ms");
+
+        for (const auto& m : modes) {
+            if ((m.mode == vmPanel) && !canUsePanelMode()) {
+                printf("  %-14s (not available for this image and output size)\n", m.name);
+                continue;
+            }
+
+            // set up the view, centered, without any animation
+            m_viewMode = m.mode;
+            m_integer = m.integer;
+            if (m.zoom > 0.0) { m_zoom = m.zoom; }
+            updateView(false);
+            m_x0 = 0.5 * m_minX0;
+            m_y0 = 0.5 * m_minY0;
+            updateView(false);
+            m_animate = false;
+            m_currentArea = m_targetArea;
+
+            // the area filter cache is bypassed, as the numbers shall reflect
+            // the cost of every frame while the view is moving; also, each
+            // frame is finished before the next one is started, just like
+            // the swap chain would enforce it
+            for (int i = 0;  i < benchWarmupFrames;  ++i) {
+                glClear(GL_COLOR_BUFFER_BIT);
+                drawContent(glfwGetTime(), false);
+            }
+            glFinish();
+            // the GPU time is measured for each frame separately, so the
+            // idle time between the frames isn't included; as each frame is
+            // finished anyway, reading the query result doesn't stall
+            int frames = 0;
+            double cpuTime = 0.0, t0 = glfwGetTime();
+            GLuint64 gpuTime = 0;
+            do {
+                double f0 = glfwGetTime();
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                glClear(GL_COLOR_BUFFER_BIT);
+                drawContent(f0, false);
+                glEndQuery(GL_TIME_ELAPSED);
+                cpuTime += glfwGetTime() - f0;
+                glFinish();
+                GLuint64 frameTime = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &frameTime);
+                gpuTime += frameTime;
+                ++frames;
+            } while ((frames < benchMinFrames) || ((glfwGetTime() - t0) < benchMinTime));
+            double wallTime = glfwGetTime() - t0;
+            if (GLutil::checkError("benchmark")) {
+                printf("  %-14s FAILED (OpenGL error)\n", m.name);
+                ok = false;
+                break;
+            }
+            printf("  %-14s %8.3fx %9.1f %9.3f %9.3f\n", m.name, m_zoom,
+                   double(frames) / wallTime, 1000.0 * cpuTime / frames, 1E-6 * double(gpuTime) / frames);
+            fflush(stdout);
+        }
+        fbo.end();
+    }
+
+    // clean up
+    fbo.free();
+    glDeleteQueries(1, &query);
+    glDeleteTextures(1, &target);
+    m_loader.stop();
+    ::free((void*)m_fileName);
+    m_fileName = nullptr;
+    ::free((void*)m_infoStr);
+    m_infoStr = nullptr;
+    clearStatus();
+    doneRendering();
+    glfwDestroyWindow(m_window);
+    glfwTerminate();
+    return ok ? 0 : 1;
+}
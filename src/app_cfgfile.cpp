@@ -101,6 +101,9 @@ void PixelViewApp::loadConfig(const char* filename, double &relX, double &relY)
             else if (!strcmp(value, "panel")) { m_viewMode = vmPanel; }
             else                              { invalidValue();       }
         }
+        else if (!strcmp(key, "upscale")) {
+            if (!Upscaler::filterFromID(value, m_upscale)) { invalidValue(); }
+        }
         if (!strcmp(key, "integer")) {
                  if (!strcmp(value, "yes") || !strcmp(value, "true")  || !strcmp(value, "on")  || (isFloat && (fval != 0.0))) { m_integer = true;  }
             else if (!strcmp(value, "no")  || !strcmp(value, "false") || !strcmp(value, "off") || (isFloat && (fval == 0.0))) { m_integer = false; }
@@ -112,6 +115,14 @@ void PixelViewApp::loadConfig(const char* filename, double &relX, double &relY)
         else if (!strcmp(key, "relx")        && needFloat(0.0, 100.0)) {   relX        = fval * 0.01; }
         else if (!strcmp(key, "rely")        && needFloat(0.0, 100.0)) {   relY        = fval * 0.01; }
         else if (!strcmp(key, "scrollspeed") && needFloat(0.0, 1E+10)) { m_scrollSpeed = fval; }
+        else if (!strcmp(key, "orientation") && needFloat(1.0,   8.0)) { m_orient      = orientFromEXIF(int(fval)); m_orientSet = true; }
+        else if (!strcmp(key, "sprite_width")   && needFloat(1.0, 65536.0)) { m_sprite.cellWidth  = int(fval); m_sprite.enabled = true; }
+        else if (!strcmp(key, "sprite_height")  && needFloat(1.0, 65536.0)) { m_sprite.cellHeight = int(fval); m_sprite.enabled = true; }
+        else if (!strcmp(key, "sprite_margin")  && needFloat(0.0, 65536.0)) { m_sprite.margin     = int(fval); m_sprite.enabled = true; }
+        else if (!strcmp(key, "sprite_spacing") && needFloat(0.0, 65536.0)) { m_sprite.spacing    = int(fval); m_sprite.enabled = true; }
+        else if (!strcmp(key, "sprite_first")   && needFloat(0.0,   1E+9))  { m_sprite.first      = int(fval); m_sprite.enabled = true; }
+        else if (!strcmp(key, "sprite_count")   && needFloat(0.0,   1E+9))  { m_sprite.count      = int(fval); m_sprite.enabled = true; }
+        else if (!strcmp(key, "sprite_fps")     && needFloat(0.5,  240.0))  { m_sprite.fps        = fval;      m_sprite.enabled = true; }
         else if (!strncmp(key, "ansi_", 5)   && needInt()) {
             switch (m_ansi.setOption(&key[5], ival)) {
                 case ANSILoader::SetOptionResult::UnknownOption:
@@ -166,6 +177,20 @@ bool PixelViewApp::saveConfig(const char* filename) {
         fprintf(f, "rely %.1f\n", std::min(100.0, std::max(0.0, (m_minY0 >= 0.0) ? 50.0 : (100.0 * m_y0 / m_minY0))));
     }
     fprintf(f, "scrollspeed %.0f\n", m_scrollSpeed);
+    if (m_orient != m_exifOrient) {
+        fprintf(f, "orientation %d\n", orientToEXIF(m_orient));
+    }
+    if (m_upscale != Upscaler::Filter::None) {
+        fprintf(f, "upscale %s\n", Upscaler::filterID(m_upscale));
+    }
+    if (m_sprite.enabled && !m_isANSI) {
+        fprintf(f, "sprite_width %d\nsprite_height %d\n", m_sprite.cellWidth, m_sprite.cellHeight);
+        if (m_sprite.margin)  { fprintf(f, "sprite_margin %d\n",  m_sprite.margin); }
+        if (m_sprite.spacing) { fprintf(f, "sprite_spacing %d\n", m_sprite.spacing); }
+        if (m_sprite.first)   { fprintf(f, "sprite_first %d\n",   m_sprite.first); }
+        if (m_sprite.count)   { fprintf(f, "sprite_count %d\n",   m_sprite.count); }
+        fprintf(f, "sprite_fps %g\n", m_sprite.fps);
+    }
     if (m_isANSI) {
         m_ansi.saveConfig(f);
     }
@@ -1,7 +1,10 @@
 // SPDX-FileCopyrightText: 2021-2022 Martin J. Fiedler <keyj@emphy.de>
 // SPDX-License-Identifier: MIT
 
+#include <cstdint>
+
 #include <algorithm>
+#include <utility>
 
 #include "imgui.h"
 
@@ -15,12 +18,19 @@ static const char* helpText[] = {
     "F1",                  "show/hide help window",
     "F2 or Tab",           "show/hide display configuration window",
     "F3",                  "show/hide filename display",
+    "F4",                  "show/hide timing statistics",
+    "M",                   "show/hide overview minimap",
     "F5",                  "reload current image",
     "F10 or Q or 2x Esc",  "quit application immediately",
     "F or Numpad *",       "toggle fit-to-screen / fill-screen mode",
     "Z or Numpad /",       "toggle 1:1 view / fit-to-screen mode",
     "T",                   "set 1:1 view / fill-screen and show top-left corner",
     "I",                   "toggle integer scaling",
+    "R / Shift+R",         "rotate clockwise / counter-clockwise",
+    "H / V",               "mirror horizontally / vertically",
+    "C",                   "cycle comparison mode (off / side by side / wipe)",
+    "X",                   "swap main and comparison image",
+    "right mouse button",  "move wipe divider (in wipe comparison mode)",
     "+/- or mouse wheel",  "zoom in/out",
     "left mouse button",   "move visible area",
     "middle mouse button", "move visible area",
@@ -32,7 +42,14 @@ static const char* helpText[] = {
     "1...9",               "set auto-scroll speed, start scrolling in auto direction",
     "Home / End",          "move to upper-left / lower-right corner",
     "Ctrl+S or F6",        "save view settings for the current file",
-    "Explorer Drag&Drop",  "load another image",
+    "Space or K",          "pause/resume playback of terminal recordings, sequences or sprites",
+    "J / L",               "seek backward / forward by 10 seconds (Shift: 1 minute)",
+    "",                    "or by 1 frame (Shift: 10 frames) in sequences and sprites",
+    "U / O",               "decrease / increase playback speed",
+    "B",                   "start/stop image sequence (flipbook) playback",
+    "Shift+B",             "toggle loop / ping-pong flipbook playback",
+    "G",                   "toggle sprite sheet animation",
+    "Explorer Drag&Drop",  "load another image (two images: compare them)",
     "PageUp / PageDown",   "load previous / next image file from the current directory",
     "Ctrl+Home / Ctrl+End","load first / last image file in the current directory",
     nullptr
@@ -85,6 +102,38 @@ void PixelViewApp::uiConfigWindow() {
             ImGui::EndPopup();
         }
 
+        ImGui::AlignTextToFramePadding();
+        ImGui::TextUnformatted("orientation:");
+        ImGui::SameLine(); if (ImGui::Button("rotate left"))  { rotateView(true);  }
+        ImGui::SameLine(); if (ImGui::Button("rotate right")) { rotateView(false); }
+        ImGui::SameLine(); if (ImGui::Button("mirror"))       { mirrorView(false); }
+        if (m_exifOrient) {
+            ImGui::SameLine(); ImGui::BeginDisabled(m_orient == m_exifOrient);
+            if (ImGui::Button("reset to EXIF")) { m_orient = m_exifOrient; computePanelGeometry(); viewCfg("sx"); }
+            ImGui::EndDisabled();
+        }
+
+        if (ImGui::BeginCombo("upscaling filter", Upscaler::filterName(m_upscale))) {
+            for (i = 0;  i < Upscaler::numFilters;  ++i) {
+                Upscaler::Filter filter = Upscaler::Filter(i);
+                bool isCurrent = (filter == m_upscale);
+                if (ImGui::Selectable(Upscaler::filterName(filter), isCurrent)) { m_upscale = filter; }
+                if (isCurrent) { ImGui::SetItemDefaultFocus(); }
+            }
+            ImGui::EndCombo();
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("edge-aware pixel art upscaling; computed once per image, not per frame");
+        }
+
+        ImGui::BeginDisabled(!m_texCache.canCompress());
+        b = m_compress && m_texCache.canCompress();
+        if (ImGui::Checkbox("compress large photos", &b)) { m_compress = b; }
+        ImGui::EndDisabled();
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("store opaque images with 1 megapixel or more as DXT1 textures (8x less video memory,\nslightly lower quality); takes effect for images loaded afterwards");
+        }
+
         i = int(m_maxCrop * 100.0 + 0.5);
         ImGui::BeginDisabled(!m_integer);
         if (ImGui::SliderInt("max. crop", &i, 0, 50, "%d%%")) { m_maxCrop = 0.01 * i; viewCfg("sa"); }
@@ -112,12 +161,106 @@ void PixelViewApp::uiConfigWindow() {
         posSlider(m_y0, m_minY0, "Y position");
 
         i = int(m_scrollSpeed + 0.5);
-        if (ImGui::SliderInt("scroll speed", &i, 1, 200, "%d px/frame")) { m_scrollSpeed = i; }
+        if (ImGui::SliderInt("scroll speed", &i, 1, 200, "%d px/frame @ 60 Hz")) { m_scrollSpeed = i; }
+
+        ImGui::BeginDisabled(!m_canAdaptiveVsync);
+        if (ImGui::Checkbox("adaptive vsync", &m_adaptiveVsync)) { updateSwapInterval(); }
+        ImGui::EndDisabled();
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip(m_canAdaptiveVsync ? "present late frames immediately (with tearing) instead of waiting for the next vsync"
+                                                 : "not supported by the OpenGL driver");
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("low-latency panning", &m_lowLatency);
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("sample the mouse position right before drawing and prevent the driver from queueing frames");
+        }
+
+        if (m_player.loaded()) {
+            ImGui::Dummy(ImVec2(0.0f, 10.0f));
+            if (ImGui::CollapsingHeader("terminal recording playback", ImGuiTreeNodeFlags_DefaultOpen)) {
+                if (ImGui::Button(m_player.paused ? "play" : "pause")) { togglePlayback(); }
+                ImGui::SameLine();
+                f = float(m_player.position());
+                if (ImGui::SliderFloat("position", &f, 0.0f, float(m_player.duration()), "%.1f s")) { m_player.seek(f); }
+                f = float(m_player.speed);
+                if (ImGui::SliderFloat("playback speed", &f, 1.0f / 16, 64.0f, "%.3gx", ImGuiSliderFlags_Logarithmic)) { m_player.speed = f; }
+            }
+        }
+
+        if (m_flipbook.active()) {
+            ImGui::Dummy(ImVec2(0.0f, 10.0f));
+            if (ImGui::CollapsingHeader("image sequence playback", ImGuiTreeNodeFlags_DefaultOpen)) {
+                if (ImGui::Button(m_flipbook.paused ? "play" : "pause")) { togglePlayback(); }
+                ImGui::SameLine();
+                i = m_flipbook.current() + 1;
+                if (ImGui::SliderInt("frame", &i, 1, m_flipbook.count())) { m_flipbook.seek(i - 1); }
+                f = float(m_flipbook.fps);
+                if (ImGui::SliderFloat("frame rate", &f, 1.0f, 240.0f, "%.3g fps", ImGuiSliderFlags_Logarithmic)) {
+                    m_flipbook.fps = f;
+                    m_flipbook.resync();
+                }
+                if (ImGui::Checkbox("ping-pong", &m_flipbook.pingPong)) { m_flipbook.resync(); }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("play forward and backward alternately instead of looping");
+                }
+            }
+        }
+
+        if (!m_isANSI && m_imgEntry) {
+            ImGui::Dummy(ImVec2(0.0f, 10.0f));
+            if (ImGui::CollapsingHeader("sprite sheet animation", m_sprite.enabled ? ImGuiTreeNodeFlags_DefaultOpen : 0)) {
+                bool changed = false;
+                if (ImGui::Checkbox("animate", &m_sprite.enabled)) { m_spriteFrame = 0;  restartSpriteClock();  changed = true; }
+                ImGui::SameLine();
+                ImGui::BeginDisabled(!spriteActive());
+                if (ImGui::Button(m_spritePaused ? "play" : "pause")) { togglePlayback(); }
+                ImGui::EndDisabled();
+                ImGui::SameLine();
+                ImGui::Text("%d cells", spriteFrames());
+                int cell[2] = { m_sprite.cellWidth, m_sprite.cellHeight };
+                if (ImGui::InputInt2("cell size", cell)) {
+                    m_sprite.cellWidth  = std::max(1, cell[0]);
+                    m_sprite.cellHeight = std::max(1, cell[1]);
+                    changed = true;
+                }
+                int grid[2] = { m_sprite.margin, m_sprite.spacing };
+                if (ImGui::InputInt2("margin / spacing", grid)) {
+                    m_sprite.margin  = std::max(0, grid[0]);
+                    m_sprite.spacing = std::max(0, grid[1]);
+                    changed = true;
+                }
+                int range[2] = { m_sprite.first, m_sprite.count };
+                if (ImGui::InputInt2("first cell / count", range)) {
+                    m_sprite.first = std::max(0, range[0]);
+                    m_sprite.count = std::max(0, range[1]);
+                    changed = true;
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("cells are counted row by row, starting at 0; a count of 0 means all remaining cells");
+                }
+                f = float(m_sprite.fps);
+                if (ImGui::SliderFloat("animation speed", &f, 0.5f, 240.0f, "%.3g fps", ImGuiSliderFlags_Logarithmic)) {
+                    m_sprite.fps = f;
+                    restartSpriteClock();
+                }
+                if (changed) {
+                    updateSpriteGeometry();
+                    computePanelGeometry();
+                    viewCfg("sx");
+                    updateInfo();
+                }
+            }
+        }
 
         if (m_isANSI) {
             ImGui::Dummy(ImVec2(0.0f, 10.0f));
             if (ImGui::CollapsingHeader("ANSI rendering options", ImGuiTreeNodeFlags_DefaultOpen)) {
-                if (m_ansi.ui()) {
+                ANSILoader::UIResult res = m_ansi.ui();
+                if ((res == ANSILoader::UIResult::Palette) && !m_texCache.setPalette(m_imgEntry, m_ansi.palette, m_ansi.paletteSize)) {
+                    res = ANSILoader::UIResult::Reload;  // texture is shared with the comparison image
+                }
+                if (res == ANSILoader::UIResult::Reload) {
                     double oldAspect = m_ansi.aspect;
                     loadImage(true);  // reload image with new settings
                     if (m_ansi.aspect != oldAspect) {
@@ -203,3 +346,119 @@ void PixelViewApp::uiInfoWindow() {
     }
     ImGui::End();
 }
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PixelViewApp::uiTimingWindow() {
+    const ImGuiViewport* vp = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(
+        ImVec2(vp->WorkPos.x, vp->WorkPos.y + vp->WorkSize.y),
+        ImGuiCond_Always, ImVec2(0.0f, 1.0f));
+    ImGui::SetNextWindowBgAlpha(0.375f);
+    if (ImGui::Begin("##timing", nullptr,
+        ImGuiWindowFlags_NoNav |
+        ImGuiWindowFlags_NoDecoration |
+        ImGuiWindowFlags_AlwaysAutoResize |
+        ImGuiWindowFlags_NoSavedSettings |
+        ImGuiWindowFlags_NoFocusOnAppearing))
+    {
+        const FrameStats& st = m_statsShown;
+        ImGui::Text("display:  %.2f Hz, %s", 1.0 / m_refreshInterval, m_adaptiveVsync ? "adaptive vsync" : "vsync");
+        if (st.frames > 0) {
+            ImGui::Text("frames:   %.1f fps, avg %.2f ms, max %.2f ms", st.frames / st.intervalSum, 1000.0 * st.intervalSum / st.frames, 1000.0 * st.intervalMax);
+        } else {
+            ImGui::TextUnformatted("frames:   -");
+        }
+        if (st.frames > 0) {
+            ImGui::Text("CPU:      avg %.3f ms, max %.3f ms", 1000.0 * st.cpuSum / st.frames, 1000.0 * st.cpuMax);
+        }
+        ImGui::Text("missed:   %d vsync(s) in the last second, %d total", st.missed, m_missedTotal);
+        ImGui::Text("step:     %.2f ms", 1000.0 * m_frameDelta);
+        if (st.latencyCount > 0) {
+            ImGui::Text("latency:  avg %.2f ms, max %.2f ms (%s mode)", 1000.0 * st.latencySum / st.latencyCount, 1000.0 * st.latencyMax, m_lowLatency ? "low-latency" : "default");
+        } else {
+            ImGui::Text("latency:  - (%s mode)", m_lowLatency ? "low-latency" : "default");
+        }
+        if (m_readStats.bytes > 0) {
+            ImGui::Text("file:     %.1f MiB read in %.1f ms (%.0f MiB/s, %d thread(s))", double(m_readStats.bytes) / 1048576.0,
+                        1000.0 * m_readStats.seconds, m_readStats.throughput() / 1048576.0, m_readStats.threads);
+        }
+        ImGui::Text("cache:    %d texture(s), %.1f MiB, %d dedup hit(s)", m_texCache.count(), double(m_texCache.totalBytes()) / 1048576.0, m_texCache.dedupHits());
+        if (m_follower.active()) {
+            ImGui::Text("follow:   %d file(s) skipped", m_follower.dropped());
+        }
+        if (m_flipbook.active()) {
+            ImGui::Text("flipbook: %.3g fps target, decoding at up to %.1f fps (%d threads), %d frame(s) dropped",
+                        m_flipbook.fps, m_flipbook.decodeRate(), m_flipbook.threads(), m_flipbook.dropped());
+        }
+    }
+    ImGui::End();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void PixelViewApp::uiMinimap() {
+    if (!imgValid() || (m_viewMode == vmPanel)) { return; }
+    const ImGuiViewport* vp = ImGui::GetMainViewport();
+
+    // fit the image (with aspect ratio correction) into the minimap's box;
+    // very thin images get a minimum size, so there's still something to click
+    double rawWidth  = viewImgWidth()  * std::max(viewAspect(), 1.0);
+    double rawHeight = viewImgHeight() / std::min(viewAspect(), 1.0);
+    double scale = std::min(vp->WorkSize.x * 0.25 / rawWidth, vp->WorkSize.y * 0.75 / rawHeight);
+    ImVec2 size(std::max(16.0f, float(rawWidth * scale)), std::max(16.0f, float(rawHeight * scale)));
+
+    ImGui::SetNextWindowPos(
+        ImVec2(vp->WorkPos.x + vp->WorkSize.x, vp->WorkPos.y + vp->WorkSize.y),
+        ImGuiCond_Always, ImVec2(1.0f, 1.0f));
+    ImGui::SetNextWindowBgAlpha(0.375f);
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(2.0f, 2.0f));
+    if (ImGui::Begin("##minimap", nullptr,
+        ImGuiWindowFlags_NoNav |
+        ImGuiWindowFlags_NoDecoration |
+        ImGuiWindowFlags_AlwaysAutoResize |
+        ImGuiWindowFlags_NoSavedSettings |
+        ImGuiWindowFlags_NoFocusOnAppearing))
+    {
+        ImVec2 p0 = ImGui::GetCursorScreenPos();
+        ImGui::InvisibleButton("##minimapArea", size);
+
+        // draw the image from the already resident texture; at this size,
+        // the GPU automatically samples one of the coarsest mipmap levels
+        auto corner = [&] (float x, float y) -> ImVec2 { return ImVec2(p0.x + x * size.x, p0.y + y * size.y); };
+        auto uv = [&] (float x, float y) -> ImVec2 {
+            if (isTransposed())     { std::swap(x, y); }
+            if (m_orient & orFlipX) { x = 1.0f - x; }
+            if (m_orient & orFlipY) { y = 1.0f - y; }
+            if (const TexRect* r = spriteRect()) {
+                x = float(r->x + x * r->w);
+                y = float(r->y + y * r->h);
+            }
+            return ImVec2(x, y);
+        };
+        ImDrawList* dl = ImGui::GetWindowDrawList();
+        dl->AddImageQuad((ImTextureID)(intptr_t)m_texCache.texture(m_imgEntry),
+                         corner(0.0f, 0.0f), corner(1.0f, 0.0f), corner(1.0f, 1.0f), corner(0.0f, 1.0f),
+                             uv(0.0f, 0.0f),     uv(1.0f, 0.0f),     uv(1.0f, 1.0f),     uv(0.0f, 1.0f));
+
+        // draw the currently visible area
+        const Area& a = m_currentArea;
+        auto clamp01 = [] (double x) -> float { return float(std::min(1.0, std::max(0.0, x))); };
+        ImVec2 r0 = corner(clamp01((-1.0 - a.m[2]) / a.m[0]), clamp01(( 1.0 - a.m[3]) / a.m[1]));
+        ImVec2 r1 = corner(clamp01(( 1.0 - a.m[2]) / a.m[0]), clamp01((-1.0 - a.m[3]) / a.m[1]));
+        dl->AddRect(r0, r1, 0xFF000000, 0.0f, 0, 3.0f);
+        dl->AddRect(r0, r1, 0xFF00FFFF, 0.0f, 0, 1.0f);
+
+        // click (or drag) to jump: center the view on the clicked position
+        if (ImGui::IsItemActive()) {
+            ImVec2 mouse = ImGui::GetMousePos();
+            double rx = std::min(1.0, std::max(0.0, double(mouse.x - p0.x) / size.x));
+            double ry = std::min(1.0, std::max(0.0, double(mouse.y - p0.y) / size.y));
+            m_x0 = m_screenWidth  * 0.5 - rx * m_viewWidth;
+            m_y0 = m_screenHeight * 0.5 - ry * m_viewHeight;
+            viewCfg(ImGui::IsItemActivated() ? "fsa" : "fsx");
+        }
+    }
+    ImGui::End();
+    ImGui::PopStyleVar();
+}
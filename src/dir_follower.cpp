@@ -0,0 +1,217 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#ifdef __linux__
+    #include <sys/inotify.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+
+#include <chrono>
+#include <utility>
+
+#include "stb_image.h"
+
+#include "string_util.h"
+#include "file_util.h"
+#include "texture_cache.h"
+
+#include "dir_follower.h"
+
+// time to wait for file system events before checking for cancellation,
+// in milliseconds
+static constexpr int pollTimeout = 100;
+
+// interval for scanning the directory if file system events aren't available;
+// a new file is only decoded once it didn't change for a whole interval, as
+// there's no other way to know whether the writer has finished
+static constexpr std::chrono::milliseconds scanInterval(250);
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: control
+///////////////////////////////////////////////////////////////////////////////
+
+bool DirFollower::start(const char* dir, FilterFunc filter, bool newest) {
+    stop();
+    if (!dir || !filter) { return false; }
+    m_dir = dir[0] ? dir : ".";
+    m_filter = filter;
+    m_newest = newest;
+    m_cancel = false;
+    m_dropped = 0;
+    m_thread = std::thread([this] { worker(); });
+    #ifndef NDEBUG
+        printf("follow mode: watching directory '%s'\n", m_dir.c_str());
+    #endif
+    return true;
+}
+
+void DirFollower::stop() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cancel = true;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+    ::free(m_pending.data);
+    m_pending = Frame();
+}
+
+bool DirFollower::fetch(Frame& frame) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_pending.data) { return false; }
+    frame = std::move(m_pending);
+    m_pending = Frame();
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: worker
+///////////////////////////////////////////////////////////////////////////////
+
+void DirFollower::worker() {
+    FileUtil::FileFingerprint fp;
+    if (m_newest) {
+        std::string newest = findNewest(fp);
+        if (!newest.empty()) { decode(newest); }
+    }
+    if (!watchEvents()) {
+        if (!m_newest) { findNewest(fp); }
+        pollDirectory(fp);
+    }
+}
+
+#ifdef __linux__
+
+bool DirFollower::watchEvents() {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) { return false; }
+    if (inotify_add_watch(fd, m_dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        #ifndef NDEBUG
+            printf("follow mode: inotify not available for '%s', scanning instead\n", m_dir.c_str());
+        #endif
+        close(fd);
+        return false;
+    }
+    alignas(struct inotify_event) char buffer[4096];
+    while (!m_cancel) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, pollTimeout) <= 0) { continue; }
+
+        // drain all queued events; only the last matching file is of interest,
+        // all earlier ones would be replaced before anybody could see them
+        std::string latest;
+        int count = 0;
+        bool overflow = false;
+        ssize_t n;
+        while ((n = read(fd, static_cast<void*>(buffer), sizeof(buffer))) > 0) {
+            for (ssize_t pos = 0;  pos < n;) {
+                const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(&buffer[pos]);
+                pos += ssize_t(sizeof(struct inotify_event) + ev->len);
+                if (ev->mask & IN_Q_OVERFLOW) { overflow = true; }
+                if (!ev->len || (ev->mask & IN_ISDIR) || (ev->name[0] == '.') || !m_filter(ev->name)) { continue; }
+                if (latest != ev->name) { latest = ev->name; ++count; }
+            }
+        }
+        if (overflow) {
+            // events have been lost -> the newest file is the best guess
+            FileUtil::FileFingerprint fp;
+            latest = findNewest(fp);
+        }
+        if (count > 1) { m_dropped += count - 1; }
+        if (!m_cancel && !latest.empty()) { decode(latest); }
+    }
+    close(fd);
+    return true;
+}
+
+#else  // no file system events
+
+bool DirFollower::watchEvents() {
+    return false;
+}
+
+#endif
+
+void DirFollower::pollDirectory(FileUtil::FileFingerprint shown) {
+    std::string candidate;
+    FileUtil::FileFingerprint candidateFP;
+    while (!m_cancel) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait_for(lock, scanInterval, [this] { return bool(m_cancel); });
+        }
+        if (m_cancel) { break; }
+        FileUtil::FileFingerprint fp;
+        std::string newest = findNewest(fp);
+        if (newest.empty() || !fp.newerThan(shown)) {
+            candidate.clear();
+        } else if ((newest == candidate) && (fp == candidateFP)) {
+            shown = fp;
+            candidate.clear();
+            decode(newest);
+        } else {
+            candidate = newest;
+            candidateFP = fp;
+        }
+    }
+}
+
+std::string DirFollower::findNewest(FileUtil::FileFingerprint& fp) {
+    std::string newest;
+    fp = FileUtil::FileFingerprint();
+    FileUtil::Directory dir(m_dir.c_str());
+    while (!m_cancel && dir.nextNonDot()) {
+        const char* name = dir.currentItemName();
+        if (!name || dir.currentItemIsDir() || !m_filter(name)) { continue; }
+        char* path = StringUtil::pathJoin(m_dir.c_str(), name);
+        FileUtil::FileFingerprint itemFP(path);
+        ::free(path);
+        if (itemFP.good() && (newest.empty() || itemFP.newerThan(fp))) {
+            newest = name;
+            fp = itemFP;
+        }
+    }
+    return newest;
+}
+
+void DirFollower::decode(const std::string& name) {
+    Frame frame;
+    char* path = StringUtil::pathJoin(m_dir.c_str(), name.c_str());
+    if (!path) { return; }
+    frame.path = path;
+    ::free(path);
+    #ifndef NDEBUG
+        printf("follow mode: decoding '%s'\n", frame.path.c_str());
+    #endif
+    void* file = TextureCache::loadFile(frame.path.c_str(), frame.fileSize, frame.hash, &frame.fp);
+    if (!file) { return; }
+    if (frame.fileSize <= size_t(INT_MAX)) {
+        frame.data = stbi_load_from_memory(static_cast<const stbi_uc*>(file), int(frame.fileSize), &frame.width, &frame.height, nullptr, 4);
+    }
+    ::free(file);
+    if (!frame.data) {
+        #ifndef NDEBUG
+            printf("follow mode: failed to decode '%s'\n", frame.path.c_str());
+        #endif
+        return;
+    }
+
+    // publish the frame, replacing the previous one if it hasn't been
+    // picked up yet (i.e. the main thread is slower than the decoder)
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending.data) {
+        ::free(m_pending.data);
+        ++m_dropped;
+    }
+    m_pending = std::move(frame);
+}
@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "file_util.h"
+#include "hash_util.h"
+
+//! watcher for a directory that always decodes the most recently written
+//! image file in a background thread; the main thread picks up the decoded
+//! frame with fetch(). If files arrive faster than they can be decoded or
+//! displayed, the intermediate ones are skipped.
+class DirFollower {
+public:
+    //! filter function: returns true if a file (name only, no path) shall be followed
+    typedef bool (*FilterFunc)(const char* name);
+
+    //! one decoded image, as returned by fetch()
+    struct Frame {
+        std::string path;           //!< full path of the source file
+        void*    data   = nullptr;  //!< RGBA pixels (malloc'd; the caller needs to free() them)
+        int      width  = 0;        //!< image width in pixels
+        int      height = 0;        //!< image height in pixels
+        HashUtil::Digest hash;      //!< content hash of the source file (see TextureCache::loadFile())
+        size_t   fileSize = 0;      //!< size of the source file
+        FileUtil::FileFingerprint fp;  //!< fingerprint of the source file before it has been read
+    };
+
+    inline DirFollower() : m_cancel(false), m_dropped(0) {}
+    inline ~DirFollower() { stop(); }
+
+    //! start watching a directory; if `newest` is set, the newest file that
+    //! already exists in the directory is decoded immediately
+    bool start(const char* dir, FilterFunc filter, bool newest);
+
+    //! stop watching and discard the pending frame
+    void stop();
+
+    inline bool active() const { return m_thread.joinable(); }
+    inline const char* dir() const { return m_dir.c_str(); }
+
+    //! get the most recently decoded frame, if there's a new one
+    bool fetch(Frame& frame);
+
+    //! number of files that have been skipped because newer ones arrived
+    inline int dropped() const { return m_dropped; }
+
+private:
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic<bool> m_cancel;
+    std::atomic<int> m_dropped;
+    std::string m_dir;
+    FilterFunc m_filter = nullptr;
+    bool m_newest = false;
+    Frame m_pending;  //!< frame that hasn't been fetched yet; protected by m_mutex
+
+    void worker();
+    bool watchEvents();
+    void pollDirectory(FileUtil::FileFingerprint shown);
+    std::string findNewest(FileUtil::FileFingerprint& fp);
+    void decode(const std::string& name);
+};
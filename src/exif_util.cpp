@@ -0,0 +1,142 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#ifdef _MSC_VER
+    #define _CRT_SECURE_NO_WARNINGS  // prevent MSVC warnings
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "exif_util.h"
+
+namespace ExifUtil {
+
+///////////////////////////////////////////////////////////////////////////////
+
+//! minimal reader for TIFF-structured data (as used inside EXIF segments)
+class TIFFReader {
+    const uint8_t* m_data;
+    int m_size;
+    bool m_bigEndian = false;
+public:
+    inline TIFFReader(const uint8_t* data, int size) : m_data(data), m_size(size) {}
+    inline uint16_t u16(int pos) const {
+        if ((pos < 0) || ((pos + 2) > m_size)) { return 0; }
+        return m_bigEndian ? uint16_t((m_data[pos] << 8) | m_data[pos+1])
+                           : uint16_t((m_data[pos+1] << 8) | m_data[pos]);
+    }
+    inline uint32_t u32(int pos) const {
+        return m_bigEndian ? ((uint32_t(u16(pos)) << 16) | u16(pos + 2))
+                           : ((uint32_t(u16(pos + 2)) << 16) | u16(pos));
+    }
+    //! check the TIFF header; returns the offset of IFD0, or 0 if invalid
+    int init() {
+        if (m_size < 8) { return 0; }
+        if      (!memcmp(m_data, "II", 2)) { m_bigEndian = false; }
+        else if (!memcmp(m_data, "MM", 2)) { m_bigEndian = true;  }
+        else { return 0; }
+        if (u16(2) != 42) { return 0; }
+        uint32_t ifd = u32(4);
+        return (ifd < uint32_t(m_size)) ? int(ifd) : 0;
+    }
+    //! get the offset of the IFD that follows another one, or 0 if there's none
+    int nextIFD(int ifd) const {
+        uint32_t next = u32(ifd + 2 + 12 * u16(ifd));
+        return ((next >= 8u) && (next < uint32_t(m_size))) ? int(next) : 0;
+    }
+    //! find a tag in an IFD; returns the offset of the entry's value field, or 0
+    int findTag(int ifd, uint16_t tag) const {
+        int count = u16(ifd);
+        for (int pos = ifd + 2;  count && ((pos + 12) <= m_size);  --count, pos += 12) {
+            if (u16(pos) == tag) { return pos + 8; }
+        }
+        return 0;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+int readOrientation(const char* filename) {
+    if (!filename || !filename[0]) { return 0; }
+    FILE* f = fopen(filename, "rb");
+    if (!f) { return 0; }
+    uint8_t hdr[4];
+    int orientation = 0;
+
+    // check for the JPEG SOI marker
+    if ((fread(hdr, 1, 2, f) != 2) || (hdr[0] != 0xFF) || (hdr[1] != 0xD8)) {
+        fclose(f);
+        return 0;
+    }
+
+    // walk through the marker segments until we find an EXIF APP1 segment
+    // (give up as soon as the actual image data starts)
+    while (fread(hdr, 1, 4, f) == 4) {
+        if (hdr[0] != 0xFF) { break; /* corrupted stream */ }
+        uint8_t marker = hdr[1];
+        int len = ((hdr[2] << 8) | hdr[3]) - 2;
+        if ((marker == 0xDA) || (marker == 0xD9) || (len < 0)) { break; /* SOS or EOI */ }
+        if (marker != 0xE1) {
+            if (fseek(f, len, SEEK_CUR)) { break; }
+            continue;
+        }
+        uint8_t* seg = static_cast<uint8_t*>(malloc(size_t(len) + 1u));
+        if (!seg) { break; }
+        if ((int(fread(seg, 1, size_t(len), f)) == len) && (len > 6) && !memcmp(seg, "Exif\0", 6)) {
+            TIFFReader tiff(&seg[6], len - 6);
+            int ifd0 = tiff.init();
+            int pos = ifd0 ? tiff.findTag(ifd0, 0x0112) : 0;  // 0x0112 = Orientation
+            if (pos) {
+                orientation = tiff.u16(pos);
+                if ((orientation < 1) || (orientation > 8)) { orientation = 0; }
+            }
+            ::free(static_cast<void*>(seg));
+            break;
+        }
+        ::free(static_cast<void*>(seg));
+    }
+    fclose(f);
+    return orientation;
+}
+
+bool findThumbnail(const uint8_t* data, size_t dataSize, size_t &offset, size_t &size) {
+    offset = size = 0;
+    if (!data || (dataSize < 4u) || (data[0] != 0xFF) || (data[1] != 0xD8)) { return false; }
+
+    // same segment walk as in readOrientation(), but in memory
+    size_t pos = 2;
+    while ((pos + 4u) <= dataSize) {
+        if (data[pos] != 0xFF) { break; }
+        uint8_t marker = data[pos + 1u];
+        size_t len = size_t((data[pos + 2u] << 8) | data[pos + 3u]);
+        if ((marker == 0xDA) || (marker == 0xD9) || (len < 2u)) { break; }
+        size_t seg = pos + 4u;
+        len -= 2u;
+        if ((seg + len) > dataSize) { break; }
+        if ((marker == 0xE1) && (len > 6u) && (len < 65536u) && !memcmp(&data[seg], "Exif\0", 6)) {
+            // the thumbnail is described by the second IFD (IFD1)
+            TIFFReader tiff(&data[seg + 6u], int(len - 6u));
+            int ifd0 = tiff.init();
+            int ifd1 = ifd0 ? tiff.nextIFD(ifd0) : 0;
+            int posOffset = ifd1 ? tiff.findTag(ifd1, 0x0201) : 0;  // 0x0201 = JPEGInterchangeFormat
+            int posLength = ifd1 ? tiff.findTag(ifd1, 0x0202) : 0;  // 0x0202 = JPEGInterchangeFormatLength
+            if (!posOffset || !posLength) { return false; }
+            size_t thumbOffset = size_t(tiff.u32(posOffset));
+            size_t thumbSize   = size_t(tiff.u32(posLength));
+            if (!thumbSize || (thumbOffset > (len - 6u)) || (thumbSize > (len - 6u - thumbOffset))) { return false; }
+            offset = seg + 6u + thumbOffset;
+            size = thumbSize;
+            return true;
+        }
+        pos = seg + len;
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}  // namespace ExifUtil
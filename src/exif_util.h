@@ -0,0 +1,25 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ExifUtil {
+
+///////////////////////////////////////////////////////////////////////////////
+
+//! read the EXIF orientation tag from a JPEG file
+//! \returns the orientation code (1...8) as specified in the EXIF standard,
+//!          or 0 if the file doesn't have EXIF data or no orientation tag
+int readOrientation(const char* filename);
+
+//! locate the embedded JPEG thumbnail of a JPEG file that's already in memory
+//! \returns true if a thumbnail has been found; its data is then located
+//!          at data[offset ... offset+size-1]
+bool findThumbnail(const uint8_t* data, size_t dataSize, size_t &offset, size_t &size);
+
+///////////////////////////////////////////////////////////////////////////////
+
+}  // namespace ExifUtil
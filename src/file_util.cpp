@@ -0,0 +1,173 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "string_util.h"
+#include "file_util.h"
+
+namespace FileUtil {
+
+// size of the parts that a file is split into for reading
+static constexpr size_t readChunkSize = size_t(4) << 20;
+
+// files up to this size are read with a single thread
+static constexpr uint64_t minParallelReadSize = uint64_t(16) << 20;
+
+// maximum number of reads in flight; that's enough to keep the request
+// queue of typical NVMe drives busy with reads of this size
+static constexpr int maxReadThreads = 8;
+
+// maximum total size of the files in the cache directory
+static constexpr uint64_t maxCacheSize = uint64_t(1) << 30;
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: parallel file reading
+///////////////////////////////////////////////////////////////////////////////
+
+void* readFile(const char* path, size_t &size, size_t padding, const ReadFunc& onData, ReadStats* stats) {
+    size = 0;
+    if (stats) { *stats = ReadStats(); }
+    if (!path || !path[0]) { return nullptr; }
+    auto t0 = std::chrono::steady_clock::now();
+    RandomAccessFile f(path);
+    if (!f.good()) { return nullptr; }
+    uint64_t fileSize = f.size();
+    if (!fileSize || (fileSize >= uint64_t(SIZE_MAX - padding))) { return nullptr; }
+    uint8_t* data = static_cast<uint8_t*>(malloc(size_t(fileSize) + padding));
+    if (!data) { return nullptr; }
+    if (padding) { ::memset(static_cast<void*>(&data[fileSize]), 0, padding); }
+
+    size_t chunks = size_t((fileSize + readChunkSize - 1u) / readChunkSize);
+    auto chunkBegin = [=] (size_t i) -> size_t { return i * readChunkSize; };
+    auto chunkEnd   = [=] (size_t i) -> size_t { return std::min((i + 1u) * readChunkSize, size_t(fileSize)); };
+    int threads = 1;
+    if (fileSize >= minParallelReadSize) {
+        threads = std::min(std::min(maxReadThreads, std::max(1, int(std::thread::hardware_concurrency()))), int(chunks));
+    }
+    bool ok = true;
+
+    if (threads <= 1) {
+        for (size_t i = 0;  ok && (i < chunks);  ++i) {
+            size_t b = chunkBegin(i), e = chunkEnd(i);
+            ok = (f.read(&data[b], e - b, b) == (e - b));
+            if (ok && onData) { onData(data, e, size_t(fileSize)); }
+        }
+    } else {
+        // the workers claim chunks in file order, so the device still sees
+        // a mostly sequential access pattern; the calling thread processes
+        // the chunks in order as soon as they are complete
+        enum ChunkState : uint8_t { Pending, Done, Failed };
+        std::vector<ChunkState> state(chunks, Pending);
+        std::atomic<size_t> nextChunk(0);
+        std::atomic<bool> abort(false);
+        std::mutex mutex;
+        std::condition_variable cv;
+        auto worker = [&] () {
+            for (;;) {
+                size_t i = nextChunk++;
+                if ((i >= chunks) || abort) { break; }
+                size_t b = chunkBegin(i), e = chunkEnd(i);
+                bool good = (f.read(&data[b], e - b, b) == (e - b));
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    state[i] = good ? Done : Failed;
+                }
+                cv.notify_all();
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int t = 0;  t < threads;  ++t) { pool.emplace_back(worker); }
+        for (size_t i = 0;  ok && (i < chunks);  ++i) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return state[i] != Pending; });
+                ok = (state[i] == Done);
+            }
+            if (ok && onData) { onData(data, chunkEnd(i), size_t(fileSize)); }
+        }
+        abort = !ok;
+        for (auto& t : pool) { t.join(); }
+    }
+    f.close();
+
+    if (!ok) {
+        #ifndef NDEBUG
+            printf("failed to read file '%s'\n", path);
+        #endif
+        ::free(static_cast<void*>(data));
+        return nullptr;
+    }
+    size = size_t(fileSize);
+    if (stats) {
+        stats->bytes   = size;
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        stats->threads = threads;
+    }
+    return static_cast<void*>(data);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: cache directory
+///////////////////////////////////////////////////////////////////////////////
+
+void trimCacheDirectory() {
+    // cache files are written from several threads
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    char* dir = getCacheDirectory();
+    if (!dir) { return; }
+
+    // collect all files, except for temporary files that are being written
+    std::vector<std::string> paths;
+    Directory d(dir);
+    while (d.nextNonDot()) {
+        const char* name = d.currentItemName();
+        size_t len = strlen(name);
+        if (d.currentItemIsDir() || ((len >= 4u) && !strcmp(&name[len - 4u], ".tmp"))) { continue; }
+        char* path = StringUtil::pathJoin(dir, name);
+        if (path) { paths.push_back(path); ::free(path); }
+    }
+    d.close();
+    ::free(dir);
+    std::vector<const char*> names;
+    for (const auto& p : paths) { names.push_back(p.c_str()); }
+    std::vector<FileInfo> info(paths.size());
+    statFiles(names.data(), int(names.size()), info.data());
+
+    // delete the oldest files until the rest fits into the limit
+    uint64_t total = 0;
+    std::vector<size_t> order;
+    for (size_t i = 0;  i < info.size();  ++i) {
+        if (!info[i].exists) { continue; }
+        total += info[i].fp.size();
+        order.push_back(i);
+    }
+    if (total <= maxCacheSize) { return; }
+    std::sort(order.begin(), order.end(), [&] (size_t a, size_t b) { return info[a].fp.mtime() < info[b].fp.mtime(); });
+    for (size_t i : order) {
+        if (total <= maxCacheSize) { break; }
+        if (remove(names[i])) { continue; }
+        total -= info[i].fp.size();
+        #ifndef NDEBUG
+            printf("cache: removed '%s'\n", names[i]);
+        #endif
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}  // namespace FileUtil
@@ -3,8 +3,11 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
+#include <functional>
+
 namespace FileUtil {
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -14,6 +17,22 @@ namespace FileUtil {
 //!          (must be free()d by the caller)
 char* getCurrentDirectory();
 
+//! create a directory (non-recursively)
+//! \returns true if the directory has been created or already exists
+bool makeDirectory(const char* path);
+
+//! get (and create, if necessary) PixelView's directory for cached data,
+//! i.e. $XDG_CACHE_HOME/pixelview or ~/.cache/pixelview on Unix-like
+//! systems, and %LOCALAPPDATA%\PixelView on Windows
+//! \returns a newly-malloc'd string containing the directory name
+//!          (must be free()d by the caller), or nullptr if it's unavailable
+char* getCacheDirectory();
+
+//! delete the least recently used files from the cache directory until
+//! the total size is below the limit; "used" means the modification time,
+//! which readers of cache files refresh with touchFile()
+void trimCacheDirectory();
+
 ///////////////////////////////////////////////////////////////////////////////
 
 class Directory {
@@ -56,10 +75,96 @@ public:
     inline bool newerThan(const FileFingerprint& other) const
         { return (m_mtime > other.m_mtime); }
     inline FileFingerprint& operator= (const char* path) { update(path); return *this; }
+    inline void set(uint64_t size, uint64_t mtime) { m_size = size; m_mtime = mtime; }
+    inline uint64_t size()  const { return m_size; }
+    inline uint64_t mtime() const { return m_mtime; }
 
     bool update(const char* path);
 };
 
+//! set the modification time of a file to the current time
+bool touchFile(const char* path);
+
+//! identity of a file or directory, independent of the path it's reached by
+//! (device and inode number on POSIX systems, volume serial number and file
+//! index on Windows)
+struct FileID {
+    uint64_t device = 0;
+    uint64_t index  = 0;
+    inline bool operator< (const FileID& other) const
+        { return (device < other.device) || ((device == other.device) && (index < other.index)); }
+};
+
+//! get the identity of a file or directory, following symlinks
+bool getFileID(const char* path, FileID& id);
+
+///////////////////////////////////////////////////////////////////////////////
+
+//! file metadata, as returned by statFiles()
+struct FileInfo {
+    bool exists = false;
+    bool isDir  = false;
+    FileFingerprint fp;
+};
+
+//! query the metadata of many files at once; on network filesystems and
+//! for very large batches, this uses batched statx() requests through
+//! io_uring if available, otherwise the requests are distributed across a
+//! few threads; for small batches on local filesystems, plain stat() calls
+//! are faster
+void statFiles(const char* const* paths, int count, FileInfo* info);
+
+///////////////////////////////////////////////////////////////////////////////
+
+//! read-only file that supports positional reads from multiple threads at
+//! once (pread() on POSIX systems, overlapped ReadFile() on Windows)
+class RandomAccessFile {
+    struct RandomAccessFilePrivate *priv = nullptr;
+public:
+    bool open(const char* path);
+    inline bool good() const { return (priv != nullptr); }
+    void close();
+
+    uint64_t size() const;
+
+    //! read data from a specific position in the file
+    //! \returns the number of bytes read; this is only less than `size`
+    //!          at the end of the file or if an error occurred
+    size_t read(void* data, size_t size, uint64_t offset) const;
+
+    inline RandomAccessFile() {}
+    inline explicit RandomAccessFile(const char* path) { open(path); }
+    inline ~RandomAccessFile() { close(); }
+};
+
+//! tell the operating system that a file is going to be read soon, so it
+//! can start loading it into the page cache in the background
+//! (posix_fadvise() or F_RDADVISE; no-op on Windows)
+void readAhead(const char* path);
+
+//! statistics about a readFile() call
+struct ReadStats {
+    size_t bytes   = 0;
+    double seconds = 0.0;
+    int    threads = 0;
+    inline double throughput() const { return (seconds > 0.0) ? (double(bytes) / seconds) : 0.0; }  //!< bytes per second
+};
+
+//! callback for readFile(): the first `available` of the file's `total`
+//! bytes have been read; the calls happen on the calling thread, with
+//! increasing values of `available`, the last one being equal to `total`
+typedef std::function<void(const uint8_t* data, size_t available, size_t total)> ReadFunc;
+
+//! read a complete file into memory; large files are read in chunks by
+//! several threads in parallel, because a single stream of sequential
+//! reads can't come anywhere near the bandwidth of fast (NVMe) storage
+//! \param padding  number of zero bytes to append to the data
+//! \param onData   optional function that processes the data while the
+//!                 rest of the file is still being read
+//! \returns a newly-malloc'd buffer (must be free()d by the caller),
+//!          or nullptr if the file couldn't be read completely or is empty
+void* readFile(const char* path, size_t &size, size_t padding=0, const ReadFunc& onData=nullptr, ReadStats* stats=nullptr);
+
 ///////////////////////////////////////////////////////////////////////////////
 
 }  // namespace FileUtil
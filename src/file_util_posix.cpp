@@ -6,6 +6,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <dirent.h>
 
@@ -13,8 +14,30 @@
 #include <cstdlib>
 #include <cstring>
 
+#include <algorithm>
 #include <new>
 #include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #define HAVE_IO_URING
+        #include <sys/mman.h>
+        #include <sys/syscall.h>
+        #include <linux/stat.h>
+        #include <linux/io_uring.h>
+    #endif
+#endif
+#ifdef __linux__
+    #include <sys/vfs.h>
+    #include <linux/magic.h>
+#endif
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+    #include <sys/param.h>
+    #include <sys/mount.h>
+    #define HAVE_MNT_LOCAL
+#endif
 
 #include "string_util.h"
 #include "file_util.h"
@@ -37,6 +60,30 @@ char* getCurrentDirectory() {
     return cwd;
 }
 
+bool makeDirectory(const char* path) {
+    if (!path || !path[0]) { return false; }
+    if (!mkdir(path, 0777)) { return true; }
+    struct stat st;
+    return (errno == EEXIST) && !stat(path, &st) && S_ISDIR(st.st_mode);
+}
+
+char* getCacheDirectory() {
+    char* base = nullptr;
+    const char* env = getenv("XDG_CACHE_HOME");
+    if (env && (env[0] == '/')) {
+        base = StringUtil::copy(env);
+    } else {
+        env = getenv("HOME");
+        if (!env || !env[0]) { return nullptr; }
+        base = StringUtil::pathJoin(env, ".cache");
+    }
+    char* dir = base ? StringUtil::pathJoin(base, "pixelview") : nullptr;
+    bool ok = dir && makeDirectory(base) && makeDirectory(dir);
+    ::free(base);
+    if (!ok) { ::free(dir); return nullptr; }
+    return dir;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 struct DirectoryPrivate {
@@ -100,6 +147,296 @@ bool FileFingerprint::update(const char* path) {
     return true;
 }
 
+bool touchFile(const char* path) {
+    return path && path[0] && !utimensat(AT_FDCWD, path, nullptr, 0);
+}
+
+bool getFileID(const char* path, FileID& id) {
+    id = FileID();
+    struct stat st;
+    if (!path || !path[0] || stat(path, &st)) { return false; }
+    id.device = uint64_t(st.st_dev);
+    id.index  = uint64_t(st.st_ino);
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: positional reads
+///////////////////////////////////////////////////////////////////////////////
+
+struct RandomAccessFilePrivate {
+    int fd;
+    uint64_t size;
+};
+
+bool RandomAccessFile::open(const char* path) {
+    close();
+    if (!path || !path[0]) { return false; }
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) { return false; }
+    struct stat st;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) { ::close(fd); return false; }
+    priv = new(std::nothrow) RandomAccessFilePrivate;
+    if (!priv) { ::close(fd); return false; }
+    priv->fd = fd;
+    priv->size = uint64_t(st.st_size);
+    return true;
+}
+
+void RandomAccessFile::close() {
+    if (!priv) { return; }
+    ::close(priv->fd);
+    delete priv;
+    priv = nullptr;
+}
+
+uint64_t RandomAccessFile::size() const {
+    return priv ? priv->size : 0u;
+}
+
+size_t RandomAccessFile::read(void* data, size_t size, uint64_t offset) const {
+    if (!priv || !data) { return 0u; }
+    size_t done = 0;
+    while (done < size) {
+        // Linux transfers at most ~2 GiB per call, so large reads are split
+        ssize_t res = pread(priv->fd, &static_cast<char*>(data)[done], std::min(size - done, size_t(1) << 30), off_t(offset + done));
+        if (res < 0) {
+            if (errno == EINTR) { continue; }
+            break;
+        }
+        if (!res) { break; }  // end of file
+        done += size_t(res);
+    }
+    return done;
+}
+
+void readAhead(const char* path) {
+    if (!path || !path[0]) { return; }
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) { return; }
+    #if defined(POSIX_FADV_WILLNEED)
+        // the readahead continues after the file has been closed
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    #elif defined(F_RDADVISE)
+        struct stat st;
+        if (!fstat(fd, &st) && (st.st_size > 0)) {
+            struct radvisory ra;
+            ra.ra_offset = 0;
+            ra.ra_count = int(std::min(off_t(st.st_size), off_t(0x7FFFFFFF)));
+            fcntl(fd, F_RDADVISE, &ra);
+        }
+    #endif
+    ::close(fd);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: batched stat
+///////////////////////////////////////////////////////////////////////////////
+
+static void statSingle(const char* path, FileInfo& info) {
+    info = FileInfo();
+    struct stat st;
+    if (!path || stat(path, &st)) { return; }
+    info.exists = true;
+    info.isDir = S_ISDIR(st.st_mode);
+    info.fp.set(uint64_t(st.st_size), uint64_t(st.st_mtim.tv_sec) * 1000000000ULL + uint64_t(st.st_mtim.tv_nsec));
+}
+
+#ifdef HAVE_IO_URING
+
+//! minimal io_uring wrapper (without liburing) that only does statx()
+class StatxRing {
+    int m_fd = -1;
+    bool m_failed = false;  //!< don't try again after an unsuccessful setup
+    unsigned m_entries = 0;
+    void*  m_sqMap = nullptr;  size_t m_sqMapSize = 0;
+    void*  m_cqMap = nullptr;  size_t m_cqMapSize = 0;
+    struct io_uring_sqe* m_sqes = nullptr;  size_t m_sqesSize = 0;
+    unsigned *m_sqTail = nullptr, *m_sqMask = nullptr, *m_sqArray = nullptr;
+    unsigned *m_cqHead = nullptr, *m_cqTail = nullptr, *m_cqMask = nullptr;
+    struct io_uring_cqe* m_cqes = nullptr;
+
+    bool init() {
+        if (m_fd >= 0) { return true; }
+        if (m_failed) { return false; }
+        m_failed = true;
+        struct io_uring_params p;
+        memset(&p, 0, sizeof(p));
+        m_fd = int(syscall(__NR_io_uring_setup, 64, &p));
+        if (m_fd < 0) { return false; }
+        m_entries = p.sq_entries;
+        m_sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        m_cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+        if (p.features & IORING_FEAT_SINGLE_MMAP) {
+            m_sqMapSize = m_cqMapSize = std::max(m_sqMapSize, m_cqMapSize);
+        }
+        m_sqMap = mmap(nullptr, m_sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+        if (m_sqMap == MAP_FAILED) { m_sqMap = nullptr; done(); return false; }
+        if (p.features & IORING_FEAT_SINGLE_MMAP) {
+            m_cqMap = m_sqMap;
+        } else {
+            m_cqMap = mmap(nullptr, m_cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+            if (m_cqMap == MAP_FAILED) { m_cqMap = nullptr; done(); return false; }
+        }
+        m_sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+        m_sqes = static_cast<struct io_uring_sqe*>(mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES));
+        if (m_sqes == MAP_FAILED) { m_sqes = nullptr; done(); return false; }
+        char* sq = static_cast<char*>(m_sqMap);
+        char* cq = static_cast<char*>(m_cqMap);
+        m_sqTail  = reinterpret_cast<unsigned*>(&sq[p.sq_off.tail]);
+        m_sqMask  = reinterpret_cast<unsigned*>(&sq[p.sq_off.ring_mask]);
+        m_sqArray = reinterpret_cast<unsigned*>(&sq[p.sq_off.array]);
+        m_cqHead  = reinterpret_cast<unsigned*>(&cq[p.cq_off.head]);
+        m_cqTail  = reinterpret_cast<unsigned*>(&cq[p.cq_off.tail]);
+        m_cqMask  = reinterpret_cast<unsigned*>(&cq[p.cq_off.ring_mask]);
+        m_cqes    = reinterpret_cast<struct io_uring_cqe*>(&cq[p.cq_off.cqes]);
+        m_failed = false;
+        return true;
+    }
+
+    void done() {
+        if (m_sqes) { munmap(m_sqes, m_sqesSize); m_sqes = nullptr; }
+        if (m_cqMap && (m_cqMap != m_sqMap)) { munmap(m_cqMap, m_cqMapSize); }
+        if (m_sqMap) { munmap(m_sqMap, m_sqMapSize); }
+        m_sqMap = m_cqMap = nullptr;
+        if (m_fd >= 0) { ::close(m_fd); m_fd = -1; }
+    }
+
+public:
+    ~StatxRing() { done(); }
+
+    //! run a batch of statx() requests; returns false if io_uring is unusable
+    bool run(const char* const* paths, int count, FileInfo* info) {
+        if (!init()) { return false; }
+        std::vector<struct statx> buf(m_entries);
+        for (int base = 0;  base < count;  base += int(m_entries)) {
+            int n = std::min(count - base, int(m_entries));
+
+            // fill the submission queue
+            unsigned tail = *m_sqTail;
+            for (int i = 0;  i < n;  ++i) {
+                unsigned slot = (tail + unsigned(i)) & *m_sqMask;
+                struct io_uring_sqe& sqe = m_sqes[slot];
+                memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode     = IORING_OP_STATX;
+                sqe.fd         = AT_FDCWD;
+                sqe.addr       = uint64_t(uintptr_t(paths[base + i]));
+                sqe.len        = STATX_TYPE | STATX_SIZE | STATX_MTIME;
+                sqe.off        = uint64_t(uintptr_t(&buf[size_t(i)]));
+                sqe.user_data  = uint64_t(i);
+                m_sqArray[slot] = slot;
+            }
+            __atomic_store_n(m_sqTail, tail + unsigned(n), __ATOMIC_RELEASE);
+
+            // submit and wait for all completions
+            int pending = n;
+            int submitted = 0;
+            while (pending > 0) {
+                int res = int(syscall(__NR_io_uring_enter, m_fd, unsigned(n - submitted), unsigned(pending), IORING_ENTER_GETEVENTS, nullptr, 0));
+                if (res < 0) {
+                    if (errno == EINTR) { continue; }
+                    // the ring is in an unknown state now -> give up on it
+                    done();
+                    m_failed = true;
+                    for (int i = 0;  i < count;  ++i) { statSingle(paths[i], info[i]); }
+                    return true;
+                }
+                submitted += res;
+                unsigned head = *m_cqHead;
+                unsigned cqTail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+                for (;  head != cqTail;  ++head) {
+                    const struct io_uring_cqe& cqe = m_cqes[head & *m_cqMask];
+                    int i = int(cqe.user_data);
+                    FileInfo& fi = info[base + i];
+                    fi = FileInfo();
+                    if (cqe.res == -EINVAL) {
+                        // kernel supports io_uring, but not statx (< 5.6)
+                        m_failed = true;
+                        statSingle(paths[base + i], fi);
+                    } else if (!cqe.res) {
+                        const struct statx& sx = buf[size_t(i)];
+                        fi.exists = true;
+                        fi.isDir = S_ISDIR(sx.stx_mode);
+                        fi.fp.set(sx.stx_size, uint64_t(sx.stx_mtime.tv_sec) * 1000000000ULL + uint64_t(sx.stx_mtime.tv_nsec));
+                    }
+                    --pending;
+                }
+                __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+            }
+            if (m_failed) {
+                for (int i = base + n;  i < count;  ++i) { statSingle(paths[i], info[i]); }
+                done();
+                return true;
+            }
+        }
+        return true;
+    }
+};
+
+#endif  // HAVE_IO_URING
+
+//! check whether a path is on a network filesystem; stat() is cheap on local
+//! filesystems (and even slower when done asynchronously), so batching only
+//! pays off where the per-request latency is high
+static bool isRemoteFS(const char* path) {
+    #ifdef __linux__
+        struct statfs sfs;
+        if (statfs(path, &sfs)) { return false; }
+        switch (uint32_t(sfs.f_type)) {
+            case NFS_SUPER_MAGIC:
+            case SMB_SUPER_MAGIC:
+            case 0xFF534D42u:  // CIFS
+            case 0xFE534D42u:  // SMB2
+            case 0x65735546u:  // FUSE (sshfs etc.)
+            case 0x00C36400u:  // Ceph
+                return true;
+            default:
+                return false;
+        }
+    #elif defined(HAVE_MNT_LOCAL)
+        struct statfs sfs;
+        if (statfs(path, &sfs)) { return false; }
+        return !(sfs.f_flags & MNT_LOCAL);
+    #else
+        // unknown -> assume a local filesystem, where batching only pays
+        // off for very large directories
+        (void)path;
+        return false;
+    #endif
+}
+
+void statFiles(const char* const* paths, int count, FileInfo* info) {
+    if (!paths || !info || (count < 1)) { return; }
+    constexpr int minBatchSize = 8;  // smaller batches aren't worth the effort
+    // on local filesystems, individual stat() calls are fast as long as the
+    // metadata is cached; only very large directories (where most of it
+    // likely isn't) benefit from multiple requests in flight
+    constexpr int minLocalBatchSize = 1024;
+    if ((count < minBatchSize) || ((count < minLocalBatchSize) && !isRemoteFS(paths[0]))) {
+        for (int i = 0;  i < count;  ++i) { statSingle(paths[i], info[i]); }
+        return;
+    }
+
+    #ifdef HAVE_IO_URING
+        static thread_local StatxRing ring;
+        if (ring.run(paths, count, info)) { return; }
+    #endif
+
+    // fallback: blocking stat() calls, distributed across a few threads so
+    // that network filesystems can process multiple requests in parallel
+    constexpr int maxThreads = 8;
+    int n = std::min(std::min(maxThreads, std::max(1, int(std::thread::hardware_concurrency()))), count / minBatchSize);
+    auto worker = [=] (int begin, int end) {
+        for (int i = begin;  i < end;  ++i) { statSingle(paths[i], info[i]); }
+    };
+    std::vector<std::thread> pool;
+    for (int t = 1;  t < n;  ++t) {
+        pool.emplace_back(worker, count * t / n, count * (t + 1) / n);
+    }
+    worker(0, count / n);
+    for (auto& t : pool) { t.join(); }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 }  // namespace FileUtil
@@ -0,0 +1,345 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "stb_image.h"
+
+#include "string_util.h"
+#include "file_util.h"
+
+#include "flipbook.h"
+
+// maximum number of decoder threads
+static constexpr int maxThreads = 8;
+
+// number of decoded frames that may be kept in addition to the one
+// that each worker is currently decoding
+static constexpr int extraSlots = 4;
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: sequence detection
+///////////////////////////////////////////////////////////////////////////////
+
+//! split a file name into the parts before, in and after the last run of
+//! digits; returns false if there are no digits
+static bool splitNumber(const char* name, size_t &numStart, size_t &numEnd) {
+    const char* ext = strrchr(name, '.');
+    size_t end = ext ? size_t(ext - name) : strlen(name);
+    while (end && !((name[end - 1] >= '0') && (name[end - 1] <= '9'))) { --end; }
+    if (!end) { return false; }
+    size_t start = end;
+    while (start && (name[start - 1] >= '0') && (name[start - 1] <= '9')) { --start; }
+    numStart = start;
+    numEnd = end;
+    return true;
+}
+
+int Flipbook::findSequence(const char* path, FilterFunc filter, std::vector<std::string>& frames) {
+    frames.clear();
+    if (!path || !path[0] || !filter) { return -1; }
+    char* dirName = StringUtil::pathDirName(path);
+    if (!dirName) { return -1; }
+    const char* baseName = StringUtil::pathBaseName(path);
+    size_t numStart = 0, numEnd = 0;
+    bool numbered = splitNumber(baseName, numStart, numEnd);
+    size_t suffixLen = strlen(baseName) - numEnd;
+
+    // collect all matching files along with their frame numbers
+    struct Item { unsigned long long number; std::string name; };
+    std::vector<Item> items;
+    FileUtil::Directory dir(dirName[0] ? dirName : ".");
+    while (dir.nextNonDot()) {
+        const char* name = dir.currentItemName();
+        if (!name || dir.currentItemIsDir() || !filter(name)) { continue; }
+        Item item;
+        item.number = 0;
+        if (numbered) {
+            size_t len = strlen(name), s = 0, e = 0;
+            if ((len < (numStart + suffixLen)) || strncmp(name, baseName, numStart)
+            || strcmp(&name[len - suffixLen], &baseName[numEnd])
+            || !splitNumber(name, s, e) || (s != numStart) || (e != (len - suffixLen))) {
+                continue;  // different prefix, suffix or no number in the same place
+            }
+            item.number = strtoull(&name[s], nullptr, 10);
+        }
+        item.name = name;
+        items.push_back(std::move(item));
+    }
+    dir.close();
+    std::sort(items.begin(), items.end(), [] (const Item& a, const Item& b) {
+        if (a.number != b.number) { return a.number < b.number; }
+        return StringUtil::compareCI(a.name.c_str(), b.name.c_str()) < 0;
+    });
+
+    int index = -1;
+    frames.reserve(items.size());
+    for (const auto& item : items) {
+        if (item.name == baseName) { index = int(frames.size()); }
+        char* itemPath = StringUtil::pathJoin(dirName, item.name.c_str());
+        if (itemPath) { frames.push_back(itemPath); }
+        ::free(itemPath);
+    }
+    ::free(dirName);
+    return index;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: control
+///////////////////////////////////////////////////////////////////////////////
+
+bool Flipbook::start(std::vector<std::string>&& frames, int current) {
+    stop();
+    if (frames.empty()) { return false; }
+    m_frames = std::move(frames);
+    int threads = std::max(1, std::min(int(std::thread::hardware_concurrency()) - 1, maxThreads));
+    m_slots.assign(size_t(threads + extraSlots), Slot());
+    m_decodeTime = 0.0;
+    m_decodeCount = 0;
+    m_dropped = 0;
+    m_quit = false;
+    current = std::max(-1, std::min(current, count() - 1));
+    restart(current);
+    m_current = current;
+    m_target = std::max(current, 0);
+    #ifndef NDEBUG
+        printf("flipbook: %d frames, %d decoder threads, %d slots\n", count(), threads, int(m_slots.size()));
+    #endif
+    for (int i = 0;  i < threads;  ++i) {
+        m_threads.emplace_back([this] { worker(); });
+    }
+    return true;
+}
+
+void Flipbook::stop() {
+    if (!m_threads.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_cv.notify_all();
+        for (auto& t : m_threads) { t.join(); }
+        m_threads.clear();
+    }
+    clearSlots();
+    m_slots.clear();
+    m_frames.clear();
+    m_shown = m_target = -1;
+    m_current = -1;
+    m_clockRunning = false;
+}
+
+void Flipbook::restart(int64_t shown) {
+    // throw away everything decoded so far, as it's for the wrong steps
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_generation;
+        clearSlots();
+        m_pingPongW = pingPong;
+        m_want = shown + 1;
+    }
+    m_cv.notify_all();
+    m_shown = shown;
+    m_clockRunning = false;
+}
+
+void Flipbook::seek(int index) {
+    if (!active()) { return; }
+    index = std::max(0, std::min(index, count() - 1));
+    // step `index` maps to frame `index` in both loop and ping-pong mode
+    restart(index - 1);
+    m_target = index;
+}
+
+void Flipbook::step(int delta) {
+    if (!active() || !delta) { return; }
+    int64_t s = std::max(m_shown, m_target) + delta;
+    if (s > m_shown) {
+        m_target = s;  // the frames ahead might be decoded already
+        m_clockRunning = false;
+    } else {
+        seek(frameOf(s));
+    }
+}
+
+void Flipbook::resync() {
+    if (!active()) { return; }
+    if (pingPong != m_pingPongW) {
+        // the mapping of steps to frames changed
+        int current = std::max(m_current, 0);
+        restart(current);
+        m_target = current;
+    } else {
+        m_target = std::max(m_target, m_shown);
+        m_clockRunning = false;
+    }
+}
+
+double Flipbook::decodeRate() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_decodeCount || (m_decodeTime <= 0.0)) { return 0.0; }
+    return double(m_decodeCount) * double(m_threads.size()) / m_decodeTime;
+}
+
+int Flipbook::frameOf(int64_t step, bool pp) const {
+    int64_t n = int64_t(m_frames.size());
+    if (n < 2) { return 0; }
+    int64_t period = pp ? (2 * n - 2) : n;
+    int64_t r = step % period;
+    if (r < 0) { r += period; }
+    return int((r < n) ? r : (period - r));
+}
+
+void Flipbook::clearSlots() {
+    for (auto& s : m_slots) {
+        ::free(s.data);
+        s = Slot();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: playback
+///////////////////////////////////////////////////////////////////////////////
+
+bool Flipbook::advance(double now, Frame& frame) {
+    if (!active()) { return false; }
+
+    // determine the step that should be on screen now; while the clock
+    // isn't running (paused, after seeking, or at the start), the target
+    // step is shown as soon as it's decoded
+    if (!paused && !m_clockRunning && (m_target <= m_shown)) {
+        m_clockRunning = true;
+        m_baseStep = m_shown;
+        m_baseTime = now;
+    }
+    if (paused) { m_clockRunning = false; }
+    int64_t target = m_clockRunning ? (m_baseStep + int64_t(std::floor((now - m_baseTime) * fps))) : m_target;
+
+    bool result = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // pick the most recent decoded frame that's due; if the one that's
+        // due exactly isn't ready yet, an earlier one is better than nothing
+        Slot* best = nullptr;
+        for (auto& s : m_slots) {
+            if ((s.state == SlotState::Ready) && (s.generation == m_generation)
+            && (s.step > m_shown) && (s.step <= target) && (!best || (s.step > best->step))) {
+                best = &s;
+            }
+        }
+        if (best && !best->data) {
+            // the frame couldn't be decoded -> skip it
+            m_shown = best->step;
+            *best = Slot();
+        } else if (best) {
+            frame.index  = frameOf(best->step);
+            frame.data   = best->data;
+            frame.width  = best->width;
+            frame.height = best->height;
+            if (m_clockRunning) { m_dropped += int(best->step - m_shown - 1); }
+            m_shown = best->step;
+            m_current = frame.index;
+            *best = Slot();
+            result = true;
+        }
+
+        // tell the workers where to continue and discard frames that are
+        // either late or too far ahead (e.g. after stepping while paused)
+        m_want = std::max(target, m_shown + 1);
+        int64_t end = m_want + int64_t(m_slots.size());
+        for (auto& s : m_slots) {
+            if ((s.state == SlotState::Ready) && ((s.step <= m_shown) || (s.step >= end))) {
+                ::free(s.data);
+                s = Slot();
+            }
+        }
+    }
+    m_cv.notify_all();
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: worker
+///////////////////////////////////////////////////////////////////////////////
+
+bool Flipbook::claimWork(size_t &slot, int64_t &step) {
+    // decode the next steps in playback order that nobody is working on yet
+    for (int64_t s = m_want;  s < (m_want + int64_t(m_slots.size()));  ++s) {
+        bool taken = false;
+        for (const auto& sl : m_slots) {
+            if ((sl.state != SlotState::Empty) && (sl.generation == m_generation) && (sl.step == s)) { taken = true; break; }
+        }
+        if (taken) { continue; }
+        for (size_t i = 0;  i < m_slots.size();  ++i) {
+            if (m_slots[i].state == SlotState::Empty) {
+                slot = i;
+                step = s;
+                return true;
+            }
+        }
+        return false;  // all slots are in use
+    }
+    return false;
+}
+
+void Flipbook::worker() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_quit) {
+        size_t slot = 0;
+        int64_t step = 0;
+        if (!claimWork(slot, step)) {
+            m_cv.wait(lock);
+            continue;
+        }
+        unsigned generation = m_generation;
+        Slot& s = m_slots[slot];
+        s.state = SlotState::Decoding;
+        s.step = step;
+        s.generation = generation;
+        std::string path = m_frames[size_t(frameOf(step, m_pingPongW))];
+        // the frame that will be claimed next after the current decode
+        // window has moved on is announced to the OS, so it's already in
+        // the page cache by the time a worker gets to it
+        std::string next = m_frames[size_t(frameOf(step + int64_t(m_slots.size()), m_pingPongW))];
+        lock.unlock();
+
+        FileUtil::readAhead(next.c_str());
+        auto t0 = std::chrono::steady_clock::now();
+        int width = 0, height = 0;
+        size_t size = 0;
+        void* file = FileUtil::readFile(path.c_str(), size);
+        void* data = (file && (size <= size_t(INT_MAX))) ? stbi_load_from_memory(static_cast<const stbi_uc*>(file), int(size), &width, &height, nullptr, 4) : nullptr;
+        ::free(file);
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        #ifndef NDEBUG
+            if (!data) { printf("flipbook: failed to decode '%s'\n", path.c_str()); }
+        #endif
+
+        lock.lock();
+        m_decodeTime += t;
+        ++m_decodeCount;
+        Slot& r = m_slots[slot];
+        if ((r.state == SlotState::Decoding) && (r.generation == generation) && (r.step == step)) {
+            // (a frame that failed to decode is kept as an empty Ready slot,
+            // so it's skipped by advance() instead of being retried forever)
+            r.state = SlotState::Ready;
+            r.data = data;
+            r.width = width;
+            r.height = height;
+        } else {
+            // obsolete -> release the slot, unless it has been
+            // claimed again in the meantime
+            ::free(data);
+            if ((r.generation == generation) && (r.step == step)) { r = Slot(); }
+        }
+    }
+}
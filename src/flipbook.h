@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! player for image sequences (e.g. numbered frames from an animation or
+//! rendering tool): the frames following the current one are decoded ahead
+//! of time by a pool of worker threads into a small ring of slots, and
+//! advance() hands them out at the target frame rate. Frames are only
+//! skipped if the decoders fall behind the playback clock.
+class Flipbook {
+public:
+    //! filter function: returns true if a file (name only, no path) may be part of a sequence
+    typedef bool (*FilterFunc)(const char* name);
+
+    //! one decoded frame, as returned by advance()
+    struct Frame {
+        int   index  = -1;       //!< index of the frame in the sequence
+        void* data   = nullptr;  //!< RGBA pixels (malloc'd; the caller needs to free() them)
+        int   width  = 0;        //!< image width in pixels
+        int   height = 0;        //!< image height in pixels
+    };
+
+    double fps      = 24.0;   //!< target frame rate
+    bool   pingPong = false;  //!< play forward and backward alternately instead of looping
+    bool   paused   = false;  //!< playback is paused
+
+    //! collect the image sequence that a file belongs to: all files in the
+    //! same directory whose names only differ in the last run of digits
+    //! (sorted numerically), or all files in the directory if the name
+    //! doesn't contain any digits (sorted alphabetically)
+    //! \returns the index of the file in the sequence, or -1 if it's not found
+    static int findSequence(const char* path, FilterFunc filter, std::vector<std::string>& frames);
+
+    inline Flipbook() {}
+    inline ~Flipbook() { stop(); }
+
+    //! start playback of a sequence; the frame `current` is assumed to be
+    //! on display already (use -1 if it isn't, and playback shall start
+    //! at the first frame)
+    bool start(std::vector<std::string>&& frames, int current);
+
+    //! stop playback and the worker threads
+    void stop();
+
+    inline bool active() const { return !m_frames.empty(); }
+    inline int count() const { return int(m_frames.size()); }
+    inline int current() const { return m_current; }  //!< index of the frame on display (-1 = none)
+    inline const char* path(int index) const { return m_frames[size_t(index)].c_str(); }
+    inline int threads() const { return int(m_threads.size()); }
+
+    //! jump to a specific frame
+    void seek(int index);
+
+    //! move by a number of frames in playback direction (typically while paused)
+    void step(int delta);
+
+    //! restart the playback clock; required after changing `fps` or `pingPong`
+    void resync();
+
+    //! advance the playback position according to the wall-clock time `now`
+    //! (in seconds)
+    //! \returns true if a new frame needs to be shown
+    bool advance(double now, Frame& frame);
+
+    //! number of frames that have been skipped because they weren't decoded in time
+    inline int dropped() const { return m_dropped; }
+
+    //! number of frames that the workers could decode per second if they
+    //! were busy all the time (0 = not measured yet)
+    double decodeRate();
+
+private:
+    enum class SlotState { Empty, Decoding, Ready };
+    struct Slot {
+        SlotState state = SlotState::Empty;
+        int64_t  step = 0;          //!< playback step the slot has been claimed for
+        unsigned generation = 0;    //!< value of m_generation at claim time
+        void*    data = nullptr;
+        int      width = 0, height = 0;
+    };
+
+    std::vector<std::string> m_frames;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    // protected by m_mutex:
+    bool     m_quit = false;
+    unsigned m_generation = 0;   //!< incremented whenever all pending work becomes obsolete
+    int64_t  m_want = 0;         //!< earliest step that's worth decoding
+    bool     m_pingPongW = false;  //!< copy of pingPong for the workers
+    std::vector<Slot> m_slots;
+    double   m_decodeTime = 0.0;   //!< total time spent decoding
+    int      m_decodeCount = 0;    //!< number of frames decoded
+    // owned by the main thread:
+    int64_t m_shown = -1;         //!< step of the frame currently on display
+    int     m_current = -1;       //!< frame index of m_shown
+    int64_t m_target = -1;        //!< step to show while paused or waiting for the clock to start
+    bool    m_clockRunning = false;
+    int64_t m_baseStep = 0;       //!< step that was due at m_baseTime
+    double  m_baseTime = 0.0;
+    int     m_dropped = 0;
+
+    int frameOf(int64_t step) const { return frameOf(step, m_pingPongW); }
+    int frameOf(int64_t step, bool pp) const;
+    void restart(int64_t shown);
+    void worker();
+    bool claimWork(size_t &slot, int64_t &step);
+    void clearSlots();
+};
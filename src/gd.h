@@ -10,9 +10,16 @@
 extern "C" {
 #endif
 
+// Images are stored as 8-bit indices into a color table as long as there
+// are at most 256 distinct colors (which is the case for everything but
+// truecolor ANSIs); after that, they're converted into 32-bit pixels.
+#define GD_MAX_COLORS 256
 typedef struct _gdimage {
     int sx, sy;
-    int *data;
+    int *data;              // 32-bit pixels (0x00RRGGBB), or NULL if indexed
+    unsigned char *index;   // color table indices, or NULL if 32-bit
+    int colors[GD_MAX_COLORS];
+    int numColors;
 } gdImage;
 typedef gdImage* gdImagePtr;
 
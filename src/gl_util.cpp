@@ -246,11 +246,12 @@ void FBO::free() {
     }
 }
 
-bool FBO::begin(GLuint tex) {
+bool FBO::begin(GLuint tex, int level) {
     if (!initialized || !id) { return false; }
     end();
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevBinding);
     glBindFramebuffer(GL_FRAMEBUFFER, id);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, level);
     status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     return (status == GL_FRAMEBUFFER_COMPLETE);
 }
@@ -258,7 +259,8 @@ bool FBO::begin(GLuint tex) {
 void FBO::end() {
     if (!initialized || !id || !status) { return; }
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0, 0, 0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, GLuint(prevBinding));
+    prevBinding = 0;
     status = 0;
 }
 
@@ -63,13 +63,16 @@ public:
     inline operator GLuint() const { return id; }
 };
 
+//! framebuffer object for rendering into a texture; end() re-binds the
+//! framebuffer that was bound when begin() was called
 class FBO {
 public:
     GLuint id = 0;
     GLenum status = 0;
+    GLint prevBinding = 0;
     bool init();
     void free();
-    bool begin(GLuint tex);
+    bool begin(GLuint tex, int level=0);
     void end();
     inline FBO() {}
     inline ~FBO() { free(); }
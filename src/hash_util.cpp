@@ -0,0 +1,144 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "hash_util.h"
+
+namespace HashUtil {
+
+// digest size in bytes
+static constexpr unsigned digestSize = 16u;
+
+static const uint64_t iv[8] = {
+    0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL, 0x3C6EF372FE94F82BULL, 0xA54FF53A5F1D36F1ULL,
+    0x510E527FADE682D1ULL, 0x9B05688C2B3E6C1FULL, 0x1F83D9ABFB41BD6BULL, 0x5BE0CD19137E2179ULL,
+};
+
+static const uint8_t sigma[12][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+};
+
+static inline uint64_t rotr(uint64_t x, int n) {
+    return (x >> n) | (x << (64 - n));
+}
+
+static inline uint64_t load64(const uint8_t* p) {
+    #if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        uint64_t x = 0;
+        for (int i = 7;  i >= 0;  --i) { x = (x << 8) | p[i]; }
+        return x;
+    #else
+        uint64_t x;
+        ::memcpy(static_cast<void*>(&x), static_cast<const void*>(p), 8u);
+        return x;
+    #endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void Hasher::reset() {
+    ::memcpy(static_cast<void*>(m_h), static_cast<const void*>(iv), sizeof(m_h));
+    m_h[0] ^= 0x01010000ULL ^ digestSize;  // no key, fan-out and depth 1
+    m_total = 0;
+    m_used = 0;
+}
+
+void Hasher::compress(const uint8_t* block, bool last) {
+    uint64_t m[16], v[16];
+    for (int i = 0;  i < 16;  ++i) { m[i] = load64(&block[i * 8]); }
+    for (int i = 0;  i < 8;  ++i) { v[i] = m_h[i];  v[i + 8] = iv[i]; }
+    v[12] ^= m_total;  // the counter's upper 64 bits stay zero
+    if (last) { v[14] = ~v[14]; }
+    #define HASHUTIL_G(a, b, c, d, x, y) do { \
+        v[a] = v[a] + v[b] + (x);  v[d] = rotr(v[d] ^ v[a], 32); \
+        v[c] = v[c] + v[d];        v[b] = rotr(v[b] ^ v[c], 24); \
+        v[a] = v[a] + v[b] + (y);  v[d] = rotr(v[d] ^ v[a], 16); \
+        v[c] = v[c] + v[d];        v[b] = rotr(v[b] ^ v[c], 63); \
+    } while (0)
+    #define HASHUTIL_ROUND(r) do { \
+        const uint8_t* s = sigma[r]; \
+        HASHUTIL_G(0, 4,  8, 12, m[s[ 0]], m[s[ 1]]); \
+        HASHUTIL_G(1, 5,  9, 13, m[s[ 2]], m[s[ 3]]); \
+        HASHUTIL_G(2, 6, 10, 14, m[s[ 4]], m[s[ 5]]); \
+        HASHUTIL_G(3, 7, 11, 15, m[s[ 6]], m[s[ 7]]); \
+        HASHUTIL_G(0, 5, 10, 15, m[s[ 8]], m[s[ 9]]); \
+        HASHUTIL_G(1, 6, 11, 12, m[s[10]], m[s[11]]); \
+        HASHUTIL_G(2, 7,  8, 13, m[s[12]], m[s[13]]); \
+        HASHUTIL_G(3, 4,  9, 14, m[s[14]], m[s[15]]); \
+    } while (0)
+    HASHUTIL_ROUND(0);  HASHUTIL_ROUND(1);  HASHUTIL_ROUND(2);  HASHUTIL_ROUND(3);
+    HASHUTIL_ROUND(4);  HASHUTIL_ROUND(5);  HASHUTIL_ROUND(6);  HASHUTIL_ROUND(7);
+    HASHUTIL_ROUND(8);  HASHUTIL_ROUND(9);  HASHUTIL_ROUND(10); HASHUTIL_ROUND(11);
+    #undef HASHUTIL_ROUND
+    #undef HASHUTIL_G
+    for (int i = 0;  i < 8;  ++i) { m_h[i] ^= v[i] ^ v[i + 8]; }
+}
+
+void Hasher::update(const void* data, size_t size) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    // the last block must be kept back, as it's compressed differently
+    while (size) {
+        if (m_used == sizeof(m_block)) {
+            m_total += sizeof(m_block);
+            compress(m_block, false);
+            m_used = 0;
+        }
+        if (!m_used && (size > sizeof(m_block))) {
+            // full blocks straight from the input, without copying
+            m_total += sizeof(m_block);
+            compress(p, false);
+            p += sizeof(m_block);
+            size -= sizeof(m_block);
+            continue;
+        }
+        size_t n = sizeof(m_block) - m_used;
+        if (n > size) { n = size; }
+        ::memcpy(static_cast<void*>(&m_block[m_used]), static_cast<const void*>(p), n);
+        m_used += n;
+        p += n;
+        size -= n;
+    }
+}
+
+Digest Hasher::finish() {
+    m_total += m_used;
+    ::memset(static_cast<void*>(&m_block[m_used]), 0, sizeof(m_block) - m_used);
+    compress(m_block, true);
+    Digest d;
+    d.h[0] = m_h[0];
+    d.h[1] = m_h[1];
+    reset();
+    return d;
+}
+
+Digest hash(const void* data, size_t size) {
+    Hasher h;
+    h.update(data, size);
+    return h.finish();
+}
+
+void Digest::toHex(char* str) const {
+    // the byte order of the BLAKE2b output, so it matches other implementations
+    for (unsigned i = 0;  i < digestSize;  ++i) {
+        snprintf(&str[i * 2u], 3, "%02x", unsigned(h[i >> 3] >> ((i & 7u) * 8u)) & 0xFFu);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}  // namespace HashUtil
@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace HashUtil {
+
+///////////////////////////////////////////////////////////////////////////////
+
+//! 128-bit content hash
+struct Digest {
+    uint64_t h[2] = { 0, 0 };
+    inline bool operator== (const Digest& other) const { return (h[0] == other.h[0]) && (h[1] == other.h[1]); }
+    inline bool operator!= (const Digest& other) const { return !(*this == other); }
+
+    //! format as 32 lowercase hex digits into `str`, which must have room
+    //! for at least 33 characters (including the terminating null byte)
+    void toHex(char* str) const;
+};
+
+//! incremental BLAKE2b hasher with a 128-bit digest (RFC 7693); unlike a
+//! simple non-cryptographic hash, it's not feasible to construct a different
+//! file with the same hash, so it can identify file contents on its own
+class Hasher {
+    uint64_t m_h[8];
+    uint64_t m_total = 0;    //!< number of bytes compressed so far
+    uint8_t  m_block[128];
+    size_t   m_used = 0;     //!< number of bytes in m_block
+    void compress(const uint8_t* block, bool last);
+public:
+    inline Hasher() { reset(); }
+    void reset();
+    void update(const void* data, size_t size);
+    Digest finish();
+};
+
+//! hash a complete buffer
+Digest hash(const void* data, size_t size);
+
+///////////////////////////////////////////////////////////////////////////////
+
+}  // namespace HashUtil
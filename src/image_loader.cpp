@@ -0,0 +1,335 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <climits>
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "stb_image.h"
+
+#include "string_util.h"
+#include "file_util.h"
+#include "exif_util.h"
+#include "tex_compress.h"
+
+#include "image_loader.h"
+
+// maximum width or height of the thumbnails stored in the disk cache
+static constexpr int maxThumbSize = 512;
+
+// maximum relative difference between the aspect ratios of an embedded
+// thumbnail and the actual image before the thumbnail is cropped
+// (EXIF thumbnails are often letterboxed to a fixed 4:3 or 16:9 size)
+static constexpr double maxAspectError = 0.02;
+
+// thumbnail cache file header
+static constexpr char thumbMagic[8] = { 'P', 'X', 'V', 'T', 'H', 'M', 'B', '\n' };
+struct ThumbHeader {
+    char     magic[8];
+    uint32_t width;
+    uint32_t height;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: preview
+///////////////////////////////////////////////////////////////////////////////
+
+char* ImageLoader::thumbnailPath(const HashUtil::Digest& hash, size_t size) {
+    char* dir = FileUtil::getCacheDirectory();
+    if (!dir) { return nullptr; }
+    char hex[33], name[64];
+    hash.toHex(hex);
+    snprintf(name, sizeof(name), "%s-%llx.thumb", hex, static_cast<unsigned long long>(size));
+    char* path = StringUtil::pathJoin(dir, name);
+    ::free(dir);
+    return path;
+}
+
+static void* loadCachedThumbnail(const char* path, int &width, int &height) {
+    if (!path) { return nullptr; }
+    FILE* f = fopen(path, "rb");
+    if (!f) { return nullptr; }
+    void* data = nullptr;
+    ThumbHeader hdr;
+    if ((fread(static_cast<void*>(&hdr), sizeof(hdr), 1, f) == 1)
+    && !memcmp(hdr.magic, thumbMagic, sizeof(thumbMagic))
+    && (hdr.width  > 0u) && (hdr.width  <= uint32_t(maxThumbSize))
+    && (hdr.height > 0u) && (hdr.height <= uint32_t(maxThumbSize))) {
+        size_t bytes = size_t(hdr.width) * size_t(hdr.height) * 4u;
+        data = malloc(bytes);
+        if (data && (fread(data, 1, bytes, f) == bytes)) {
+            width  = int(hdr.width);
+            height = int(hdr.height);
+        } else {
+            ::free(data);
+            data = nullptr;
+        }
+    }
+    fclose(f);
+    if (data) { FileUtil::touchFile(path); }  // keep it from being evicted
+    return data;
+}
+
+static void* loadEmbeddedThumbnail(const uint8_t* file, size_t size, int fullWidth, int fullHeight, int &width, int &height) {
+    size_t offset = 0, thumbSize = 0;
+    if (!ExifUtil::findThumbnail(file, size, offset, thumbSize) || (thumbSize > size_t(INT_MAX))) { return nullptr; }
+    int w = 0, h = 0;
+    uint8_t* data = stbi_load_from_memory(&file[offset], int(thumbSize), &w, &h, nullptr, 4);
+    if (!data) { return nullptr; }
+
+    // crop away letterboxing, so the thumbnail's content lines up
+    // with the actual image when it's stretched to its size
+    double aspect = (double(w) * double(fullHeight)) / (double(h) * double(fullWidth));
+    int x0 = 0, y0 = 0, cw = w, ch = h;
+    if (aspect > (1.0 + maxAspectError)) {
+        cw = std::max(1, int(double(h) * double(fullWidth) / double(fullHeight) + 0.5));
+        x0 = (w - cw) >> 1;
+    } else if (aspect < (1.0 - maxAspectError)) {
+        ch = std::max(1, int(double(w) * double(fullHeight) / double(fullWidth) + 0.5));
+        y0 = (h - ch) >> 1;
+    }
+    if ((cw != w) || (ch != h)) {
+        for (int y = 0;  y < ch;  ++y) {
+            memmove(static_cast<void*>(&data[size_t(y) * size_t(cw) * 4u]),
+                    static_cast<const void*>(&data[(size_t(y + y0) * size_t(w) + size_t(x0)) * 4u]),
+                    size_t(cw) * 4u);
+        }
+    }
+    width = cw;
+    height = ch;
+    return data;
+}
+
+void* ImageLoader::loadPreview(const uint8_t* file, size_t size, const HashUtil::Digest& hash, int fullWidth, int fullHeight, int &width, int &height) {
+    if (!file || (fullWidth <= 0) || (fullHeight <= 0)) { return nullptr; }
+    char* path = thumbnailPath(hash, size);
+    void* data = loadCachedThumbnail(path, width, height);
+    ::free(path);
+    #ifndef NDEBUG
+        if (data) { printf("preview: using cached %dx%d thumbnail\n", width, height); }
+    #endif
+    if (!data) {
+        data = loadEmbeddedThumbnail(file, size, fullWidth, fullHeight, width, height);
+        #ifndef NDEBUG
+            if (data) { printf("preview: using embedded %dx%d thumbnail\n", width, height); }
+        #endif
+    }
+    return data;
+}
+
+void ImageLoader::saveThumbnail(const char* path, const uint8_t* rgba, int width, int height) {
+    if (!path || !rgba) { return; }
+
+    // box-filter the image down by an integer factor; that's not the
+    // prettiest possible result, but good enough for a short-lived preview
+    int factor = (std::max(width, height) + maxThumbSize - 1) / maxThumbSize;
+    if (factor < 2) { return; }  // small images don't need a preview
+    int tw = width / factor, th = height / factor;
+    if ((tw < 1) || (th < 1)) { return; }
+    std::vector<uint8_t> thumb(size_t(tw) * size_t(th) * 4u);
+    std::vector<uint32_t> sum(size_t(tw) * 4u);
+    uint32_t area = uint32_t(factor * factor);
+    for (int ty = 0;  ty < th;  ++ty) {
+        std::fill(sum.begin(), sum.end(), 0u);
+        for (int y = ty * factor;  y < (ty + 1) * factor;  ++y) {
+            const uint8_t* src = &rgba[size_t(y) * size_t(width) * 4u];
+            uint32_t* dest = sum.data();
+            for (int tx = 0;  tx < tw;  ++tx) {
+                for (int x = 0;  x < factor;  ++x) {
+                    dest[0] += src[0];  dest[1] += src[1];  dest[2] += src[2];  dest[3] += src[3];
+                    src += 4;
+                }
+                dest += 4;
+            }
+        }
+        uint8_t* dest = &thumb[size_t(ty) * size_t(tw) * 4u];
+        for (size_t i = 0;  i < sum.size();  ++i) {
+            dest[i] = uint8_t((sum[i] + (area >> 1)) / area);
+        }
+    }
+
+    // write into a temporary file first, as in TexCompress::saveCache()
+    char* tempPath = StringUtil::concat(path, ".tmp");
+    if (!tempPath) { return; }
+    FILE* f = fopen(tempPath, "wb");
+    bool ok = (f != nullptr);
+    if (ok) {
+        ThumbHeader hdr;
+        ::memcpy(static_cast<void*>(hdr.magic), static_cast<const void*>(thumbMagic), sizeof(thumbMagic));
+        hdr.width  = uint32_t(tw);
+        hdr.height = uint32_t(th);
+        ok = (fwrite(static_cast<const void*>(&hdr), sizeof(hdr), 1, f) == 1)
+          && (fwrite(static_cast<const void*>(thumb.data()), 1, thumb.size(), f) == thumb.size());
+        ok = !fclose(f) && ok;
+    }
+    if (ok) {
+        remove(path);  // required on Windows, where rename() doesn't overwrite
+        ok = !rename(tempPath, path);
+    }
+    if (!ok) { remove(tempPath); }
+    ::free(tempPath);
+    if (ok) { FileUtil::trimCacheDirectory(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: control
+///////////////////////////////////////////////////////////////////////////////
+
+void ImageLoader::start(const char* path, void* file, size_t size, const HashUtil::Digest& hash, const FileUtil::FileFingerprint& fp, int width, int height, bool compress) {
+    if (!m_thread.joinable()) {
+        m_quit = false;
+        m_thread = std::thread([this] { worker(); });
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ::free(m_job.file);
+        m_job.path = path;
+        m_job.file = file;
+        m_job.size = size;
+        m_job.hash = hash;
+        m_job.fp = fp;
+        m_job.compress = compress;
+        m_job.generation = ++m_generation;
+        m_hasJob = true;
+        discardResult();
+    }
+    m_cv.notify_one();
+    m_pending = true;
+    m_width = width;
+    m_height = height;
+}
+
+void ImageLoader::cancel() {
+    if (!m_pending) { return; }
+    // a decode that's already running can't be interrupted; its result
+    // is simply thrown away when it's finished
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_generation;
+    ::free(m_job.file);
+    m_job = Job();
+    m_hasJob = false;
+    discardResult();
+    m_pending = false;
+}
+
+void ImageLoader::stop() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+            ++m_generation;
+        }
+        m_cv.notify_all();
+        m_thread.join();
+    }
+    ::free(m_job.file);
+    m_job = Job();
+    m_hasJob = false;
+    discardResult();
+    m_pending = false;
+}
+
+bool ImageLoader::fetch(Result& result) {
+    if (!m_pending) { return false; }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_hasResult) { return false; }
+    result = std::move(m_result);
+    m_result = Result();
+    m_hasResult = false;
+    m_pending = false;
+    return true;
+}
+
+bool ImageLoader::isCurrent(unsigned generation) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_quit && (generation == m_generation);
+}
+
+void ImageLoader::discardResult() {
+    ::free(m_result.data);
+    m_result = Result();
+    m_hasResult = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: worker
+///////////////////////////////////////////////////////////////////////////////
+
+void ImageLoader::worker() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_quit || m_hasJob; });
+            if (m_quit) { break; }
+            job = std::move(m_job);
+            m_job = Job();
+            m_hasJob = false;
+        }
+        Result result;
+        decode(job, result);
+        ::free(job.file);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_quit && (job.generation == m_generation)) {
+            discardResult();
+            m_result = std::move(result);
+            m_hasResult = true;
+        } else {
+            ::free(result.data);
+        }
+    }
+}
+
+void ImageLoader::decode(const Job& job, Result& result) {
+    result.path = job.path;
+    result.hash = job.hash;
+    result.fileSize = job.size;
+    result.fp = job.fp;
+    #ifndef NDEBUG
+        printf("background decode: '%s'\n", job.path.c_str());
+    #endif
+    if (job.size <= size_t(INT_MAX)) {
+        result.data = stbi_load_from_memory(static_cast<const stbi_uc*>(job.file), int(job.size), &result.width, &result.height, nullptr, 4);
+    }
+    if (!result.data) { return; }
+    const uint8_t* rgba = static_cast<const uint8_t*>(result.data);
+
+    // store a thumbnail, so the next time the file is opened, the preview
+    // is available even if the file doesn't have an embedded thumbnail;
+    // if there already is one (e.g. the preview came from it), it's just
+    // marked as used (touchFile() fails if the file doesn't exist)
+    char* path = thumbnailPath(job.hash, job.size);
+    if (path && !FileUtil::touchFile(path)) {
+        saveThumbnail(path, rgba, result.width, result.height);
+    }
+    ::free(path);
+
+    // compress the image here as well, so that the main thread only needs
+    // to upload the result; there's no point in doing that if the image
+    // isn't going to be shown anyway
+    if (job.compress && isCurrent(job.generation) && TexCompress::isOpaque(rgba, result.width, result.height)) {
+        auto t0 = std::chrono::steady_clock::now();
+        if (TexCompress::encode(rgba, result.width, result.height, result.compressed)) {
+            result.encodeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            char* cacheFile = TexCompress::cachePath(job.hash, job.size);
+            TexCompress::saveCache(cacheFile, result.compressed);
+            ::free(cacheFile);
+            #ifndef NDEBUG
+                printf("compressed %dx%d image in %.0f ms\n", result.width, result.height, 1000.0 * result.encodeTime);
+            #endif
+            ::free(result.data);
+            result.data = nullptr;
+        } else {
+            result.compressed = TexCompress::Image();
+        }
+    }
+}
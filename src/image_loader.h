@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "file_util.h"
+#include "hash_util.h"
+#include "tex_compress.h"
+
+//! background decoder for large image files; while the full image is being
+//! decoded, a low-resolution preview can be shown, which comes from a
+//! thumbnail that has been cached on disk when the file has been opened
+//! before, or from the thumbnail embedded in the file's EXIF data
+class ImageLoader {
+public:
+    //! a fully decoded image, as returned by fetch()
+    struct Result {
+        std::string path;             //!< source file name
+        void*    data   = nullptr;    //!< RGBA pixels (malloc'd; the caller needs to free() them),
+                                      //!< or nullptr if decoding failed or the image has been compressed
+        int      width  = 0;
+        int      height = 0;
+        TexCompress::Image compressed;  //!< DXT1 version of the image, if compression has been requested
+        double   encodeTime = 0.0;    //!< time spent compressing the image in seconds
+        HashUtil::Digest hash;        //!< content hash of the source file (see TextureCache::loadFile())
+        size_t   fileSize = 0;        //!< size of the source file
+        FileUtil::FileFingerprint fp; //!< fingerprint of the source file before it has been read
+    };
+
+    //! get a preview of an image file that's already in memory, if possible;
+    //! `fullWidth` and `fullHeight` are the size of the actual image
+    //! \returns newly-malloc'd RGBA pixels (to be free()d by the caller), or nullptr
+    static void* loadPreview(const uint8_t* file, size_t size, const HashUtil::Digest& hash, int fullWidth, int fullHeight, int &width, int &height);
+
+    inline ImageLoader() {}
+    inline ~ImageLoader() { stop(); }
+
+    //! start decoding an image file (already loaded into memory) in the
+    //! background, replacing any previous request; takes ownership of the
+    //! malloc'd file data. `width` and `height` are the expected image size,
+    //! `fp` is the fingerprint of the file (passed through to the result).
+    //! If `compress` is set, opaque images are DXT1-compressed too.
+    void start(const char* path, void* file, size_t size, const HashUtil::Digest& hash, const FileUtil::FileFingerprint& fp, int width, int height, bool compress);
+
+    //! forget about the current request (its result will be discarded)
+    void cancel();
+
+    //! stop the worker thread
+    void stop();
+
+    //! check whether there's a request whose result hasn't been fetched yet
+    inline bool pending() const { return m_pending; }
+    inline int width()  const { return m_width; }
+    inline int height() const { return m_height; }
+
+    //! get the result of the current request, if it's finished
+    bool fetch(Result& result);
+
+private:
+    struct Job {
+        std::string path;
+        void*    file = nullptr;
+        size_t   size = 0;
+        HashUtil::Digest hash;
+        FileUtil::FileFingerprint fp;
+        bool     compress = false;
+        unsigned generation = 0;
+    };
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    // protected by m_mutex:
+    bool     m_quit = false;
+    unsigned m_generation = 0;      //!< ID of the current request
+    Job      m_job;                 //!< request that hasn't been started yet
+    bool     m_hasJob = false;
+    Result   m_result;              //!< result that hasn't been fetched yet
+    bool     m_hasResult = false;
+    // owned by the main thread:
+    bool m_pending = false;
+    int  m_width = 0, m_height = 0;
+
+    void worker();
+    void decode(const Job& job, Result& result);
+    bool isCurrent(unsigned generation);
+    void discardResult();
+    static char* thumbnailPath(const HashUtil::Digest& hash, size_t size);
+    static void saveThumbnail(const char* path, const uint8_t* rgba, int width, int height);
+};
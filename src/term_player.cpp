@@ -0,0 +1,862 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "string_util.h"
+
+#include "term_player.h"
+
+// terminal size if the recording doesn't specify it
+static constexpr int defaultCols = 80;
+static constexpr int defaultRows = 24;
+
+// maximum terminal size
+static constexpr int maxCols = 400;
+static constexpr int maxRows = 200;
+
+// keyframes are taken after this many seconds or bytes of output,
+// whichever comes first; this bounds the amount of output that needs to be
+// processed again for a seek
+static constexpr double keyframeInterval = 5.0;
+static constexpr size_t keyframeBytes    = 256 * 1024;
+
+// the maximum wall-clock time step per advance() call; avoids jumps after stalls
+static constexpr double maxTimeStep = 0.25;
+
+const uint32_t TermPlayer::fileExts[] = {
+    StringUtil::makeExtCode("ttyrec"),
+    StringUtil::makeExtCode("tty"),
+    StringUtil::makeExtCode("cast"),
+    0
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: character sets and colors
+///////////////////////////////////////////////////////////////////////////////
+
+// Unicode code points of CP437 characters 0x80...0xFF
+static const uint16_t cp437Upper[128] = {
+    0x00C7, 0x00FC, 0x00E9, 0x00E2, 0x00E4, 0x00E0, 0x00E5, 0x00E7, 0x00EA, 0x00EB, 0x00E8, 0x00EF, 0x00EE, 0x00EC, 0x00C4, 0x00C5,
+    0x00C9, 0x00E6, 0x00C6, 0x00F4, 0x00F6, 0x00F2, 0x00FB, 0x00F9, 0x00FF, 0x00D6, 0x00DC, 0x00A2, 0x00A3, 0x00A5, 0x20A7, 0x0192,
+    0x00E1, 0x00ED, 0x00F3, 0x00FA, 0x00F1, 0x00D1, 0x00AA, 0x00BA, 0x00BF, 0x2310, 0x00AC, 0x00BD, 0x00BC, 0x00A1, 0x00AB, 0x00BB,
+    0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x2561, 0x2562, 0x2556, 0x2555, 0x2563, 0x2551, 0x2557, 0x255D, 0x255C, 0x255B, 0x2510,
+    0x2514, 0x2534, 0x252C, 0x251C, 0x2500, 0x253C, 0x255E, 0x255F, 0x255A, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256C, 0x2567,
+    0x2568, 0x2564, 0x2565, 0x2559, 0x2558, 0x2552, 0x2553, 0x256B, 0x256A, 0x2518, 0x250C, 0x2588, 0x2584, 0x258C, 0x2590, 0x2580,
+    0x03B1, 0x00DF, 0x0393, 0x03C0, 0x03A3, 0x03C3, 0x00B5, 0x03C4, 0x03A6, 0x0398, 0x03A9, 0x03B4, 0x221E, 0x03C6, 0x03B5, 0x2229,
+    0x2261, 0x00B1, 0x2265, 0x2264, 0x2320, 0x2321, 0x00F7, 0x2248, 0x00B0, 0x2219, 0x00B7, 0x221A, 0x207F, 0x00B2, 0x25A0, 0x00A0,
+};
+
+// additional characters that are commonly used by terminal applications,
+// mapped to their closest CP437 equivalent
+static const struct { uint16_t cp; uint8_t ch; } extraChars[] = {
+    { 0x2022, 0x07 },  // bullet
+    { 0x25CF, 0x07 },  // black circle
+    { 0x2190, 0x1B }, { 0x2191, 0x18 }, { 0x2192, 0x1A }, { 0x2193, 0x19 },  // arrows
+    { 0x25B2, 0x1E }, { 0x25BA, 0x10 }, { 0x25B6, 0x10 }, { 0x25BC, 0x1F }, { 0x25C4, 0x11 }, { 0x25C0, 0x11 },  // triangles
+    { 0x2018, '\'' }, { 0x2019, '\'' }, { 0x201C, '"' }, { 0x201D, '"' },
+    { 0x2013, '-' }, { 0x2014, '-' }, { 0x2026, 0xFA },
+    { 0x2501, 0xC4 }, { 0x2503, 0xB3 },  // heavy lines
+    { 0x256D, 0xDA }, { 0x256E, 0xBF }, { 0x256F, 0xD9 }, { 0x2570, 0xC0 },  // rounded corners
+    { 0, 0 }
+};
+
+// DEC special graphics character set, characters 0x5F...0x7E
+static const uint8_t decGraphics[32] = {
+    0x20, 0x04, 0xB1, 0x20, 0x20, 0x20, 0x20, 0xF8, 0xF1, 0x20, 0x20, 0xD9, 0xBF, 0xDA, 0xC0, 0xC5,
+    0xC4, 0xC4, 0xC4, 0xC4, 0x5F, 0xC3, 0xB4, 0xC1, 0xC2, 0xB3, 0xF3, 0xF2, 0xE3, 0x23, 0x9C, 0xFA,
+};
+
+// ANSI color order (RGB bit order) to PC color order (BGR bit order)
+static const uint8_t ansiToPC[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+
+// the 16-color VGA palette, in PC color order
+static const uint8_t vgaPalette[16][3] = {
+    {   0,   0,   0 }, {   0,   0, 170 }, {   0, 170,   0 }, {   0, 170, 170 },
+    { 170,   0,   0 }, { 170,   0, 170 }, { 170,  85,   0 }, { 170, 170, 170 },
+    {  85,  85,  85 }, {  85,  85, 255 }, {  85, 255,  85 }, {  85, 255, 255 },
+    { 255,  85,  85 }, { 255,  85, 255 }, { 255, 255,  85 }, { 255, 255, 255 },
+};
+
+//! find the closest PC color for an RGB color
+static uint8_t nearestPCColor(int r, int g, int b) {
+    int best = 0, bestDist = 0x7FFFFFFF;
+    for (int i = 0;  i < 16;  ++i) {
+        int dr = r - vgaPalette[i][0], dg = g - vgaPalette[i][1], db = b - vgaPalette[i][2];
+        int dist = dr * dr + dg * dg + db * db;
+        if (dist < bestDist) { best = i; bestDist = dist; }
+    }
+    return uint8_t(best);
+}
+
+//! convert a color from the xterm 256-color palette into a PC color
+static uint8_t xtermToPC(int index) {
+    if (index < 8)  { return ansiToPC[std::max(index, 0)]; }
+    if (index < 16) { return ansiToPC[index - 8] | 8; }
+    if (index < 232) {
+        index -= 16;
+        auto level = [] (int l) -> int { return l ? (55 + 40 * l) : 0; };
+        return nearestPCColor(level(index / 36), level((index / 6) % 6), level(index % 6));
+    }
+    int gray = 8 + 10 * (std::min(index, 255) - 232);
+    return nearestPCColor(gray, gray, gray);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: terminal emulator
+///////////////////////////////////////////////////////////////////////////////
+
+void TermPlayer::Terminal::resize(int newCols, int newRows) {
+    newCols = std::max(1, std::min(newCols, maxCols));
+    newRows = std::max(1, std::min(newRows, maxRows));
+    std::vector<uint8_t> newCells(size_t(newCols) * size_t(newRows) * 2u);
+    for (size_t i = 0;  i < newCells.size();  i += 2u) {
+        newCells[i] = 0x20;  newCells[i + 1u] = 0x07;
+    }
+    if (cells.size() == (size_t(cols) * size_t(rows) * 2u)) {
+        int copyCols = std::min(cols, newCols);
+        for (int r = std::min(rows, newRows) - 1;  r >= 0;  --r) {
+            ::memcpy(&newCells[size_t(r) * size_t(newCols) * 2u], &cells[size_t(r) * size_t(cols) * 2u], size_t(copyCols) * 2u);
+        }
+    }
+    altCells.assign(newCells.size(), 0);
+    for (size_t i = 0;  i < altCells.size();  i += 2u) {
+        altCells[i] = 0x20;  altCells[i + 1u] = 0x07;
+    }
+    cells.swap(newCells);
+    cols = newCols;
+    rows = newRows;
+    top = 0;
+    bottom = rows;
+    x = std::min(x, cols - 1);
+    y = std::min(y, rows - 1);
+    wrapPending = false;
+    markDirty(0, rows);
+}
+
+void TermPlayer::Terminal::reset() {
+    attr = savedAttr = Attr();
+    x = y = savedX = savedY = 0;
+    wrapPending = lineDrawing = altScreen = false;
+    state = 0;
+    utf8Len = utf8Need = 0;
+    cells.clear();  // don't keep the old contents
+    resize(cols, rows);
+}
+
+uint8_t TermPlayer::Terminal::cellAttr() const {
+    uint8_t fg = attr.fg, bg = attr.bg;
+    if (attr.bold && (fg < 8)) { fg |= 8; }
+    if (attr.reverse) { std::swap(fg, bg); }
+    uint8_t a = uint8_t((fg & 15) | ((bg & 7) << 4));
+    if ((bg & 8) || attr.blink) { a |= 0x80; }  // bright background in iCE color mode
+    return a;
+}
+
+void TermPlayer::Terminal::markDirty(int r0, int r1) {
+    if (r0 >= r1) { return; }
+    if (dirtyBegin >= dirtyEnd) {
+        dirtyBegin = r0;
+        dirtyEnd   = r1;
+    } else {
+        dirtyBegin = std::min(dirtyBegin, r0);
+        dirtyEnd   = std::max(dirtyEnd,   r1);
+    }
+}
+
+void TermPlayer::Terminal::put(uint8_t ch) {
+    if (wrapPending) {
+        x = 0;
+        lineFeed();
+        wrapPending = false;
+    }
+    uint8_t* cell = &cells[(size_t(y) * size_t(cols) + size_t(x)) * 2u];
+    cell[0] = ch;
+    cell[1] = cellAttr();
+    markDirty(y, y + 1);
+    if ((x + 1) >= cols) { wrapPending = true; } else { ++x; }
+}
+
+void TermPlayer::Terminal::putCodepoint(uint32_t cp) {
+    if (cp < 0x80) { put(uint8_t(cp)); return; }
+    if ((cp >= 0x0300) && (cp < 0x0370)) { return; }  // combining diacritics
+    for (int i = 0;  i < 128;  ++i) {
+        if (cp437Upper[i] == cp) { put(uint8_t(0x80 + i)); return; }
+    }
+    for (int i = 0;  extraChars[i].cp;  ++i) {
+        if (extraChars[i].cp == cp) { put(extraChars[i].ch); return; }
+    }
+    put('?');
+}
+
+void TermPlayer::Terminal::lineFeed() {
+    if ((y + 1) == bottom) {
+        scroll(top, bottom, 1);
+    } else if ((y + 1) < rows) {
+        ++y;
+    }
+}
+
+void TermPlayer::Terminal::scroll(int r0, int r1, int n) {
+    // scroll the rows [r0, r1) up (n > 0) or down (n < 0) by |n| rows
+    r0 = std::max(r0, 0);
+    r1 = std::min(r1, rows);
+    if ((r0 >= r1) || !n) { return; }
+    int count = std::min(std::abs(n), r1 - r0);
+    size_t pitch = size_t(cols) * 2u;
+    size_t moveSize = size_t(r1 - r0 - count) * pitch;
+    if (n > 0) {
+        ::memmove(&cells[size_t(r0) * pitch], &cells[size_t(r0 + count) * pitch], moveSize);
+        eraseRows(r1 - count, r1);
+    } else {
+        ::memmove(&cells[size_t(r0 + count) * pitch], &cells[size_t(r0) * pitch], moveSize);
+        eraseRows(r0, r0 + count);
+    }
+    markDirty(r0, r1);
+}
+
+void TermPlayer::Terminal::erase(int row, int c0, int c1) {
+    if ((row < 0) || (row >= rows)) { return; }
+    c0 = std::max(c0, 0);
+    c1 = std::min(c1, cols);
+    if (c0 >= c1) { return; }
+    uint8_t a = cellAttr();
+    uint8_t* cell = &cells[(size_t(row) * size_t(cols) + size_t(c0)) * 2u];
+    for (int c = c0;  c < c1;  ++c) {
+        *cell++ = 0x20;
+        *cell++ = a;
+    }
+    markDirty(row, row + 1);
+}
+
+void TermPlayer::Terminal::eraseRows(int r0, int r1) {
+    for (int r = r0;  r < r1;  ++r) { erase(r, 0, cols); }
+}
+
+void TermPlayer::Terminal::feed(const uint8_t* data, size_t size) {
+    enum State { stGround = 0, stEscape, stCSI, stOSC, stOSCEscape, stCharset, stSkip };
+    for (;  size;  --size) {
+        uint8_t b = *data++;
+        switch (state) {
+            case stGround:
+                if (utf8Need) {
+                    if ((b & 0xC0) == 0x80) {
+                        utf8[utf8Len++] = b;
+                        if (!--utf8Need) {
+                            uint32_t cp = uint32_t(utf8[0]) & (0x7Fu >> utf8Len);
+                            for (int i = 1;  i < utf8Len;  ++i) { cp = (cp << 6) | (utf8[i] & 0x3Fu); }
+                            putCodepoint(cp);
+                            utf8Len = 0;
+                        }
+                        continue;
+                    }
+                    // not valid UTF-8 -> assume raw CP437 instead
+                    for (int i = 0;  i < utf8Len;  ++i) { put(utf8[i]); }
+                    utf8Len = utf8Need = 0;
+                }
+                if (b == 0x1B) { state = stEscape; }
+                else if (b >= 0x80) {
+                    utf8Need = ((b >= 0xC2) && (b <= 0xDF)) ? 1
+                             : ((b >= 0xE0) && (b <= 0xEF)) ? 2
+                             : ((b >= 0xF0) && (b <= 0xF4)) ? 3 : 0;
+                    if (utf8Need) { utf8[0] = b;  utf8Len = 1; } else { put(b); }
+                }
+                else if (b >= 0x20) {
+                    put((lineDrawing && (b >= 0x5F) && (b < 0x7F)) ? decGraphics[b - 0x5F] : b);
+                }
+                else switch (b) {
+                    case 0x08: if (x > 0) { --x; }  wrapPending = false; break;
+                    case 0x09: x = std::min(cols - 1, (x + 8) & ~7);  break;
+                    case 0x0A: case 0x0B: case 0x0C: lineFeed(); wrapPending = false; break;
+                    case 0x0D: x = 0;  wrapPending = false; break;
+                    default: break;
+                }
+                break;
+
+            case stEscape:
+                state = stGround;
+                switch (b) {
+                    case '[':
+                        state = stCSI;
+                        ::memset(static_cast<void*>(params), 0, sizeof(params));
+                        numParams = 0;
+                        privateMode = false;
+                        break;
+                    case ']': state = stOSC;     break;
+                    case '(': state = stCharset; break;
+                    case ')': case '*': case '+': case '#': case '%': state = stSkip; break;
+                    case '7': savedX = x;  savedY = y;  savedAttr = attr; break;
+                    case '8': x = savedX;  y = savedY;  attr = savedAttr;  wrapPending = false; break;
+                    case 'D': lineFeed(); break;
+                    case 'E': x = 0;  lineFeed();  wrapPending = false; break;
+                    case 'M': if (y == top) { scroll(top, bottom, -1); } else if (y > 0) { --y; } break;
+                    case 'c': reset(); break;
+                    default: break;
+                }
+                break;
+
+            case stCSI:
+                if ((b >= '0') && (b <= '9')) {
+                    if (!numParams) { numParams = 1; }
+                    int& p = params[numParams - 1];
+                    p = std::min(p * 10 + (b - '0'), 9999);
+                } else if (b == ';') {
+                    if (!numParams) { numParams = 1; }
+                    if (numParams < 16) { numParams++; }
+                } else if ((b >= '<') && (b <= '?')) {
+                    privateMode = true;
+                } else if ((b >= 0x40) && (b <= 0x7E)) {
+                    csi(b);
+                    state = stGround;
+                } else if (b == 0x1B) {
+                    state = stEscape;  // aborted sequence
+                }   // anything else (intermediate bytes etc.) is ignored
+                break;
+
+            case stOSC:
+                if (b == 0x07) { state = stGround; }
+                else if (b == 0x1B) { state = stOSCEscape; }
+                break;
+
+            case stCharset:
+                lineDrawing = (b == '0');
+                state = stGround;
+                break;
+
+            default:  // stOSCEscape, stSkip
+                state = stGround;
+                break;
+        }
+    }
+}
+
+void TermPlayer::Terminal::csi(uint8_t final) {
+    int n = param(0);
+    if (privateMode) {
+        // only the alternate screen buffer is relevant for display
+        if (((final == 'h') || (final == 'l')) && ((params[0] == 47) || (params[0] == 1047) || (params[0] == 1049))) {
+            bool enable = (final == 'h');
+            if (enable == altScreen) { return; }
+            if (enable && (params[0] == 1049)) { savedX = x;  savedY = y;  savedAttr = attr; }
+            cells.swap(altCells);
+            altScreen = enable;
+            if (enable) { eraseRows(0, rows); }
+            if (!enable && (params[0] == 1049)) { x = savedX;  y = savedY;  attr = savedAttr; }
+            markDirty(0, rows);
+        }
+        return;
+    }
+    switch (final) {
+        case 'A': y = std::max(y - n, 0);         break;
+        case 'B': y = std::min(y + n, rows - 1);  break;
+        case 'C': x = std::min(x + n, cols - 1);  break;
+        case 'D': x = std::max(x - n, 0);         break;
+        case 'E': x = 0;  y = std::min(y + n, rows - 1);  break;
+        case 'F': x = 0;  y = std::max(y - n, 0);         break;
+        case 'G': case '`': x = std::min(n - 1, cols - 1);  break;
+        case 'd':           y = std::min(n - 1, rows - 1);  break;
+        case 'H': case 'f':
+            y = std::min(param(0) - 1, rows - 1);
+            x = std::min(param(1) - 1, cols - 1);
+            break;
+        case 'J':
+            switch (param(0, 0)) {
+                case 0:  erase(y, x, cols);  eraseRows(y + 1, rows);  break;
+                case 1:  eraseRows(0, y);  erase(y, 0, x + 1);  break;
+                default: eraseRows(0, rows);  break;
+            }
+            break;
+        case 'K':
+            switch (param(0, 0)) {
+                case 0:  erase(y, x, cols);   break;
+                case 1:  erase(y, 0, x + 1);  break;
+                default: erase(y, 0, cols);   break;
+            }
+            break;
+        case 'L': if ((y >= top) && (y < bottom)) { scroll(y, bottom, -n); } break;
+        case 'M': if ((y >= top) && (y < bottom)) { scroll(y, bottom,  n); } break;
+        case '@': case 'P': {
+            n = std::min(n, cols - x);
+            uint8_t* row = &cells[size_t(y) * size_t(cols) * 2u];
+            size_t moveSize = size_t(cols - x - n) * 2u;
+            if (final == '@') {
+                ::memmove(&row[size_t(x + n) * 2u], &row[size_t(x) * 2u], moveSize);
+                erase(y, x, x + n);
+            } else {
+                ::memmove(&row[size_t(x) * 2u], &row[size_t(x + n) * 2u], moveSize);
+                erase(y, cols - n, cols);
+            }
+            markDirty(y, y + 1);
+            break; }
+        case 'X': erase(y, x, x + n);  break;
+        case 'S': scroll(top, bottom,  n);  break;
+        case 'T': scroll(top, bottom, -n);  break;
+        case 'm': sgr();  break;
+        case 'r':
+            top    = std::min(param(0) - 1, rows - 1);
+            bottom = std::min(param(1, rows), rows);
+            if (top >= bottom) { top = 0;  bottom = rows; }
+            x = y = 0;
+            break;
+        case 's': savedX = x;  savedY = y;  break;
+        case 'u': x = savedX;  y = savedY;  break;
+        case 't': if (param(0, 0) == 8) { resize(param(2, cols), param(1, rows)); } break;
+        default: break;
+    }
+    wrapPending = false;
+}
+
+void TermPlayer::Terminal::sgr() {
+    if (!numParams) { attr = Attr(); return; }
+    for (int i = 0;  i < numParams;  ++i) {
+        int p = params[i];
+        if ((p == 38) || (p == 48)) {
+            // extended colors: 5;index or 2;r;g;b
+            uint8_t color = 7;
+            if (((i + 2) < numParams) && (params[i + 1] == 5)) {
+                color = xtermToPC(params[i + 2]);
+                i += 2;
+            } else if (((i + 4) < numParams) && (params[i + 1] == 2)) {
+                color = nearestPCColor(params[i + 2], params[i + 3], params[i + 4]);
+                i += 4;
+            } else {
+                break;
+            }
+            if (p == 38) { attr.fg = color; } else { attr.bg = color; }
+            continue;
+        }
+        switch (p) {
+            case 0:  attr = Attr();  break;
+            case 1:  attr.bold    = true;   break;
+            case 22: attr.bold    = false;  break;
+            case 5:  case 6: attr.blink = true;  break;
+            case 25: attr.blink   = false;  break;
+            case 7:  attr.reverse = true;   break;
+            case 27: attr.reverse = false;  break;
+            case 39: attr.fg = 7;  break;
+            case 49: attr.bg = 0;  break;
+            default:
+                if      ((p >=  30) && (p <=  37)) { attr.fg = ansiToPC[p -  30]; }
+                else if ((p >=  40) && (p <=  47)) { attr.bg = ansiToPC[p -  40]; }
+                else if ((p >=  90) && (p <=  97)) { attr.fg = ansiToPC[p -  90] | 8; }
+                else if ((p >= 100) && (p <= 107)) { attr.bg = ansiToPC[p - 100] | 8; }
+                break;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: file parsers
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+//! minimal JSON reader, just enough for asciicast files
+class JSONReader {
+public:
+    inline JSONReader(const char* p, const char* end) : m_p(p), m_end(end) {}
+    inline bool atEnd() { skipWS(); return m_p >= m_end; }
+    inline bool peek(char c) { skipWS(); return (m_p < m_end) && (*m_p == c); }
+    inline bool expect(char c) { if (!peek(c)) { return false; } ++m_p; return true; }
+
+    bool number(double& value) {
+        skipWS();
+        char* end = nullptr;
+        value = strtod(m_p, &end);
+        if (!end || (end == m_p) || (end > m_end)) { return false; }
+        m_p = end;
+        return true;
+    }
+
+    //! read a string, decoding escape sequences into UTF-8
+    bool string(std::string* out) {
+        if (!expect('"')) { return false; }
+        while (m_p < m_end) {
+            char c = *m_p++;
+            if (c == '"') { return true; }
+            if (c != '\\') { if (out) { out->push_back(c); } continue; }
+            if (m_p >= m_end) { return false; }
+            c = *m_p++;
+            uint32_t cp;
+            switch (c) {
+                case 'b': cp = 0x08; break;
+                case 'f': cp = 0x0C; break;
+                case 'n': cp = 0x0A; break;
+                case 'r': cp = 0x0D; break;
+                case 't': cp = 0x09; break;
+                case 'u':
+                    if (!hex4(cp)) { return false; }
+                    if ((cp >= 0xD800) && (cp < 0xDC00) && ((m_end - m_p) >= 6) && (m_p[0] == '\\') && (m_p[1] == 'u')) {
+                        m_p += 2;
+                        uint32_t low;
+                        if (!hex4(low)) { return false; }
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low & 0x3FF);
+                    }
+                    break;
+                default: cp = uint32_t(uint8_t(c)); break;
+            }
+            if (out) { appendUTF8(*out, cp); }
+        }
+        return false;
+    }
+
+    //! skip any value
+    bool skipValue() {
+        skipWS();
+        if (m_p >= m_end) { return false; }
+        char c = *m_p;
+        if (c == '"') { return string(nullptr); }
+        if ((c == '{') || (c == '[')) {
+            char close = (c == '{') ? '}' : ']';
+            ++m_p;
+            if (expect(close)) { return true; }
+            do {
+                if ((c == '{') && (!string(nullptr) || !expect(':'))) { return false; }
+                if (!skipValue()) { return false; }
+            } while (expect(','));
+            return expect(close);
+        }
+        // number, true, false, null
+        const char* start = m_p;
+        while ((m_p < m_end) && !strchr(",]} \t\r\n", *m_p)) { ++m_p; }
+        return (m_p > start);
+    }
+
+    //! iterate over the members of an object; the handler is called with
+    //! each key and must consume the value
+    bool object(const std::function<bool(const std::string&)>& handler) {
+        if (!expect('{')) { return false; }
+        if (expect('}')) { return true; }
+        std::string key;
+        do {
+            key.clear();
+            if (!string(&key) || !expect(':') || !handler(key)) { return false; }
+        } while (expect(','));
+        return expect('}');
+    }
+
+    //! iterate over the elements of an array; the handler must consume each element
+    bool array(const std::function<bool()>& handler) {
+        if (!expect('[')) { return false; }
+        if (expect(']')) { return true; }
+        do {
+            if (!handler()) { return false; }
+        } while (expect(','));
+        return expect(']');
+    }
+
+private:
+    const char* m_p;
+    const char* m_end;
+
+    inline void skipWS() {
+        while ((m_p < m_end) && ((*m_p == ' ') || (*m_p == '\t') || (*m_p == '\r') || (*m_p == '\n'))) { ++m_p; }
+    }
+
+    bool hex4(uint32_t& value) {
+        if ((m_end - m_p) < 4) { return false; }
+        value = 0;
+        for (int i = 0;  i < 4;  ++i) {
+            char c = StringUtil::ce_tolower(*m_p++);
+            if      ((c >= '0') && (c <= '9')) { value = (value << 4) | uint32_t(c - '0'); }
+            else if ((c >= 'a') && (c <= 'f')) { value = (value << 4) | uint32_t(c - 'a' + 10); }
+            else { return false; }
+        }
+        return true;
+    }
+
+    static void appendUTF8(std::string& s, uint32_t cp) {
+        if (cp < 0x80) {
+            s.push_back(char(cp));
+        } else if (cp < 0x800) {
+            s.push_back(char(0xC0 | (cp >> 6)));
+            s.push_back(char(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            s.push_back(char(0xE0 | (cp >> 12)));
+            s.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(char(0x80 | (cp & 0x3F)));
+        } else {
+            s.push_back(char(0xF0 | (cp >> 18)));
+            s.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+            s.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(char(0x80 | (cp & 0x3F)));
+        }
+    }
+};
+
+}  // anonymous namespace
+
+void TermPlayer::addOutput(double time, const char* data, size_t size) {
+    if (!data || !size) { return; }
+    Event e;
+    e.time   = m_events.empty() ? std::max(time, 0.0) : std::max(time, m_events.back().time);
+    e.offset = m_data.size();
+    e.size   = size;
+    m_data.insert(m_data.end(), data, data + size);
+    m_events.push_back(e);
+}
+
+bool TermPlayer::parseTtyrec(const char* data, size_t size) {
+    // ttyrec: sequence of frames, each with a 12-byte header
+    // (seconds, microseconds, data length; all little-endian 32-bit)
+    auto le32 = [] (const char* p) -> uint32_t {
+        const uint8_t* u = reinterpret_cast<const uint8_t*>(p);
+        return uint32_t(u[0]) | (uint32_t(u[1]) << 8) | (uint32_t(u[2]) << 16) | (uint32_t(u[3]) << 24);
+    };
+    size_t pos = 0;
+    double t0 = -1.0;
+    while ((pos + 12u) <= size) {
+        double t = double(le32(&data[pos])) + 1E-6 * double(le32(&data[pos + 4u]));
+        size_t len = le32(&data[pos + 8u]);
+        pos += 12u;
+        if (len > (size - pos)) {
+            if (m_events.empty()) { return false; }  // probably not a ttyrec file at all
+            len = size - pos;  // truncated recording
+        }
+        if (t0 < 0.0) { t0 = t; }
+        addOutput(t - t0, &data[pos], len);
+        pos += len;
+    }
+    return !m_events.empty();
+}
+
+bool TermPlayer::parseAsciicast(const char* data, size_t size) {
+    // asciicast v1: a single JSON object with a "stdout" list of [delay, data] pairs;
+    // v2 and v3: a JSON header line, followed by one [time, type, data] event per line
+    // (v2 uses absolute times, v3 uses intervals)
+    const char* end = &data[size];
+    const char* lineEnd = static_cast<const char*>(memchr(data, '\n', size));
+    if (!lineEnd) { lineEnd = end; }
+    int version = 0;
+    double time = 0.0;
+    std::vector<std::pair<double, std::string>> v1events;
+    JSONReader header(data, end);
+    auto handler = [&] (const std::string& key) -> bool {
+        double value = 0.0;
+        if (key == "version") { if (!header.number(value)) { return false; }  version = int(value); }
+        else if ((key == "width") || (key == "cols")) { if (!header.number(value)) { return false; }  m_term.cols = int(value); }
+        else if ((key == "height") || (key == "rows")) { if (!header.number(value)) { return false; }  m_term.rows = int(value); }
+        else if (key == "stdout") {
+            return header.array([&] () -> bool {
+                double delay = 0.0;
+                std::string text;
+                if (!header.expect('[') || !header.number(delay) || !header.expect(',') || !header.string(&text)) { return false; }
+                while (header.expect(',')) { header.skipValue(); }
+                time += delay;
+                v1events.emplace_back(time, std::move(text));
+                return header.expect(']');
+            });
+        }
+        else { return header.skipValue(); }
+        return true;
+    };
+    std::function<bool(const std::string&)> termHandler;
+    termHandler = [&] (const std::string& key) -> bool {
+        return (key == "term") ? header.object(handler) : handler(key);
+    };
+    if (!header.object(termHandler)) { return false; }
+    for (const auto& e : v1events) {
+        addOutput(e.first, e.second.data(), e.second.size());
+    }
+    if (version < 2) { return !m_events.empty(); }
+
+    // parse the event lines
+    std::string type, text;
+    time = 0.0;
+    for (const char* line = lineEnd;  line < end;  line = lineEnd) {
+        ++line;
+        lineEnd = static_cast<const char*>(memchr(line, '\n', size_t(end - line)));
+        if (!lineEnd) { lineEnd = end; }
+        JSONReader ev(line, lineEnd);
+        if (ev.atEnd()) { continue; }
+        double t = 0.0;
+        type.clear();
+        text.clear();
+        if (!ev.expect('[') || !ev.number(t) || !ev.expect(',') || !ev.string(&type) || !ev.expect(',') || !ev.string(&text)) {
+            #ifndef NDEBUG
+                printf("asciicast: invalid event line\n");
+            #endif
+            continue;
+        }
+        time = (version >= 3) ? (time + t) : t;
+        if (type == "o") {
+            addOutput(time, text.data(), text.size());
+        } else if (type == "r") {
+            // resize event, "COLSxROWS" -> convert into an escape sequence
+            int cols = 0, rows = 0;
+            if (sscanf(text.c_str(), "%dx%d", &cols, &rows) == 2) {
+                char seq[32];
+                int len = snprintf(seq, sizeof(seq), "\x1b[8;%d;%dt", rows, cols);
+                addOutput(time, seq, size_t(len));
+            }
+        }
+    }
+    return !m_events.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: playback
+///////////////////////////////////////////////////////////////////////////////
+
+bool TermPlayer::load(const char* filename) {
+    unload();
+    int size = 0;
+    char* data = StringUtil::loadTextFile(filename, size);
+    if (!data) { return false; }
+    #ifndef NDEBUG
+        auto t0 = std::chrono::steady_clock::now();
+    #endif
+    const char* p = data;
+    while ((p < &data[size]) && ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n'))) { ++p; }
+    m_term = Terminal();
+    m_term.cols = defaultCols;
+    m_term.rows = defaultRows;
+    bool ok = (*p == '{') ? parseAsciicast(data, size_t(size)) : parseTtyrec(data, size_t(size));
+    ::free(static_cast<void*>(data));
+    if (!ok) {
+        #ifndef NDEBUG
+            printf("terminal recording: failed to parse '%s'\n", filename);
+        #endif
+        unload();
+        return false;
+    }
+    m_duration = m_events.back().time;
+    buildKeyframes();
+    #ifndef NDEBUG
+        printf("terminal recording: %dx%d, %d events, %d bytes, %.1f seconds, %d keyframes, indexed in %.1f ms\n",
+               m_term.cols, m_term.rows, int(m_events.size()), int(m_data.size()), m_duration, int(m_keyframes.size()),
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    #endif
+    seek(0.0);
+    paused = false;
+    return true;
+}
+
+void TermPlayer::unload() {
+    m_data.clear();
+    m_events.clear();
+    m_keyframes.clear();
+    m_frame.clear();
+    m_frameValid = false;
+    m_next = 0;
+    m_pos = m_duration = 0.0;
+    m_lastTime = -1.0;
+}
+
+void TermPlayer::buildKeyframes() {
+    // run the whole recording through the emulator once, taking snapshots
+    // along the way; the first keyframe is the initial state
+    m_term.reset();
+    m_keyframes.clear();
+    m_keyframes.push_back(Keyframe { 0, m_term });
+    double lastTime = 0.0;
+    size_t bytes = 0;
+    for (size_t i = 0;  i < m_events.size();  ++i) {
+        const Event& e = m_events[i];
+        if (i && (((e.time - lastTime) >= keyframeInterval) || (bytes >= keyframeBytes))) {
+            m_keyframes.push_back(Keyframe { i, m_term });
+            lastTime = e.time;
+            bytes = 0;
+        }
+        m_term.feed(reinterpret_cast<const uint8_t*>(&m_data[e.offset]), e.size);
+        bytes += e.size;
+    }
+    m_next = m_events.size();
+}
+
+void TermPlayer::play(size_t endEvent) {
+    endEvent = std::min(endEvent, m_events.size());
+    for (;  m_next < endEvent;  ++m_next) {
+        const Event& e = m_events[m_next];
+        m_term.feed(reinterpret_cast<const uint8_t*>(&m_data[e.offset]), e.size);
+    }
+}
+
+void TermPlayer::seek(double time) {
+    if (!loaded()) { return; }
+    m_pos = std::max(0.0, std::min(time, m_duration));
+    size_t target = size_t(std::upper_bound(m_events.begin(), m_events.end(), m_pos,
+                           [] (double t, const Event& e) { return t < e.time; }) - m_events.begin());
+
+    // restore the closest keyframe, unless the current state is closer
+    auto kf = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), target,
+                               [] (size_t ev, const Keyframe& k) { return ev < k.event; }) - 1;
+    if ((m_next > target) || (kf->event > m_next)) {
+        m_term = kf->term;
+        m_term.markDirty(0, m_term.rows);
+        m_next = kf->event;
+    }
+    play(target);
+}
+
+void TermPlayer::advance(double now) {
+    double dt = (m_lastTime >= 0.0) ? std::max(0.0, std::min(now - m_lastTime, maxTimeStep)) : 0.0;
+    m_lastTime = now;
+    if (paused || !loaded()) { return; }
+    m_pos = std::min(m_pos + dt * speed, m_duration);
+    size_t end = m_next;
+    while ((end < m_events.size()) && (m_events[end].time <= m_pos)) { ++end; }
+    play(end);
+    if (m_pos >= m_duration) { paused = true; }
+}
+
+const void* TermPlayer::render(const ANSILoader::RenderOptions& options, int &width, int &height, int &firstRow, int &endRow) {
+    if (!loaded()) { return nullptr; }
+    Terminal& t = m_term;
+    bool full = !m_frameValid || (t.cols != m_frameCols) || (t.rows != m_frameRows);
+    int r0 = full ? 0 : t.dirtyBegin;
+    int r1 = full ? t.rows : t.dirtyEnd;
+    if (r0 >= r1) { return nullptr; }
+
+    // render the changed rows of the cell grid as a binary text file
+    size_t size = size_t(r1 - r0) * size_t(t.cols) * 2u;
+    char* data = static_cast<char*>(::malloc(size + 1u));
+    if (!data) { return nullptr; }
+    ::memcpy(static_cast<void*>(data), static_cast<const void*>(&t.cells[size_t(r0) * size_t(t.cols) * 2u]), size);
+    data[size] = '\0';
+    ANSILoader loader;
+    loader.options = options;
+    loader.options.useSAUCE    = false;
+    loader.options.autoColumns = false;
+    loader.options.columns     = t.cols;
+    int w = 0, h = 0;
+    uint8_t* img = static_cast<uint8_t*>(loader.renderData(data, int(size), StringUtil::makeExtCode("bin"), w, h));
+    if (!img) { return nullptr; }
+    int rowHeight = h / (r1 - r0);
+    size_t pitch = size_t(w) * 4u;
+
+    // put them into the frame buffer
+    if (full) {
+        m_frame.assign(img, &img[pitch * size_t(h)]);
+        m_frameWidth  = w;
+        m_frameHeight = h;
+        m_frameCols = t.cols;
+        m_frameRows = t.rows;
+        m_frameValid = true;
+    } else if ((w != m_frameWidth) || ((rowHeight * t.rows) != m_frameHeight)) {
+        // geometry changed unexpectedly (font change?) -> render everything
+        ::free(static_cast<void*>(img));
+        m_frameValid = false;
+        return render(options, width, height, firstRow, endRow);
+    } else {
+        ::memcpy(&m_frame[pitch * size_t(r0 * rowHeight)], img, pitch * size_t(h));
+    }
+    ::free(static_cast<void*>(img));
+    aspect = loader.aspect;
+    t.dirtyBegin = t.dirtyEnd = 0;
+    width    = m_frameWidth;
+    height   = m_frameHeight;
+    firstRow = r0 * rowHeight;
+    endRow   = r1 * rowHeight;
+    return static_cast<const void*>(m_frame.data());
+}
@@ -0,0 +1,133 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include "ansi_loader.h"
+
+//! player for terminal session recordings (ttyrec and asciicast)
+//!
+//! The recorded output is fed into a small VT100-style terminal emulator
+//! that maintains a grid of character cells in the same layout as .bin files
+//! (a CP437 character and a PC attribute byte per cell), so the ANSI loader's
+//! binary text renderer can turn it into pixels. Only rows that changed are
+//! rendered and uploaded again. For seeking, snapshots of the complete
+//! emulator state are taken at regular intervals while loading.
+class TermPlayer {
+public:
+    //! list of extension codes (as used in string_util.h) for all recognized file types
+    static const uint32_t fileExts[];
+
+    double speed  = 1.0;    //!< playback speed factor
+    bool   paused = false;  //!< playback is paused
+    double aspect = 1.0;    //!< expected aspect ratio of the last rendered frame
+
+    inline TermPlayer() {}
+
+    //! load a recording and rewind to the beginning
+    bool load(const char* filename);
+
+    //! free all data
+    void unload();
+
+    inline bool   loaded()   const { return !m_events.empty(); }
+    inline double duration() const { return m_duration; }
+    inline double position() const { return m_pos; }
+
+    //! jump to a specific time in the recording
+    void seek(double time);
+
+    //! advance the playback position according to the wall-clock time `now`
+    //! (in seconds) and process all events up to there
+    void advance(double now);
+
+    //! force the next render() to draw the whole screen (e.g. after options changed)
+    inline void invalidate() { m_frameValid = false; }
+
+    //! render the rows that changed since the last call into the frame buffer
+    //! \returns the complete frame (BGRA, width x height pixels), or nullptr
+    //!          if nothing changed; the changed pixel rows are
+    //!          [firstRow, endRow)
+    const void* render(const ANSILoader::RenderOptions& options, int &width, int &height, int &firstRow, int &endRow);
+
+private:
+    //! terminal emulator state
+    struct Terminal {
+        struct Attr {
+            uint8_t fg = 7, bg = 0;
+            bool bold = false, blink = false, reverse = false;
+        };
+        int cols = 80, rows = 24;
+        std::vector<uint8_t> cells;     //!< 2 bytes per cell: character, attribute
+        std::vector<uint8_t> altCells;  //!< the inactive screen buffer (main or alternate)
+        int x = 0, y = 0;               //!< cursor position
+        bool wrapPending = false;       //!< cursor is behind the last column
+        int top = 0, bottom = 24;       //!< scroll region [top, bottom)
+        Attr attr, savedAttr;
+        int savedX = 0, savedY = 0;
+        bool lineDrawing = false;       //!< DEC special graphics character set is active
+        bool altScreen = false;
+        // escape sequence parser state
+        uint8_t state = 0;
+        bool privateMode = false;
+        int params[16] = {};
+        int numParams = 0;
+        uint8_t utf8[4] = {};           //!< UTF-8 sequence collected so far
+        int utf8Len = 0, utf8Need = 0;
+        // rows that changed since the last render: [dirtyBegin, dirtyEnd)
+        int dirtyBegin = 0, dirtyEnd = 0;
+
+        void resize(int newCols, int newRows);
+        void reset();
+        void feed(const uint8_t* data, size_t size);
+
+        uint8_t cellAttr() const;
+        void markDirty(int r0, int r1);
+        void put(uint8_t ch);
+        void putCodepoint(uint32_t cp);
+        void lineFeed();
+        void scroll(int r0, int r1, int n);
+        void erase(int row, int c0, int c1);
+        void eraseRows(int r0, int r1);
+        void csi(uint8_t final);
+        void sgr();
+        inline int param(int i, int def = 1) const
+            { return ((i < numParams) && (params[i] > 0)) ? params[i] : def; }
+    };
+
+    struct Event {
+        double time;    //!< time of the event in seconds since the start of the recording
+        size_t offset;  //!< offset of the output data in m_data
+        size_t size;    //!< output data size
+    };
+
+    struct Keyframe {
+        size_t   event;  //!< index of the first event that isn't contained in the snapshot
+        Terminal term;
+    };
+
+    std::vector<char> m_data;
+    std::vector<Event> m_events;
+    std::vector<Keyframe> m_keyframes;
+    Terminal m_term;
+    size_t m_next = 0;         //!< index of the next event to be processed
+    double m_pos = 0.0;        //!< current playback position
+    double m_duration = 0.0;
+    double m_lastTime = -1.0;  //!< wall-clock time of the last advance() call
+
+    std::vector<uint8_t> m_frame;
+    int  m_frameWidth = 0, m_frameHeight = 0;
+    int  m_frameCols = 0, m_frameRows = 0;
+    bool m_frameValid = false;
+
+    void addOutput(double time, const char* data, size_t size);
+    bool parseTtyrec(const char* data, size_t size);
+    bool parseAsciicast(const char* data, size_t size);
+    void buildKeyframes();
+    void play(size_t endEvent);
+};
@@ -0,0 +1,330 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define TEXCOMPRESS_SSE2
+#endif
+
+#include "string_util.h"
+#include "file_util.h"
+
+#include "tex_compress.h"
+
+namespace TexCompress {
+
+// minimum number of block rows (or pixel rows) per worker thread
+static constexpr int minRowsPerThread = 16;
+
+// disk cache file header
+static constexpr char cacheMagic[8] = { 'P', 'X', 'V', 'D', 'X', 'T', '1', '\n' };
+struct CacheHeader {
+    char     magic[8];
+    uint32_t width;
+    uint32_t height;
+    uint64_t dataSize;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: helpers
+///////////////////////////////////////////////////////////////////////////////
+
+//! run func(begin, end) for subranges of [0, count) on multiple threads
+static void parallelFor(int count, int threads, const std::function<void(int, int)>& func) {
+    threads = std::max(1, std::min(threads, count / minRowsPerThread));
+    if (threads < 2) { func(0, count); return; }
+    std::vector<std::thread> pool;
+    for (int t = 0;  t < threads;  ++t) {
+        pool.emplace_back(func, int(int64_t(count) * t / threads), int(int64_t(count) * (t + 1) / threads));
+    }
+    for (auto& th : pool) { th.join(); }
+}
+
+int numLevels(int width, int height) {
+    int levels = 1;
+    while ((width > 1) || (height > 1)) {
+        width  = std::max(width  >> 1, 1);
+        height = std::max(height >> 1, 1);
+        ++levels;
+    }
+    return levels;
+}
+
+bool isOpaque(const uint8_t* rgba, int width, int height) {
+    size_t count = size_t(width) * size_t(height);
+    for (size_t i = 0;  i < count;  ++i) {
+        if (rgba[i * 4u + 3u] != 255u) { return false; }
+    }
+    return true;
+}
+
+//! compute the next mipmap level with a 2x2 box filter; in odd-sized
+//! dimensions, the last row or column is dropped, as glGenerateMipmap() does
+static void downsample(const uint8_t* src, int sw, int sh, uint8_t* dest, int dw, int dh, int threads) {
+    parallelFor(dh, threads, [=] (int y0, int y1) {
+        for (int y = y0;  y < y1;  ++y) {
+            const uint8_t* r0 = &src[size_t(std::min(y * 2,     sh - 1)) * size_t(sw) * 4u];
+            const uint8_t* r1 = &src[size_t(std::min(y * 2 + 1, sh - 1)) * size_t(sw) * 4u];
+            uint8_t* out = &dest[size_t(y) * size_t(dw) * 4u];
+            for (int x = 0;  x < dw;  ++x) {
+                size_t p = size_t(std::min(x * 2,     sw - 1)) * 4u;
+                size_t q = size_t(std::min(x * 2 + 1, sw - 1)) * 4u;
+                for (int c = 0;  c < 4;  ++c) {
+                    *out++ = uint8_t((r0[p + c] + r0[q + c] + r1[p + c] + r1[q + c] + 2) >> 2);
+                }
+            }
+        }
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: block encoder
+///////////////////////////////////////////////////////////////////////////////
+
+static inline uint16_t to565(int r, int g, int b) {
+    return uint16_t((((r * 31 + 128) / 255) << 11) | (((g * 63 + 128) / 255) << 5) | ((b * 31 + 128) / 255));
+}
+
+static inline void from565(uint16_t c, int rgb[3]) {
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+//! encode a block of 4x4 RGBA pixels (in row-major order) into 8 bytes;
+//! the endpoints are derived from the bounding box of the block's colors
+//! (with the diagonal chosen according to the sign of the channels'
+//! covariance, and slightly inset to reduce the error in the middle),
+//! which is much faster than an exhaustive or iterative search
+static void encodeBlock(const uint32_t px[16], uint8_t* out) {
+    // bounding box
+    int lo[3], hi[3];
+    #ifdef TEXCOMPRESS_SSE2
+        const __m128i* v = reinterpret_cast<const __m128i*>(px);
+        __m128i a = _mm_loadu_si128(&v[0]), b = _mm_loadu_si128(&v[1]);
+        __m128i c = _mm_loadu_si128(&v[2]), d = _mm_loadu_si128(&v[3]);
+        __m128i mn = _mm_min_epu8(_mm_min_epu8(a, b), _mm_min_epu8(c, d));
+        __m128i mx = _mm_max_epu8(_mm_max_epu8(a, b), _mm_max_epu8(c, d));
+        mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, 0x4E));
+        mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, 0x4E));
+        mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, 0xB1));
+        mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, 0xB1));
+        uint32_t mnv = uint32_t(_mm_cvtsi128_si32(mn));
+        uint32_t mxv = uint32_t(_mm_cvtsi128_si32(mx));
+        for (int ch = 0;  ch < 3;  ++ch) {
+            lo[ch] = int((mnv >> (ch * 8)) & 0xFFu);
+            hi[ch] = int((mxv >> (ch * 8)) & 0xFFu);
+        }
+    #else
+        lo[0] = lo[1] = lo[2] = 255;
+        hi[0] = hi[1] = hi[2] = 0;
+        for (int i = 0;  i < 16;  ++i) {
+            for (int ch = 0;  ch < 3;  ++ch) {
+                int x = int((px[i] >> (ch * 8)) & 0xFFu);
+                lo[ch] = std::min(lo[ch], x);
+                hi[ch] = std::max(hi[ch], x);
+            }
+        }
+    #endif
+
+    // choose the diagonal: if red or blue are anti-correlated with green,
+    // their endpoints need to be swapped
+    int center[3];
+    for (int ch = 0;  ch < 3;  ++ch) { center[ch] = (lo[ch] + hi[ch] + 1) >> 1; }
+    int covRG = 0, covBG = 0;
+    for (int i = 0;  i < 16;  ++i) {
+        int r = int( px[i]        & 0xFFu) - center[0];
+        int g = int((px[i] >>  8) & 0xFFu) - center[1];
+        int b = int((px[i] >> 16) & 0xFFu) - center[2];
+        covRG += r * g;
+        covBG += b * g;
+    }
+    if (covRG < 0) { std::swap(lo[0], hi[0]); }
+    if (covBG < 0) { std::swap(lo[2], hi[2]); }
+
+    // inset the endpoints by 1/16 of the range
+    for (int ch = 0;  ch < 3;  ++ch) {
+        int inset = (hi[ch] - lo[ch]) / 16;
+        hi[ch] -= inset;
+        lo[ch] += inset;
+    }
+    uint16_t c0 = to565(hi[0], hi[1], hi[2]);
+    uint16_t c1 = to565(lo[0], lo[1], lo[2]);
+
+    // the order of the endpoints selects the 4-color mode (c0 > c1)
+    uint32_t indices = 0;
+    if (c0 < c1) { std::swap(c0, c1); }
+    if (c0 != c1) {
+        // project each pixel onto the line between the endpoints and pick the
+        // nearest of the four palette entries (c0, c1, 2/3 c0 + 1/3 c1, 1/3 c0 + 2/3 c1)
+        static const uint32_t remap[4] = { 1u, 3u, 2u, 0u };
+        int p0[3], p1[3], dir[3];
+        from565(c0, p0);
+        from565(c1, p1);
+        for (int ch = 0;  ch < 3;  ++ch) { dir[ch] = p0[ch] - p1[ch]; }
+        int len = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+        for (int i = 15;  i >= 0;  --i) {
+            int t = (int( px[i]        & 0xFFu) - p1[0]) * dir[0]
+                  + (int((px[i] >>  8) & 0xFFu) - p1[1]) * dir[1]
+                  + (int((px[i] >> 16) & 0xFFu) - p1[2]) * dir[2];
+            t *= 6;
+            int step = (t >= len) + (t >= 3 * len) + (t >= 5 * len);
+            indices = (indices << 2) | remap[step];
+        }
+    }   // otherwise, the block is uniform, and all indices are 0
+
+    out[0] = uint8_t(c0);  out[1] = uint8_t(c0 >> 8);
+    out[2] = uint8_t(c1);  out[3] = uint8_t(c1 >> 8);
+    for (int i = 0;  i < 4;  ++i) { out[4 + i] = uint8_t(indices >> (i * 8)); }
+}
+
+//! encode one complete level
+static void encodeLevel(const uint8_t* rgba, int width, int height, uint8_t* out, int threads) {
+    int bw = (width + 3) >> 2, bh = (height + 3) >> 2;
+    parallelFor(bh, threads, [=] (int by0, int by1) {
+        uint32_t px[16];
+        for (int by = by0;  by < by1;  ++by) {
+            uint8_t* dest = &out[size_t(by) * size_t(bw) * 8u];
+            for (int bx = 0;  bx < bw;  ++bx) {
+                // gather the block; pixels outside the image repeat the edge
+                bool inside = ((bx * 4 + 4) <= width);
+                for (int y = 0;  y < 4;  ++y) {
+                    const uint8_t* row = &rgba[size_t(std::min(by * 4 + y, height - 1)) * size_t(width) * 4u];
+                    if (inside) {
+                        ::memcpy(static_cast<void*>(&px[y * 4]), static_cast<const void*>(&row[size_t(bx) * 16u]), 16u);
+                    } else for (int x = 0;  x < 4;  ++x) {
+                        ::memcpy(static_cast<void*>(&px[y * 4 + x]), static_cast<const void*>(&row[size_t(std::min(bx * 4 + x, width - 1)) * 4u]), 4u);
+                    }
+                }
+                encodeBlock(px, dest);
+                dest += 8;
+            }
+        }
+    });
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: main API
+///////////////////////////////////////////////////////////////////////////////
+
+bool encode(const uint8_t* rgba, int width, int height, Image& img, int threads) {
+    img = Image();
+    if (!rgba || (width < 1) || (height < 1)) { return false; }
+    if (threads < 1) { threads = std::max(1, int(std::thread::hardware_concurrency())); }
+    size_t total = 0;
+    int levels = numLevels(width, height);
+    for (int level = 0;  level < levels;  ++level) {
+        total += levelBytes(std::max(width >> level, 1), std::max(height >> level, 1));
+    }
+    img.data.resize(total);
+    img.width  = width;
+    img.height = height;
+
+    // encode each level, computing the next one from it in the meantime
+    std::vector<uint8_t> cur, next;
+    const uint8_t* src = rgba;
+    size_t offset = 0;
+    int w = width, h = height;
+    for (int level = 0;  level < levels;  ++level) {
+        encodeLevel(src, w, h, &img.data[offset], threads);
+        offset += levelBytes(w, h);
+        if ((w > 1) || (h > 1)) {
+            int nw = std::max(w >> 1, 1), nh = std::max(h >> 1, 1);
+            next.resize(size_t(nw) * size_t(nh) * 4u);
+            downsample(src, w, h, next.data(), nw, nh, threads);
+            cur.swap(next);
+            src = cur.data();
+            w = nw;  h = nh;
+        }
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: disk cache
+///////////////////////////////////////////////////////////////////////////////
+
+char* cachePath(const HashUtil::Digest& hash, size_t size) {
+    char* dir = FileUtil::getCacheDirectory();
+    if (!dir) { return nullptr; }
+    char hex[33], name[64];
+    hash.toHex(hex);
+    snprintf(name, sizeof(name), "%s-%llx.dxt1", hex, static_cast<unsigned long long>(size));
+    char* path = StringUtil::pathJoin(dir, name);
+    ::free(dir);
+    return path;
+}
+
+bool loadCache(const char* path, Image& img) {
+    img = Image();
+    if (!path) { return false; }
+    FILE* f = fopen(path, "rb");
+    if (!f) { return false; }
+    CacheHeader hdr;
+    bool ok = (fread(static_cast<void*>(&hdr), sizeof(hdr), 1, f) == 1)
+           && !memcmp(hdr.magic, cacheMagic, sizeof(cacheMagic))
+           && (hdr.width > 0u) && (hdr.width < 65536u) && (hdr.height > 0u) && (hdr.height < 65536u);
+    if (ok) {
+        // the data size must match the image size exactly
+        size_t total = 0;
+        int w = int(hdr.width), h = int(hdr.height), levels = numLevels(w, h);
+        for (int level = 0;  level < levels;  ++level) {
+            total += levelBytes(std::max(w >> level, 1), std::max(h >> level, 1));
+        }
+        ok = (hdr.dataSize == uint64_t(total));
+        if (ok) {
+            img.data.resize(total);
+            ok = (fread(static_cast<void*>(img.data.data()), 1, total, f) == total);
+        }
+    }
+    fclose(f);
+    if (!ok) { img = Image(); return false; }
+    img.width  = int(hdr.width);
+    img.height = int(hdr.height);
+    FileUtil::touchFile(path);  // keep it from being evicted
+    return true;
+}
+
+bool saveCache(const char* path, const Image& img) {
+    if (!path || img.data.empty()) { return false; }
+    // write into a temporary file first, so an interrupted write can't
+    // leave a damaged cache file behind
+    char* tempPath = StringUtil::concat(path, ".tmp");
+    if (!tempPath) { return false; }
+    FILE* f = fopen(tempPath, "wb");
+    bool ok = (f != nullptr);
+    if (ok) {
+        CacheHeader hdr;
+        ::memcpy(static_cast<void*>(hdr.magic), static_cast<const void*>(cacheMagic), sizeof(cacheMagic));
+        hdr.width    = uint32_t(img.width);
+        hdr.height   = uint32_t(img.height);
+        hdr.dataSize = uint64_t(img.data.size());
+        ok = (fwrite(static_cast<const void*>(&hdr), sizeof(hdr), 1, f) == 1)
+          && (fwrite(static_cast<const void*>(img.data.data()), 1, img.data.size(), f) == img.data.size());
+        ok = !fclose(f) && ok;
+    }
+    if (ok) {
+        remove(path);  // required on Windows, where rename() doesn't overwrite
+        ok = !rename(tempPath, path);
+    }
+    if (!ok) { remove(tempPath); }
+    ::free(tempPath);
+    if (ok) { FileUtil::trimCacheDirectory(); }
+    return ok;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}  // namespace TexCompress
@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include "hash_util.h"
+
+//! encoder for the DXT1 (a.k.a. S3TC, BC1) block-compressed texture format,
+//! which needs 4 bits per pixel instead of 32 and is meant for large
+//! photographs, where the loss of quality is hardly noticeable
+namespace TexCompress {
+
+///////////////////////////////////////////////////////////////////////////////
+
+//! a DXT1-compressed image, including a complete mipmap chain
+struct Image {
+    int width  = 0;              //!< width of the first level in pixels
+    int height = 0;              //!< height of the first level in pixels
+    std::vector<uint8_t> data;   //!< all levels, back to back
+};
+
+//! number of mipmap levels (down to 1x1 pixels) for an image size
+int numLevels(int width, int height);
+
+//! number of bytes of a DXT1 image
+inline size_t levelBytes(int width, int height)
+    { return size_t((width + 3) >> 2) * size_t((height + 3) >> 2) * 8u; }
+
+//! check whether an RGBA image is fully opaque (DXT1 can't represent
+//! partial transparency, so other images shouldn't be compressed)
+bool isOpaque(const uint8_t* rgba, int width, int height);
+
+//! compress an RGBA image and all of its mipmaps
+//! \param threads  number of worker threads (0 = auto)
+bool encode(const uint8_t* rgba, int width, int height, Image& img, int threads=0);
+
+///////////////////////////////////////////////////////////////////////////////
+
+//! get the path of the disk cache file for a source file with a specific
+//! content hash and size (see TextureCache::loadFile())
+//! \returns a newly-malloc'd path (to be free()d by the caller),
+//!          or nullptr if there's no cache directory
+char* cachePath(const HashUtil::Digest& hash, size_t size);
+
+//! load a compressed image from the disk cache
+bool loadCache(const char* path, Image& img);
+
+//! store a compressed image in the disk cache; if the cache grows too
+//! large, the least recently used files are evicted
+bool saveCache(const char* path, const Image& img);
+
+///////////////////////////////////////////////////////////////////////////////
+
+}  // namespace TexCompress
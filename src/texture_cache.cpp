@@ -0,0 +1,729 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <new>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define TEXCACHE_SSE2
+#endif
+
+#include "gl_header.h"
+#include "gl_util.h"
+#include "string_util.h"
+#include "file_util.h"
+
+#include "texture_cache.h"
+
+// the S3TC extension's constants are not part of the OpenGL core profile header
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+    #define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+// size of the tiles that are compared and uploaded by reload(), in pixels
+static constexpr int reloadTileSize = 64;
+
+// maximum number of changed regions for which reload() updates the mipmaps
+// selectively; if more regions changed, the whole mipmap chain is generated
+// again, which is faster than drawing that many rectangles per level
+static constexpr size_t maxReloadRects = 256;
+
+///////////////////////////////////////////////////////////////////////////////
+
+//! check whether two blocks of memory differ
+static bool pixelsDiffer(const uint8_t* a, const uint8_t* b, size_t size) {
+    #ifdef TEXCACHE_SSE2
+        // compare 64 bytes per iteration; all differences are ORed together,
+        // so there's only one (well-predictable) branch per iteration
+        size_t i = 0;
+        for (;  (i + 64u) <= size;  i += 64u) {
+            __m128i d0 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i])),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[i])));
+            __m128i d1 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i + 16u])),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[i + 16u])));
+            __m128i d2 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i + 32u])),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[i + 32u])));
+            __m128i d3 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i + 48u])),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[i + 48u])));
+            __m128i d = _mm_or_si128(_mm_or_si128(d0, d1), _mm_or_si128(d2, d3));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(d, _mm_setzero_si128())) != 0xFFFF) { return true; }
+        }
+        return (i < size) && memcmp(&a[i], &b[i], size - i);
+    #else
+        return memcmp(a, b, size) != 0;
+    #endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TextureCache::Entry* TextureCache::find(const char* path, const FileUtil::FileFingerprint* fp) {
+    if (!path || !path[0]) { return nullptr; }
+    FileUtil::FileFingerprint current;
+    if (fp && fp->good()) { current = *fp; } else { current.update(path); }
+    for (size_t i = 0;  i < m_entries.size();  ++i) {
+        Entry* e = m_entries[i];
+        if (!e->path || strcmp(e->path, path)) { continue; }
+        if (e->fp == current) {
+            #ifndef NDEBUG
+                printf("texture cache: hit for '%s' (%dx%d)\n", path, e->width, e->height);
+            #endif
+            e->lastUse = ++m_useCounter;
+            return e;
+        }
+        // the file has been modified -> make the entry unreachable; it'll
+        // be removed as soon as nobody uses it any longer
+        ::free(static_cast<void*>(e->path));
+        e->path = nullptr;
+        if (!e->refCount) { remove(i); }
+        break;
+    }
+    for (size_t i = 0;  i < m_aliases.size();  ++i) {
+        Alias& a = m_aliases[i];
+        if (strcmp(a.path, path)) { continue; }
+        if (a.fp == current) {
+            #ifndef NDEBUG
+                printf("texture cache: hit for alias '%s' (%dx%d)\n", path, a.entry->width, a.entry->height);
+            #endif
+            a.entry->lastUse = ++m_useCounter;
+            return a.entry;
+        }
+        removeAlias(i);
+        break;
+    }
+    return nullptr;
+}
+
+// MARK: content hashing
+
+void* TextureCache::loadFile(const char* path, size_t &size, HashUtil::Digest &hash, FileUtil::FileFingerprint* fp, FileUtil::ReadStats* stats) {
+    hash = HashUtil::Digest();
+    if (fp) { fp->update(path); }
+
+    // hash the file while it's being read, one chunk at a time; the hash
+    // is the only thing that identifies the content (for deduplication and
+    // the disk caches), so it must be a cryptographic one
+    HashUtil::Hasher hasher;
+    size_t hashPos = 0;
+    void* data = FileUtil::readFile(path, size, 0, [&] (const uint8_t* d, size_t available, size_t) {
+        hasher.update(static_cast<const void*>(&d[hashPos]), available - hashPos);
+        hashPos = available;
+    }, stats);
+    if (data) { hash = hasher.finish(); }
+    return data;
+}
+
+TextureCache::Entry* TextureCache::findContent(const char* path, const HashUtil::Digest& hash, size_t size, const FileUtil::FileFingerprint* fp) {
+    if (!size) { return nullptr; }
+    for (Entry* e : m_entries) {
+        if ((e->hash != hash) || (e->fileSize != size)) { continue; }
+        #ifndef NDEBUG
+            printf("texture cache: '%s' has the same content as '%s'\n", path ? path : "(anonymous)", e->path ? e->path : "(anonymous)");
+        #endif
+        m_dedupHits++;
+        e->lastUse = ++m_useCounter;
+        if (path) {
+            Alias a;
+            a.path = StringUtil::copy(path);
+            if (fp) { a.fp = *fp; } else { a.fp.update(path); }
+            a.entry = e;
+            if (a.path) { m_aliases.push_back(a); }
+        }
+        return e;
+    }
+    return nullptr;
+}
+
+TextureCache::Entry* TextureCache::add(const char* path, const void* data, int width, int height, bool bgra) {
+    if (!data || (width < 1) || (height < 1)) { return nullptr; }
+    Entry* e = new(std::nothrow) Entry;
+    if (!e) { return nullptr; }
+    e->width  = width;
+    e->height = height;
+    evict(e->bytes());
+
+    glGenTextures(1, &e->tex);
+    glBindTexture(GL_TEXTURE_2D, e->tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLutil::checkError("before uploading image texture");
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, bgra ? GL_BGRA : GL_RGBA, GL_UNSIGNED_BYTE, data);
+    glFlush();
+    glFinish();
+    if (GLutil::checkError("after uploading image texture")) {
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDeleteTextures(1, &e->tex);
+        delete e;
+        return nullptr;
+    }
+    glGenerateMipmap(GL_TEXTURE_2D);
+    GLutil::checkError("mipmap generation");
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (path) {
+        e->path = StringUtil::copy(path);
+        e->fp.update(path);
+    }
+    e->serial  = ++m_serialCounter;
+    e->lastUse = ++m_useCounter;
+    m_entries.push_back(e);
+    #ifndef NDEBUG
+        printf("texture cache: added %dx%d texture, %d entries, %.1f MiB\n", width, height, count(), double(totalBytes()) / 1048576.0);
+    #endif
+    return e;
+}
+
+TextureCache::Entry* TextureCache::addIndexed(const char* path, const uint8_t* data, int width, int height, const uint32_t* palette, int paletteSize) {
+    if (!data || !palette || (width < 1) || (height < 1) || (paletteSize < 1) || (paletteSize > 256)) { return nullptr; }
+    Entry* e = new(std::nothrow) Entry;
+    if (!e) { return nullptr; }
+    e->width  = width;
+    e->height = height;
+    e->indexTex = 1;  // make bytes() account for the index texture
+    evict(e->bytes());
+    e->indexTex = 0;
+
+    // upload the indices and the palette; there's no displayable RGBA
+    // texture of its own, texture() creates one when it's needed
+    GLuint tex[2];
+    glGenTextures(2, tex);
+    e->indexTex = tex[0];  e->paletteTex = tex[1];
+    GLutil::checkError("before uploading indexed image texture");
+    glBindTexture(GL_TEXTURE_2D, e->indexTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data);
+    uint32_t fullPalette[256];
+    ::memset(static_cast<void*>(fullPalette), 0, sizeof(fullPalette));
+    ::memcpy(static_cast<void*>(fullPalette), static_cast<const void*>(palette), size_t(paletteSize) * sizeof(uint32_t));
+    glBindTexture(GL_TEXTURE_2D, e->paletteTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 0, GL_BGRA, GL_UNSIGNED_BYTE, fullPalette);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (GLutil::checkError("after uploading indexed image texture")) {
+        glDeleteTextures(2, tex);
+        delete e;
+        return nullptr;
+    }
+
+    if (path) {
+        e->path = StringUtil::copy(path);
+        e->fp.update(path);
+    }
+    e->serial  = ++m_serialCounter;
+    e->lastUse = ++m_useCounter;
+    m_entries.push_back(e);
+    #ifndef NDEBUG
+        printf("texture cache: added %dx%d indexed texture (%d colors), %d entries, %.1f MiB\n", width, height, paletteSize, count(), double(totalBytes()) / 1048576.0);
+    #endif
+    return e;
+}
+
+bool TextureCache::canCompress() {
+    if (m_canCompress < 0) {
+        m_canCompress = 0;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0;  i < count;  ++i) {
+            const char* ext = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, GLuint(i)));
+            if (ext && (!strcmp(ext, "GL_EXT_texture_compression_s3tc") || !strcmp(ext, "GL_EXT_texture_compression_dxt1"))) {
+                m_canCompress = 1;
+                break;
+            }
+        }
+        #ifndef NDEBUG
+            printf("texture cache: DXT1 compression is %savailable\n", m_canCompress ? "" : "not ");
+        #endif
+    }
+    return (m_canCompress > 0);
+}
+
+TextureCache::Entry* TextureCache::addCompressed(const char* path, const TexCompress::Image& img) {
+    if (img.data.empty() || (img.width < 1) || (img.height < 1) || !canCompress()) { return nullptr; }
+    Entry* e = new(std::nothrow) Entry;
+    if (!e) { return nullptr; }
+    e->width  = img.width;
+    e->height = img.height;
+    e->compressedBytes = img.data.size();
+    evict(e->bytes());
+
+    // compressed textures can't be rendered into, so glGenerateMipmap()
+    // doesn't work for them; all levels are part of the image instead
+    glGenTextures(1, &e->tex);
+    glBindTexture(GL_TEXTURE_2D, e->tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    GLutil::checkError("before uploading compressed texture");
+    int levels = TexCompress::numLevels(img.width, img.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    size_t offset = 0;
+    for (int level = 0;  level < levels;  ++level) {
+        int w = std::max(img.width >> level, 1), h = std::max(img.height >> level, 1);
+        size_t size = TexCompress::levelBytes(w, h);
+        glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, w, h, 0, GLsizei(size), static_cast<const void*>(&img.data[offset]));
+        offset += size;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glFlush();
+    glFinish();
+    if (GLutil::checkError("after uploading compressed texture")) {
+        glDeleteTextures(1, &e->tex);
+        delete e;
+        return nullptr;
+    }
+
+    if (path) {
+        e->path = StringUtil::copy(path);
+        e->fp.update(path);
+    }
+    e->serial  = ++m_serialCounter;
+    e->lastUse = ++m_useCounter;
+    m_entries.push_back(e);
+    #ifndef NDEBUG
+        printf("texture cache: added %dx%d compressed texture (%.1f MiB instead of %.1f MiB), %d entries, %.1f MiB\n",
+               e->width, e->height, double(e->bytes()) / 1048576.0, double(e->uncompressedBytes()) / 1048576.0, count(), double(totalBytes()) / 1048576.0);
+    #endif
+    return e;
+}
+
+bool TextureCache::setPalette(Entry* e, const uint32_t* palette, int paletteSize) {
+    if (!e || !e->indexTex || (e->refCount > 1) || !palette || (paletteSize < 1) || (paletteSize > 256)) { return false; }
+    glBindTexture(GL_TEXTURE_2D, e->paletteTex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, paletteSize, 1, GL_BGRA, GL_UNSIGNED_BYTE, palette);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (GLutil::checkError("palette update")) { return false; }
+    e->serial = ++m_serialCounter;
+    return true;
+}
+
+GLuint TextureCache::texture(const Entry* e) {
+    if (!e) { return 0; }
+    if (!e->indexTex) { return e->tex; }
+
+    // already resolved? otherwise, use the texture that this entry had
+    // before (e.g. with an older palette) or the least recently used one
+    Scratch* s = nullptr;
+    for (Scratch& sc : m_scratch) {
+        if (sc.owner != e) { continue; }
+        s = &sc;
+        if (sc.serial == e->serial) {
+            sc.lastUse = ++m_useCounter;
+            return sc.tex;
+        }
+    }
+    if (!s) {
+        s = &m_scratch[0];
+        for (Scratch& sc : m_scratch) {
+            if (sc.lastUse < s->lastUse) { s = &sc; }
+        }
+    }
+
+    // (re-)allocate the texture if the size doesn't match
+    s->owner = nullptr;
+    if (!s->tex || (s->width != e->width) || (s->height != e->height)) {
+        if (!s->tex) { glGenTextures(1, &s->tex); }
+        glBindTexture(GL_TEXTURE_2D, s->tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, e->width, e->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        s->width  = e->width;
+        s->height = e->height;
+        if (GLutil::checkError("indexed image texture allocation")) {
+            s->width = s->height = 0;
+            return 0;
+        }
+    }
+    if (!resolve(e, s->tex)) { return 0; }
+    s->owner   = e;
+    s->serial  = e->serial;
+    s->lastUse = ++m_useCounter;
+    #ifndef NDEBUG
+        printf("texture cache: resolved %dx%d indexed texture\n", e->width, e->height);
+    #endif
+    return s->tex;
+}
+
+bool TextureCache::update(Entry* e, const void* data, int width, int height, int firstRow, int endRow, bool bgra) {
+    if (!e || !data || e->path || e->indexTex || e->compressedBytes || (e->refCount != 1) || (width != e->width) || (height < e->height)) { return false; }
+    firstRow = std::max(0, std::min(firstRow, height));
+    endRow = std::max(firstRow, std::min(endRow, height));
+    if (height > e->height) {
+        endRow = height;  // new rows always need to be uploaded
+    }
+    GLutil::clearError();
+    if (height > e->height) {
+        // the image grew: create a larger texture and copy the unchanged
+        // rows over on the GPU, so only the new rows need to be uploaded
+        Entry grown;
+        grown.width  = width;
+        grown.height = height;
+        evict(grown.bytes() - e->bytes());  // can't remove e, as it's in use
+        GLuint tex = 0;
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        int keep = std::min(firstRow, e->height);
+        if ((keep > 0) && m_resolveFBO.init() && m_resolveFBO.begin(e->tex)) {
+            glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, keep);
+        } else {
+            keep = 0;
+        }
+        m_resolveFBO.end();
+        if (GLutil::checkError("texture resize")) {
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glDeleteTextures(1, &tex);
+            return false;
+        }
+        glDeleteTextures(1, &e->tex);
+        e->tex = tex;
+        e->height = height;
+        firstRow = keep;
+    } else {
+        glBindTexture(GL_TEXTURE_2D, e->tex);
+    }
+    if (firstRow < endRow) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, width, endRow - firstRow, bgra ? GL_BGRA : GL_RGBA, GL_UNSIGNED_BYTE,
+                        static_cast<const void*>(&static_cast<const uint8_t*>(data)[size_t(firstRow) * size_t(width) * 4u]));
+    }
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    e->serial  = ++m_serialCounter;
+    e->lastUse = ++m_useCounter;
+    #ifndef NDEBUG
+        printf("texture cache: updated rows %d-%d of %dx%d texture\n", firstRow, endRow - 1, width, height);
+    #endif
+    return !GLutil::checkError("texture update");
+}
+
+void TextureCache::retain(Entry* e, void* pixels) {
+    for (Entry* other : m_entries) {
+        if ((other != e) && other->pixels) {
+            ::free(other->pixels);
+            other->pixels = nullptr;
+        }
+    }
+    if (!e || e->indexTex || e->compressedBytes) { ::free(pixels); return; }
+    if (e->pixels != pixels) { ::free(e->pixels); }
+    e->pixels = pixels;
+}
+
+bool TextureCache::reload(Entry* e, const char* path, const void* data, int width, int height) {
+    if (!e || !e->pixels || !path || !data || e->indexTex || e->compressedBytes || (e->refCount > 1) || (width != e->width) || (height != e->height)) { return false; }
+    const uint8_t* newData = static_cast<const uint8_t*>(data);
+    const uint8_t* oldData = static_cast<const uint8_t*>(e->pixels);
+    size_t pitch = size_t(width) * 4u;
+
+    // find the changed tiles, one band of tiles at a time; rows that didn't
+    // change at all are skipped quickly, and horizontally adjacent changed
+    // tiles are merged into a single rectangle
+    std::vector<Rect> rects;
+    size_t changedPixels = 0;
+    int tilesX = (width + reloadTileSize - 1) / reloadTileSize;
+    std::vector<bool> dirty;
+    for (int y0 = 0;  y0 < height;  y0 += reloadTileSize) {
+        int y1 = std::min(y0 + reloadTileSize, height);
+        dirty.assign(size_t(tilesX), false);
+        for (int y = y0;  y < y1;  ++y) {
+            size_t row = size_t(y) * pitch;
+            if (!pixelsDiffer(&newData[row], &oldData[row], pitch)) { continue; }
+            for (int tx = 0;  tx < tilesX;  ++tx) {
+                if (dirty[size_t(tx)]) { continue; }
+                int x0 = tx * reloadTileSize;
+                size_t offset = row + size_t(x0) * 4u;
+                dirty[size_t(tx)] = pixelsDiffer(&newData[offset], &oldData[offset], size_t(std::min(reloadTileSize, width - x0)) * 4u);
+            }
+        }
+        for (int tx = 0;  tx < tilesX;) {
+            if (!dirty[size_t(tx)]) { ++tx; continue; }
+            int end = tx + 1;
+            while ((end < tilesX) && dirty[size_t(end)]) { ++end; }
+            Rect r = { tx * reloadTileSize, y0, std::min(end * reloadTileSize, width), y1 };
+            changedPixels += size_t(r.x1 - r.x0) * size_t(r.y1 - r.y0);
+            rects.push_back(r);
+            tx = end;
+        }
+    }
+
+    // upload the changed parts
+    GLutil::clearError();
+    bool ok = true;
+    if (!rects.empty()) {
+        glBindTexture(GL_TEXTURE_2D, e->tex);
+        if ((rects.size() > maxReloadRects) || ((changedPixels * 2u) > (size_t(width) * size_t(height)))) {
+            // most of the image changed -> upload everything
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, 0);
+        } else {
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+            for (const Rect& r : rects) {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0, GL_RGBA, GL_UNSIGNED_BYTE,
+                                static_cast<const void*>(&newData[size_t(r.y0) * pitch + size_t(r.x0) * 4u]));
+            }
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            if (!updateMipmaps(e, rects)) {
+                glBindTexture(GL_TEXTURE_2D, e->tex);
+                glGenerateMipmap(GL_TEXTURE_2D);
+                glBindTexture(GL_TEXTURE_2D, 0);
+            }
+        }
+        ok = !GLutil::checkError("texture reload");
+        e->serial = ++m_serialCounter;
+
+        // other files with the old content can't share the texture anymore
+        for (size_t i = m_aliases.size();  i > 0;  --i) {
+            if (m_aliases[i - 1u].entry == e) { removeAlias(i - 1u); }
+        }
+    }
+    #ifndef NDEBUG
+        printf("texture cache: reloaded %dx%d texture, %d changed region(s) with %.2f%% of the pixels\n",
+               width, height, int(rects.size()), 100.0 * double(changedPixels) / (double(width) * double(height)));
+    #endif
+    if (!ok) { return false; }
+
+    // make the entry reachable again
+    ::free(static_cast<void*>(e->path));
+    e->path = StringUtil::copy(path);
+    e->fp.update(path);
+    e->lastUse = ++m_useCounter;
+    return true;
+}
+
+void TextureCache::release(Entry* e) {
+    if (!e) { return; }
+    if (e->refCount > 0) { e->refCount--; }
+    if (!e->refCount && !e->path) {
+        // nobody will ever be able to use this entry again
+        for (size_t i = 0;  i < m_entries.size();  ++i) {
+            if (m_entries[i] == e) { remove(i); break; }
+        }
+    }
+}
+
+void TextureCache::clear() {
+    while (!m_entries.empty()) {
+        remove(m_entries.size() - 1u);
+    }
+    for (Scratch& s : m_scratch) {
+        if (s.tex && GLutil::initialized) { glDeleteTextures(1, &s.tex); }
+        s = Scratch();
+    }
+    m_resolveFBO.free();
+    m_resolveProg.free();
+    m_mipmapProg.free();
+}
+
+size_t TextureCache::totalBytes() const {
+    size_t total = 0;
+    for (const Entry* e : m_entries) { total += e->bytes(); }
+    for (const Scratch& s : m_scratch) { total += size_t(s.width) * size_t(s.height) * 16u / 3u; }
+    return total;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TextureCache::remove(size_t index) {
+    Entry* e = m_entries[index];
+    for (size_t i = m_aliases.size();  i > 0;  --i) {
+        if (m_aliases[i - 1u].entry == e) { removeAlias(i - 1u); }
+    }
+    for (Scratch& s : m_scratch) {
+        if (s.owner == e) { s.owner = nullptr; }
+    }
+    if (GLutil::initialized) {
+        if (e->tex)        { glDeleteTextures(1, &e->tex); }
+        if (e->indexTex)   { glDeleteTextures(1, &e->indexTex); }
+        if (e->paletteTex) { glDeleteTextures(1, &e->paletteTex); }
+    }
+    ::free(static_cast<void*>(e->path));
+    ::free(e->pixels);
+    delete e;
+    m_entries.erase(m_entries.begin() + ptrdiff_t(index));
+}
+
+void TextureCache::removeAlias(size_t index) {
+    ::free(static_cast<void*>(m_aliases[index].path));
+    m_aliases.erase(m_aliases.begin() + ptrdiff_t(index));
+}
+
+void TextureCache::evict(size_t needBytes) {
+    // remove least recently used entries until the new texture fits into the
+    // budget; entries that are currently in use are never removed, so the
+    // budget may be exceeded if they are large
+    size_t total = totalBytes();
+    while ((total + needBytes) > m_maxBytes) {
+        size_t victim = m_entries.size();
+        for (size_t i = 0;  i < m_entries.size();  ++i) {
+            if (!m_entries[i]->refCount && ((victim >= m_entries.size()) || (m_entries[i]->lastUse < m_entries[victim]->lastUse))) {
+                victim = i;
+            }
+        }
+        if (victim >= m_entries.size()) { break; }
+        #ifndef NDEBUG
+            printf("texture cache: evicting '%s'\n", m_entries[victim]->path ? m_entries[victim]->path : "(anonymous)");
+        #endif
+        total -= m_entries[victim]->bytes();
+        remove(victim);
+    }
+}
+
+bool TextureCache::resolve(const Entry* e, GLuint target) {
+    // (lazily) create the shader that converts the indices into colors
+    if (!m_resolveProg.good()) {
+        GLutil::Shader vs(GL_VERTEX_SHADER,
+             "#version 330 core"
+        "\n" "void main() {"
+        "\n" "  vec2 pos = vec2(float(gl_VertexID & 1), float((gl_VertexID & 2) >> 1));"
+        "\n" "  gl_Position = vec4(pos * 2. - 1., 0., 1.);"
+        "\n" "}"
+        "\n");
+        GLutil::Shader fs(GL_FRAGMENT_SHADER,
+             "#version 330 core"
+        "\n" "uniform sampler2D uIndex;"
+        "\n" "uniform sampler2D uPalette;"
+        "\n" "out vec4 oColor;"
+        "\n" "void main() {"
+        "\n" "  int i = int(texelFetch(uIndex, ivec2(gl_FragCoord.xy), 0).r * 255. + .5);"
+        "\n" "  oColor = vec4(texelFetch(uPalette, ivec2(i, 0), 0).rgb, 1.);"
+        "\n" "}"
+        "\n");
+        if (!vs.good() || !fs.good() || !m_resolveProg.link(vs, fs) || !m_resolveFBO.init()) {
+            fprintf(stderr, "palette resolve shader creation failed\n");
+            return false;
+        }
+        glUseProgram(m_resolveProg);
+        glUniform1i(m_resolveProg.getUniformLocation("uIndex"),   0);
+        glUniform1i(m_resolveProg.getUniformLocation("uPalette"), 1);
+        glUseProgram(0);
+    }
+
+    // render into the displayable texture
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLutil::clearError();
+    bool ok = m_resolveFBO.begin(target);
+    if (ok) {
+        glViewport(0, 0, e->width, e->height);
+        m_resolveProg.use();
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, e->paletteTex);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, e->indexTex);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glUseProgram(0);
+    } else {
+        #ifndef NDEBUG
+            printf("texture cache: incomplete framebuffer (status 0x%04X)\n", m_resolveFBO.status);
+        #endif
+    }
+    m_resolveFBO.end();
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    // create mipmaps for the result
+    glBindTexture(GL_TEXTURE_2D, target);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return !GLutil::checkError("palette resolve") && ok;
+}
+
+bool TextureCache::updateMipmaps(Entry* e, std::vector<Rect> rects) {
+    // (lazily) create the shader that computes one texel of a mipmap level
+    // from a 2x2 block of the previous level, like glGenerateMipmap() does
+    if (!m_mipmapProg.good()) {
+        GLutil::Shader vs(GL_VERTEX_SHADER,
+             "#version 330 core"
+        "\n" "void main() {"
+        "\n" "  vec2 pos = vec2(float(gl_VertexID & 1), float((gl_VertexID & 2) >> 1));"
+        "\n" "  gl_Position = vec4(pos * 2. - 1., 0., 1.);"
+        "\n" "}"
+        "\n");
+        GLutil::Shader fs(GL_FRAGMENT_SHADER,
+             "#version 330 core"
+        "\n" "uniform sampler2D uTex;"
+        "\n" "out vec4 oColor;"
+        "\n" "void main() {"
+        "\n" "  ivec2 last = textureSize(uTex, 0) - 1;"
+        "\n" "  ivec2 p = min(ivec2(gl_FragCoord.xy) * 2, last);"
+        "\n" "  ivec2 q = min(p + 1, last);"
+        "\n" "  oColor = .25 * (texelFetch(uTex, p, 0) + texelFetch(uTex, ivec2(q.x, p.y), 0)"
+        "\n" "                + texelFetch(uTex, ivec2(p.x, q.y), 0) + texelFetch(uTex, q, 0));"
+        "\n" "}"
+        "\n");
+        if (!vs.good() || !fs.good() || !m_mipmapProg.link(vs, fs) || !m_resolveFBO.init()) {
+            fprintf(stderr, "mipmap shader creation failed\n");
+            return false;
+        }
+        glUseProgram(m_mipmapProg);
+        glUniform1i(m_mipmapProg.getUniformLocation("uTex"), 0);
+        glUseProgram(0);
+    }
+
+    // render each level from the previous one, restricted to the changed
+    // regions; the previous level is made the only accessible one while
+    // doing so, otherwise reading and writing the same texture would be
+    // a feedback loop
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLutil::clearError();
+    m_mipmapProg.use();
+    glBindTexture(GL_TEXTURE_2D, e->tex);
+    glEnable(GL_SCISSOR_TEST);
+    bool ok = true;
+    int w = e->width, h = e->height;
+    for (int level = 1;  ok && ((w > 1) || (h > 1));  ++level) {
+        w = std::max(w >> 1, 1);
+        h = std::max(h >> 1, 1);
+        for (Rect& r : rects) {
+            r.x0 = std::min(r.x0 >> 1, w - 1);
+            r.y0 = std::min(r.y0 >> 1, h - 1);
+            r.x1 = std::max(std::min((r.x1 + 1) >> 1, w), r.x0 + 1);
+            r.y1 = std::max(std::min((r.y1 + 1) >> 1, h), r.y0 + 1);
+        }
+        std::sort(rects.begin(), rects.end());
+        rects.erase(std::unique(rects.begin(), rects.end()), rects.end());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,  level - 1);
+        ok = m_resolveFBO.begin(e->tex, level);
+        if (!ok) {
+            #ifndef NDEBUG
+                printf("texture cache: incomplete framebuffer for mipmap level %d (status 0x%04X)\n", level, m_resolveFBO.status);
+            #endif
+            break;
+        }
+        glViewport(0, 0, w, h);
+        for (const Rect& r : rects) {
+            glScissor(r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+    }
+    m_resolveFBO.end();
+    glDisable(GL_SCISSOR_TEST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,  1000);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    return !GLutil::checkError("partial mipmap update") && ok;
+}
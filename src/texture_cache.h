@@ -0,0 +1,191 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include "gl_header.h"
+#include "gl_util.h"
+#include "file_util.h"
+#include "hash_util.h"
+#include "tex_compress.h"
+
+//! cache for image textures, so switching between recently used images
+//! (or displaying the same image twice) doesn't require decoding again
+class TextureCache {
+
+public:  // types
+
+    //! one cached texture
+    struct Entry {
+        char*    path   = nullptr;  //!< source file name (nullptr = not reusable)
+        FileUtil::FileFingerprint fp;  //!< source file fingerprint at the time of loading
+        uint32_t serial = 0;        //!< unique ID of the texture contents
+        GLuint   tex    = 0;        //!< OpenGL texture ID (0 for indexed images; use texture() to display)
+        GLuint   indexTex   = 0;    //!< R8 index texture of indexed images (0 = not indexed)
+        GLuint   paletteTex = 0;    //!< palette texture of indexed images
+        int      width  = 0;        //!< image width in pixels
+        int      height = 0;        //!< image height in pixels
+        HashUtil::Digest hash;      //!< content hash of the source file
+        size_t   fileSize = 0;      //!< size of the source file (0 = content unknown)
+        void*    pixels = nullptr;  //!< retained copy of the RGBA pixels for reload() (malloc'd)
+        size_t   compressedBytes = 0;  //!< size of a DXT1-compressed texture incl. mipmaps (0 = uncompressed)
+        double   encodeTime = 0.0;  //!< time spent compressing the texture in seconds (0 = loaded from the disk cache)
+        int      refCount = 0;      //!< number of users of the entry; referenced entries are never evicted
+        uint64_t lastUse  = 0;      //!< LRU timestamp
+        inline size_t uncompressedBytes() const  // RGBA8 + mipmaps, or R8 indices + palette
+            { return indexTex ? (size_t(width) * size_t(height) + 1024u) : (size_t(width) * size_t(height) * 16u / 3u); }
+        inline size_t bytes() const
+            { return compressedBytes ? compressedBytes : uncompressedBytes(); }
+    };
+
+public:  // methods
+
+    inline explicit TextureCache(size_t maxBytes=(size_t(256) << 20)) : m_maxBytes(maxBytes) {}
+    inline ~TextureCache() { clear(); }
+
+    //! look up an image file; returns nullptr if it's not in the cache,
+    //! or if the file has been modified since it has been cached. If the
+    //! file's current fingerprint is already known (e.g. from a directory
+    //! scan), it can be passed as `fp` to avoid querying it again.
+    Entry* find(const char* path, const FileUtil::FileFingerprint* fp=nullptr);
+
+    //! load a file into memory, computing its content hash while reading;
+    //! if `fp` is non-null, it receives the file's fingerprint, taken
+    //! *before* reading, so a modification during loading is never missed;
+    //! read timing and throughput are stored in `stats` if it's non-null
+    //! \returns a newly-malloc'd buffer (to be free()d by the caller),
+    //!          or nullptr if the file couldn't be read
+    static void* loadFile(const char* path, size_t &size, HashUtil::Digest &hash, FileUtil::FileFingerprint* fp=nullptr, FileUtil::ReadStats* stats=nullptr);
+
+    //! look up an entry by the content of its source file (as returned by
+    //! loadFile()); on success, `path` becomes an alias of the entry, so
+    //! future find() calls for that path will succeed too. The alias uses
+    //! the fingerprint `fp` from loadFile() if specified.
+    Entry* findContent(const char* path, const HashUtil::Digest& hash, size_t size, const FileUtil::FileFingerprint* fp=nullptr);
+
+    //! set the source file content key of an entry (as returned by loadFile());
+    //! if `fp` is specified, it replaces the fingerprint that add(),
+    //! addCompressed() or reload() took after decoding
+    inline void setContent(Entry* e, const HashUtil::Digest& hash, size_t size, const FileUtil::FileFingerprint* fp=nullptr)
+        { if (e) { e->hash = hash; e->fileSize = size; if (fp && e->path) { e->fp = *fp; } } }
+
+    //! upload a decoded RGBA (or BGRA) image into a new cache entry
+    //! \param path      source file name, or nullptr if the texture shall not
+    //!                  be reused by future find() calls (e.g. because it depends
+    //!                  on rendering options)
+    //! \returns the new entry (with a reference count of zero),
+    //!          or nullptr if the texture couldn't be created
+    Entry* add(const char* path, const void* data, int width, int height, bool bgra=false);
+
+    //! upload an 8-bit indexed image into a new cache entry; only the
+    //! indices and the palette are stored, so the palette can later be
+    //! changed with setPalette() without uploading the image again
+    //! \param palette  palette entries in BGRA byte order
+    Entry* addIndexed(const char* path, const uint8_t* data, int width, int height, const uint32_t* palette, int paletteSize);
+
+    //! get the displayable RGBA texture of an entry (with mipmaps); for
+    //! indexed entries, the palette is applied on the GPU into one of two
+    //! shared textures when needed, i.e. when the entry or its palette
+    //! changed since the last call. The result is only valid until the next
+    //! call for another indexed entry, so this shall be called every frame.
+    //! \returns the texture ID, or 0 on failure
+    GLuint texture(const Entry* e);
+
+    //! check whether DXT1-compressed textures are supported by the OpenGL
+    //! implementation (requires a valid OpenGL context)
+    bool canCompress();
+
+    //! upload a DXT1-compressed image (including its mipmaps) into a new
+    //! cache entry; same semantics as add() otherwise
+    Entry* addCompressed(const char* path, const TexCompress::Image& img);
+
+    //! change the palette of an indexed entry; this changes the serial number,
+    //! and the image is resolved again by the next texture() call.
+    //! Fails if the entry isn't indexed, or if it's used more than once (because
+    //! the other users expect the contents to stay the same).
+    bool setPalette(Entry* e, const uint32_t* palette, int paletteSize);
+
+    //! replace the contents of an anonymous, non-indexed entry with a new
+    //! version of the image that has the same width and the same or a larger
+    //! height (e.g. a progressively rendered canvas); only the rows
+    //! [firstRow, endRow) are uploaded, all others are assumed to be unchanged.
+    //! This changes the serial number. Fails if the entry isn't used by
+    //! exactly one user, or if the geometry doesn't match.
+    bool update(Entry* e, const void* data, int width, int height, int firstRow, int endRow, bool bgra=false);
+
+    //! keep the decoded RGBA pixels of an entry in memory (taking ownership
+    //! of the malloc'd buffer), so that the next reload() only needs to
+    //! upload what changed; to limit memory usage, only the most recently
+    //! retained entry keeps its pixels, all other copies are freed
+    void retain(Entry* e, void* pixels);
+
+    //! replace the contents of an entry with a new version of its source
+    //! file (e.g. after it has been saved again): the new RGBA pixels are
+    //! compared tile by tile against the retained copy, and only changed
+    //! tiles are uploaded and propagated into the mipmaps. The entry becomes
+    //! reachable under `path` again, and its serial number changes; other
+    //! paths that were aliased to it as duplicates are forgotten.
+    //! Fails if the entry isn't used by at most one user, has no retained
+    //! pixels, or if the size doesn't match. The retained copy is *not*
+    //! updated; use retain() with the new pixels afterwards.
+    bool reload(Entry* e, const char* path, const void* data, int width, int height);
+
+    //! reference counting
+    inline void acquire(Entry* e) { if (e) { e->refCount++; e->lastUse = ++m_useCounter; } }
+    void release(Entry* e);
+
+    //! remove all entries and free the textures; requires a valid OpenGL context
+    void clear();
+
+    //! statistics
+    inline int count() const { return int(m_entries.size()); }
+    size_t totalBytes() const;
+    inline int dedupHits() const { return m_dedupHits; }  //!< number of files that were found by content
+
+private:
+    //! additional file name for an entry, for files with identical content
+    struct Alias {
+        char* path;
+        FileUtil::FileFingerprint fp;
+        Entry* entry;
+    };
+    //! shared displayable texture for indexed entries
+    struct Scratch {
+        GLuint   tex = 0;
+        int      width = 0, height = 0;
+        const Entry* owner = nullptr;  //!< entry whose image is currently in the texture
+        uint32_t serial = 0;           //!< serial number of the owner at the time of resolving
+        uint64_t lastUse = 0;
+    };
+    std::vector<Entry*> m_entries;
+    std::vector<Alias> m_aliases;
+    Scratch m_scratch[2];  //!< enough for an indexed image and an indexed comparison image
+    int m_dedupHits = 0;
+    size_t m_maxBytes;
+    uint64_t m_useCounter = 0;
+    uint32_t m_serialCounter = 0;
+    int m_canCompress = -1;  //!< cached result of canCompress() (-1 = unknown)
+    GLutil::Program m_resolveProg;  //!< palette resolve shader
+    GLutil::Program m_mipmapProg;   //!< partial mipmap generation shader
+    GLutil::FBO m_resolveFBO;
+
+    //! rectangular part of a texture, [x0, x1) x [y0, y1)
+    struct Rect {
+        int x0, y0, x1, y1;
+        inline bool operator< (const Rect& o) const
+            { return (y0 != o.y0) ? (y0 < o.y0) : (x0 != o.x0) ? (x0 < o.x0) : (y1 != o.y1) ? (y1 < o.y1) : (x1 < o.x1); }
+        inline bool operator== (const Rect& o) const
+            { return (x0 == o.x0) && (y0 == o.y0) && (x1 == o.x1) && (y1 == o.y1); }
+    };
+
+    void remove(size_t index);
+    void removeAlias(size_t index);
+    void evict(size_t needBytes);
+    bool resolve(const Entry* e, GLuint target);
+    bool updateMipmaps(Entry* e, std::vector<Rect> rects);
+};
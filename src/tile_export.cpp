@@ -0,0 +1,362 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#ifdef _MSC_VER
+    #define _CRT_SECURE_NO_WARNINGS  // prevent MSVC warnings
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stb_image_write.h"
+
+#include "string_util.h"
+#include "file_util.h"
+
+#include "tile_export.h"
+
+namespace TileExport {
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: worker pool
+///////////////////////////////////////////////////////////////////////////////
+
+//! simple worker pool with a bounded queue; submit() blocks while the
+//! queue is full, which limits the amount of memory held by pending tiles
+class WorkerPool {
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_queue;
+    std::mutex m_mutex;
+    std::condition_variable m_cvWork;
+    std::condition_variable m_cvSpace;
+    size_t m_maxQueue;
+    int m_busy = 0;
+    bool m_quit = false;
+
+    void worker() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cvWork.wait(lock, [this] { return m_quit || !m_queue.empty(); });
+                if (m_queue.empty()) { return; }
+                task = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_busy++;
+            }
+            m_cvSpace.notify_all();
+            task();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_busy--;
+            }
+            m_cvSpace.notify_all();
+        }
+    }
+
+public:
+    WorkerPool(int threads, size_t maxQueue) : m_maxQueue(maxQueue) {
+        for (int i = 0;  i < threads;  ++i) {
+            m_threads.emplace_back([this] { worker(); });
+        }
+    }
+
+    //! finish all pending tasks and stop the worker threads
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_cvWork.notify_all();
+        for (auto& t : m_threads) { t.join(); }
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cvSpace.wait(lock, [this] { return m_queue.size() < m_maxQueue; });
+            m_queue.push_back(std::move(task));
+        }
+        m_cvWork.notify_one();
+    }
+
+    //! wait until all submitted tasks have been completed
+    void wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvSpace.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+    }
+};
+
+//! run a function for all values in [0, count) in parallel, split into
+//! contiguous ranges; small workloads are processed in the calling thread
+static void parallelFor(int count, int threads, int workPerItem, const std::function<void(int begin, int end)>& func) {
+    constexpr int minWorkPerThread = 65536;
+    int n = std::min(threads, std::max(1, int((int64_t(count) * workPerItem) / minWorkPerThread)));
+    n = std::min(n, count);
+    if (n <= 1) {
+        func(0, count);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (int i = 1;  i < n;  ++i) {
+        pool.emplace_back(func, int(int64_t(count) * i / n), int(int64_t(count) * (i + 1) / n));
+    }
+    func(0, count / n);
+    for (auto& t : pool) { t.join(); }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: pyramid builder
+///////////////////////////////////////////////////////////////////////////////
+
+//! Streaming pyramid builder: rows are pushed into the full-resolution
+//! level one strip at a time; whenever a level has accumulated a full row
+//! of tiles, the tiles are handed over to the worker pool, and pairs of
+//! rows are downsampled into the next level. So each level only ever holds
+//! one strip of tileSize rows, independent of the image height.
+class PyramidBuilder {
+    struct Level {
+        int width, height;
+        int name;                    //!< level number as used in the output paths
+        std::vector<uint8_t> strip;  //!< current strip (tileSize rows)
+        int stripRows = 0;           //!< number of valid rows in the strip
+        int stripY = 0;              //!< Y coordinate of the strip's first row
+        std::vector<uint8_t> carry;  //!< row waiting for its partner for downsampling
+        bool hasCarry = false;
+    };
+    const Options& m_opt;
+    std::string m_base;
+    std::vector<Level> m_levels;  //!< index 0 = full resolution
+    int m_threads;
+    std::atomic<int> m_tiles;
+    std::atomic<int> m_errors;
+    WorkerPool m_pool;  //!< must be declared last, so it's destroyed first
+
+public:
+    PyramidBuilder(const Options& opt, const char* base, int width, int height, int threads)
+        : m_opt(opt), m_base(base), m_threads(threads), m_tiles(0), m_errors(0), m_pool(threads, size_t(threads) * 4u)
+    {
+        // build the level list, from full resolution downwards; DZI goes down
+        // to 1x1 pixels, XYZ only until the image fits into a single tile
+        int w = width, h = height;
+        for (;;) {
+            Level l;
+            l.width = w;
+            l.height = h;
+            l.strip.resize(size_t(w) * size_t(opt.tileSize) * 4u);
+            l.carry.resize(size_t(w) * 4u);
+            m_levels.push_back(std::move(l));
+            if ((opt.layout == Layout::DZI) ? ((w <= 1) && (h <= 1)) : ((w <= opt.tileSize) && (h <= opt.tileSize))) { break; }
+            w = (w + 1) >> 1;
+            h = (h + 1) >> 1;
+        }
+        int n = int(m_levels.size());
+        for (int i = 0;  i < n;  ++i) { m_levels[size_t(i)].name = n - 1 - i; }
+    }
+
+    inline int numLevels() const { return int(m_levels.size()); }
+    inline int tiles()  const { return m_tiles; }
+    inline int errors() const { return m_errors; }
+    inline void wait() { m_pool.wait(); }
+
+    //! create the output directories
+    bool makeDirectories() {
+        char path[32];
+        bool ok = FileUtil::makeDirectory(m_base.c_str());
+        for (const auto& l : m_levels) {
+            snprintf(path, sizeof(path), "/%d", l.name);
+            std::string dir = m_base + path;
+            ok = ok && FileUtil::makeDirectory(dir.c_str());
+            if (m_opt.layout == Layout::XYZ) {
+                int cols = (l.width + m_opt.tileSize - 1) / m_opt.tileSize;
+                for (int x = 0;  ok && (x < cols);  ++x) {
+                    snprintf(path, sizeof(path), "/%d", x);
+                    ok = FileUtil::makeDirectory((dir + path).c_str());
+                }
+            }
+        }
+        return ok;
+    }
+
+    //! push a number of consecutive rows into a level
+    void pushRows(int li, const uint8_t* rows, int count) {
+        Level& l = m_levels[size_t(li)];
+        size_t rowBytes = size_t(l.width) * 4u;
+
+        // append the rows to the strip, emitting tiles whenever it's full
+        for (int done = 0;  done < count;) {
+            int n = std::min(count - done, m_opt.tileSize - l.stripRows);
+            memcpy(&l.strip[size_t(l.stripRows) * rowBytes], &rows[size_t(done) * rowBytes], size_t(n) * rowBytes);
+            l.stripRows += n;
+            done += n;
+            if (l.stripRows >= m_opt.tileSize) { flushStrip(li); }
+        }
+
+        // downsample pairs of rows into the next level
+        if ((li + 1) >= numLevels()) { return; }
+        std::vector<const uint8_t*> src;
+        src.reserve(size_t(count) + 1u);
+        if (l.hasCarry) { src.push_back(l.carry.data()); }
+        for (int y = 0;  y < count;  ++y) { src.push_back(&rows[size_t(y) * rowBytes]); }
+        l.hasCarry = (src.size() & 1u);
+        if (l.hasCarry) {
+            memcpy(l.carry.data(), src.back(), rowBytes);
+            src.pop_back();
+        }
+        downsample(li, src);
+    }
+
+    //! flush all remaining data
+    void finish() {
+        for (int li = 0;  li < numLevels();  ++li) {
+            Level& l = m_levels[size_t(li)];
+            if (l.stripRows > 0) { flushStrip(li); }
+            if (l.hasCarry && ((li + 1) < numLevels())) {
+                // odd number of rows: the last row is paired with itself
+                std::vector<const uint8_t*> src(2, l.carry.data());
+                l.hasCarry = false;
+                downsample(li, src);
+            }
+        }
+    }
+
+private:
+    void downsample(int li, const std::vector<const uint8_t*>& src) {
+        int outRows = int(src.size() / 2u);
+        if (!outRows) { return; }
+        int w = m_levels[size_t(li)].width;
+        int ow = m_levels[size_t(li) + 1u].width;
+        std::vector<uint8_t> out(size_t(ow) * size_t(outRows) * 4u);
+        parallelFor(ow, m_threads, outRows * 16, [&] (int x0, int x1) {
+            for (int y = 0;  y < outRows;  ++y) {
+                const uint8_t* r0 = src[size_t(y) * 2u];
+                const uint8_t* r1 = src[size_t(y) * 2u + 1u];
+                uint8_t* o = &out[(size_t(y) * size_t(ow) + size_t(x0)) * 4u];
+                for (int x = x0;  x < x1;  ++x) {
+                    size_t a = size_t(x) * 8u;
+                    size_t b = (((x * 2) + 1) < w) ? (a + 4u) : a;
+                    for (int c = 0;  c < 4;  ++c) {
+                        *o++ = uint8_t((r0[a + size_t(c)] + r0[b + size_t(c)] + r1[a + size_t(c)] + r1[b + size_t(c)] + 2) >> 2);
+                    }
+                }
+            }
+        });
+        pushRows(li + 1, out.data(), outRows);
+    }
+
+    void flushStrip(int li) {
+        Level& l = m_levels[size_t(li)];
+        int ts = m_opt.tileSize;
+        bool pad = (m_opt.layout == Layout::XYZ);
+        int row = l.stripY / ts;
+        for (int x0 = 0;  x0 < l.width;  x0 += ts) {
+            int tw = std::min(ts, l.width - x0);
+            int th = l.stripRows;
+            int bw = pad ? ts : tw;
+            int bh = pad ? ts : th;
+
+            // copy the tile out of the strip, as the strip will be overwritten
+            // while the tile is still waiting to be written
+            std::vector<uint8_t> tile(size_t(bw) * size_t(bh) * 4u, 0);
+            for (int y = 0;  y < th;  ++y) {
+                memcpy(&tile[size_t(y) * size_t(bw) * 4u], &l.strip[(size_t(y) * size_t(l.width) + size_t(x0)) * 4u], size_t(tw) * 4u);
+            }
+
+            char name[64];
+            if (pad) {
+                snprintf(name, sizeof(name), "/%d/%d/%d.%s", l.name, x0 / ts, row, m_opt.jpeg ? "jpg" : "png");
+            } else {
+                snprintf(name, sizeof(name), "/%d/%d_%d.%s", l.name, x0 / ts, row, m_opt.jpeg ? "jpg" : "png");
+            }
+            std::string path = m_base + name;
+            bool jpeg = m_opt.jpeg;
+            int quality = m_opt.quality;
+            auto data = std::make_shared<std::vector<uint8_t>>(std::move(tile));
+            m_pool.submit([this, path, data, bw, bh, jpeg, quality] () {
+                int res = jpeg ? stbi_write_jpg(path.c_str(), bw, bh, 4, data->data(), quality)
+                               : stbi_write_png(path.c_str(), bw, bh, 4, data->data(), bw * 4);
+                if (res) {
+                    m_tiles++;
+                } else {
+                    #ifndef NDEBUG
+                        printf("tile export: failed to write '%s'\n", path.c_str());
+                    #endif
+                    m_errors++;
+                }
+            });
+        }
+        l.stripY += l.stripRows;
+        l.stripRows = 0;
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MARK: main API
+///////////////////////////////////////////////////////////////////////////////
+
+Layout layoutFromPath(const char* path) {
+    return (StringUtil::extractExtCode(path) == StringUtil::makeExtCode("dzi")) ? Layout::DZI : Layout::XYZ;
+}
+
+bool exportPyramid(const uint8_t* rgba, int width, int height, const char* outPath, const Options& opt, Stats& stats) {
+    stats = Stats();
+    if (!rgba || (width < 1) || (height < 1) || !outPath || !outPath[0] || (opt.tileSize < 1)) { return false; }
+    auto t0 = std::chrono::steady_clock::now();
+    int threads = (opt.threads > 0) ? opt.threads : std::max(1, int(std::thread::hardware_concurrency()));
+
+    // determine the base directory and write the descriptor file
+    std::string base(outPath);
+    if (opt.layout == Layout::DZI) {
+        base.resize(base.size() - 4u);  // remove ".dzi"
+        base += "_files";
+        FILE* f = fopen(outPath, "w");
+        if (!f) { return false; }
+        fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"%s\" Overlap=\"0\" TileSize=\"%d\">\n"
+                   "  <Size Width=\"%d\" Height=\"%d\"/>\n"
+                   "</Image>\n", opt.jpeg ? "jpg" : "png", opt.tileSize, width, height);
+        bool ok = !ferror(f);
+        if (fclose(f) || !ok) { return false; }
+    }
+
+    {
+        PyramidBuilder pb(opt, base.c_str(), width, height, threads);
+        stats.levels = pb.numLevels();
+        if (!pb.makeDirectories()) {
+            #ifndef NDEBUG
+                printf("tile export: failed to create output directories\n");
+            #endif
+            return false;
+        }
+        // feed the source image in strips, so the downsampling and tile
+        // writing of one strip overlaps with the next one
+        size_t rowBytes = size_t(width) * 4u;
+        for (int y = 0;  y < height;  y += opt.tileSize) {
+            pb.pushRows(0, &rgba[size_t(y) * rowBytes], std::min(opt.tileSize, height - y));
+        }
+        pb.finish();
+        pb.wait();
+        stats.tiles  = pb.tiles();
+        stats.errors = pb.errors();
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return !stats.errors;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+}  // namespace TileExport
@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+
+namespace TileExport {
+
+///////////////////////////////////////////////////////////////////////////////
+
+//! tile pyramid layout
+enum class Layout {
+    DZI,  //!< Deep Zoom Image: NAME.dzi + NAME_files/LEVEL/COL_ROW.EXT
+    XYZ,  //!< "slippy map" directory: DIR/Z/X/Y.EXT, all tiles padded to full size
+};
+
+//! export options
+struct Options {
+    Layout layout   = Layout::DZI;
+    int  tileSize   = 256;    //!< tile width and height in pixels
+    bool jpeg       = false;  //!< write JPEG tiles instead of PNG
+    int  quality    = 90;     //!< JPEG quality
+    int  threads    = 0;      //!< number of worker threads (0 = auto)
+};
+
+//! export statistics
+struct Stats {
+    int levels = 0;     //!< number of pyramid levels
+    int tiles  = 0;     //!< number of tiles written
+    int errors = 0;     //!< number of tiles that couldn't be written
+    double seconds = 0.0;
+};
+
+//! guess the layout from the output path: "*.dzi" = DZI, anything else = XYZ
+Layout layoutFromPath(const char* path);
+
+//! export an RGBA image as a tile pyramid
+//! \param rgba    image data (4 bytes per pixel, no padding between rows)
+//! \param outPath output path; for DZI, the .dzi file name,
+//!                for XYZ, the output directory
+//! \returns true if all tiles have been written successfully
+bool exportPyramid(const uint8_t* rgba, int width, int height, const char* outPath, const Options& opt, Stats& stats);
+
+///////////////////////////////////////////////////////////////////////////////
+
+}  // namespace TileExport
@@ -0,0 +1,212 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <chrono>
+
+#include "string_util.h"
+#include "file_util.h"
+
+#include "tree_walker.h"
+
+// maximum directory nesting depth; symlink loops are caught by keeping
+// track of the directories that have been visited, this is just a backstop
+static constexpr int maxTreeDepth = 32;
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool TreeWalker::start(const char* root, FilterFunc filter) {
+    stop();
+    if (!root || !filter) { return false; }
+    m_root = root;
+    m_filter = filter;
+    m_cancel = false;
+    m_done = false;
+    m_hint = 0;
+    m_lookup.clear();
+    m_lookupPos = 0;
+    m_thread = std::thread([this] { worker(); });
+    #ifndef NDEBUG
+        printf("tree walker: started scanning '%s'\n", root);
+    #endif
+    return true;
+}
+
+void TreeWalker::stop() {
+    if (m_thread.joinable()) {
+        m_cancel = true;
+        m_thread.join();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_files.clear();
+    m_done = false;
+    m_lookup.clear();
+    m_lookupPos = 0;
+}
+
+bool TreeWalker::contains(const char* path) const {
+    if (!path || !active()) { return false; }
+    if (m_root.empty()) { return !StringUtil::isAbsPath(path); }
+    size_t len = m_root.size();
+    return !strncmp(path, m_root.c_str(), len)
+        && (StringUtil::ispathsep(path[len]) || StringUtil::ispathsep(m_root[len - 1u]));
+}
+
+int TreeWalker::count() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return int(m_files.size());
+}
+
+bool TreeWalker::done() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_done;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TreeWalker::FindResult TreeWalker::find(const char* current, bool absolute, int order, char* &path) {
+    path = nullptr;
+    if (!active() || (!absolute && !contains(current))) { return FindResult::NotFound; }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t index = 0;
+    if (absolute) {
+        // first file: wait for the first entry; last file: wait for the end
+        if (!m_done && ((order >= 0) || m_files.empty())) { return FindResult::Pending; }
+        if (m_files.empty()) { return FindResult::NotFound; }
+        index = (order < 0) ? 0 : (m_files.size() - 1u);
+    } else {
+        // wait until the current file has been indexed; for the next file,
+        // also wait until its successor is known
+        if (!findIndex(current, index)) { return m_done ? FindResult::NotFound : FindResult::Pending; }
+        if (order < 0) {
+            if (!index) { return FindResult::NotFound; }
+            --index;
+        } else {
+            if ((index + 1u) >= m_files.size()) { return m_done ? FindResult::NotFound : FindResult::Pending; }
+            ++index;
+        }
+    }
+    m_hint = index;
+    path = StringUtil::copy(m_files[index].path.c_str());
+    return path ? FindResult::Found : FindResult::NotFound;
+}
+
+bool TreeWalker::fingerprint(const char* path, FileUtil::FileFingerprint& fp) {
+    if (!path || !active()) { return false; }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t index = 0;
+    if (!findIndex(path, index)) { return false; }
+    fp = m_files[index].fp;
+    return fp.good();
+}
+
+void TreeWalker::setFingerprint(const char* path, const FileUtil::FileFingerprint& fp) {
+    if (!path || !active()) { return; }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t index = 0;
+    if (findIndex(path, index)) { m_files[index].fp = fp; }
+}
+
+bool TreeWalker::findIndex(const char* path, size_t& index) {
+    // the requested file is usually next to the previous one, so try there first
+    for (size_t i = std::max(m_hint, size_t(1)) - 1u;  i < std::min(m_hint + 2u, m_files.size());  ++i) {
+        if (m_files[i].path == path) { index = i; return true; }
+    }
+    // while the lookup is repeated for a file that hasn't been indexed yet,
+    // only the files that have been added since the last attempt are checked
+    size_t start = (m_lookup == path) ? m_lookupPos : 0u;
+    for (size_t i = start;  i < m_files.size();  ++i) {
+        if (m_files[i].path == path) { index = i; return true; }
+    }
+    m_lookup = path;
+    m_lookupPos = m_files.size();
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+void TreeWalker::worker() {
+    #ifndef NDEBUG
+        auto t0 = std::chrono::steady_clock::now();
+    #endif
+    m_visited.clear();
+    scan(m_root, 0);
+    m_visited.clear();
+    #ifndef NDEBUG
+        printf("tree walker: %s, %d files found in %.1f ms\n", m_cancel ? "cancelled" : "finished", count(),
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    #endif
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_done = true;
+}
+
+void TreeWalker::scan(const std::string& dirName, int depth) {
+    if (m_cancel || (depth > maxTreeDepth)) { return; }
+
+    // a directory that can be reached via several paths (symlinks to
+    // itself, to a parent, or to a sibling) is only scanned once
+    FileUtil::FileID id;
+    if (FileUtil::getFileID(dirName.empty() ? "." : dirName.c_str(), id) && !m_visited.insert(id).second) {
+        #ifndef NDEBUG
+            printf("tree walker: skipping '%s', already visited\n", dirName.c_str());
+        #endif
+        return;
+    }
+    FileUtil::Directory dir(dirName.empty() ? "." : dirName.c_str());
+    if (!dir.good()) { return; }
+
+    auto join = [&] (const char* name) -> std::string {
+        char* path = StringUtil::pathJoin(dirName.c_str(), name);
+        std::string res(path ? path : "");
+        ::free(path);
+        return res;
+    };
+
+    // collect the directory's items and query their types in a single batch;
+    // for directories with many thousands of files, individual stat() calls
+    // would dominate the scanning time
+    std::vector<std::string> items;
+    while (!m_cancel && dir.nextNonDot()) {
+        items.push_back(join(dir.currentItemName()));
+    }
+    dir.close();
+    if (m_cancel) { return; }
+    std::vector<const char*> paths(items.size());
+    std::vector<FileUtil::FileInfo> info(items.size());
+    for (size_t i = 0;  i < items.size();  ++i) { paths[i] = items[i].c_str(); }
+    FileUtil::statFiles(paths.data(), int(items.size()), info.data());
+
+    // sort the items into files (keeping their fingerprints) and subdirectories
+    std::vector<Item> files;
+    std::vector<std::string> subdirs;
+    for (size_t i = 0;  i < items.size();  ++i) {
+        if (!info[i].exists) { continue; }
+        if (info[i].isDir) {
+            subdirs.push_back(std::move(items[i]));
+        } else if (m_filter(StringUtil::pathBaseName(paths[i]))) {
+            Item item;
+            item.path = std::move(items[i]);
+            item.fp = info[i].fp;
+            files.push_back(std::move(item));
+        }
+    }
+    std::sort(files.begin(), files.end(), [] (const Item& a, const Item& b) {
+        return StringUtil::compareCI(a.path.c_str(), b.path.c_str()) < 0;
+    });
+    std::sort(subdirs.begin(), subdirs.end(), [] (const std::string& a, const std::string& b) {
+        return StringUtil::compareCI(a.c_str(), b.c_str()) < 0;
+    });
+
+    // publish the files, then descend into the subdirectories
+    if (!files.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& f : files) { m_files.push_back(std::move(f)); }
+    }
+    for (const auto& d : subdirs) {
+        scan(d, depth + 1);
+    }
+}
@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_util.h"
+
+//! background scanner for a directory tree; builds a flat list of all files
+//! in depth-first order (files of a directory first, then its subdirectories,
+//! both sorted case-insensitively), so navigation can cross directory
+//! boundaries as quickly as moving within a directory. The fingerprints of
+//! all files are recorded too, so cache lookups don't need to query them again.
+class TreeWalker {
+public:
+    //! filter function: returns true if a file (name only, no path) shall be listed
+    typedef bool (*FilterFunc)(const char* name);
+
+    //! result of find()
+    enum class FindResult {
+        Found,     //!< the file has been found
+        NotFound,  //!< there's no such file
+        Pending,   //!< the scanner hasn't got there yet; try again later
+    };
+
+    inline TreeWalker() {}
+    inline ~TreeWalker() { stop(); }
+
+    //! start scanning a directory tree in the background
+    bool start(const char* root, FilterFunc filter);
+
+    //! stop scanning and clear the file list
+    void stop();
+
+    inline bool active() const { return m_thread.joinable(); }
+    inline const char* root() const { return m_root.c_str(); }
+
+    //! check whether a path is located inside the scanned tree
+    bool contains(const char* path) const;
+
+    //! find a file relative to another one, with the same semantics as
+    //! PixelViewApp::loadSibling(); this never blocks: if the requested
+    //! item (or `current` itself) hasn't been indexed yet, Pending is
+    //! returned, and the call shall be repeated later (e.g. in the next frame)
+    //! \param path  receives a newly-malloc'd path (to be free()d by the
+    //!              caller) if the result is Found, nullptr otherwise
+    FindResult find(const char* current, bool absolute, int order, char* &path);
+
+    //! get the fingerprint of a file in the tree, as recorded by the scan
+    //! or the last setFingerprint() call; modifications after that time
+    //! are *not* reflected
+    //! \returns false if the file hasn't been indexed (yet)
+    bool fingerprint(const char* path, FileUtil::FileFingerprint& fp);
+
+    //! update the recorded fingerprint of a file (e.g. after loading it)
+    void setFingerprint(const char* path, const FileUtil::FileFingerprint& fp);
+
+    //! statistics
+    int count();
+    bool done();
+
+private:
+    std::thread m_thread;
+    struct Item {
+        std::string path;
+        FileUtil::FileFingerprint fp;
+    };
+    std::mutex m_mutex;
+    std::vector<Item> m_files;         //!< protected by m_mutex
+    bool m_done = false;               //!< protected by m_mutex
+    std::atomic<bool> m_cancel;
+    std::string m_root;
+    FilterFunc m_filter = nullptr;
+    size_t m_hint = 0;  //!< index of the most recently found file
+    std::string m_lookup;    //!< path that findIndex() couldn't find yet
+    size_t m_lookupPos = 0;  //!< number of files that have already been compared against m_lookup
+
+    std::set<FileUtil::FileID> m_visited;  //!< directories scanned so far (owned by the worker thread)
+
+    void worker();
+    void scan(const std::string& dir, int depth);
+    bool findIndex(const char* path, size_t& index);
+};
@@ -0,0 +1,247 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include "gl_header.h"
+#include "gl_util.h"
+
+#include "upscaler.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+// filter descriptions: names and the scaling factors of the individual passes
+struct FilterDesc {
+    const char* name;
+    const char* id;
+    int passes[3];  // zero-terminated
+};
+static const FilterDesc filters[Upscaler::numFilters] = {
+    { "none",    "none",    { 0 } },
+    { "Scale2x", "scale2x", { 2, 0 } },
+    { "Scale3x", "scale3x", { 3, 0 } },
+    { "Scale4x", "scale4x", { 2, 2, 0 } },
+};
+
+static inline const FilterDesc& getDesc(Upscaler::Filter filter) {
+    int i = int(filter);
+    return filters[((i >= 0) && (i < Upscaler::numFilters)) ? i : 0];
+}
+
+const char* Upscaler::filterName(Filter filter) {
+    return getDesc(filter).name;
+}
+
+const char* Upscaler::filterID(Filter filter) {
+    return getDesc(filter).id;
+}
+
+bool Upscaler::filterFromID(const char* id, Filter &filter) {
+    if (!id) { return false; }
+    for (int i = 0;  i < numFilters;  ++i) {
+        if (!strcmp(id, filters[i].id)) {
+            filter = Filter(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+int Upscaler::scaleFactor(Filter filter) {
+    int factor = 1;
+    for (const int* p = getDesc(filter).passes;  *p;  ++p) { factor *= *p; }
+    return factor;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+bool Upscaler::init() {
+    if (m_prog.good()) { return true; }
+    GLutil::Shader vs(GL_VERTEX_SHADER,
+         "#version 330 core"
+    "\n" "void main() {"
+    "\n" "  vec2 pos = vec2(float(gl_VertexID & 1), float((gl_VertexID & 2) >> 1));"
+    "\n" "  gl_Position = vec4(pos * 2. - 1., 0., 1.);"
+    "\n" "}"
+    "\n");
+    if (!vs.good()) {
+        fprintf(stderr, "upscaler vertex shader compilation failed\n");
+        return false;
+    }
+    // AdvMAME2x/3x (a.k.a. Scale2x/3x); each output pixel determines its
+    // position inside the block of output pixels generated from one source
+    // pixel, then applies the corresponding rule to the 3x3 neighborhood
+    GLutil::Shader fs(GL_FRAGMENT_SHADER,
+         "#version 330 core"
+    "\n" "uniform sampler2D uTex;"
+    "\n" "uniform int uFactor;"
+    "\n" "out vec4 oColor;"
+    "\n" "vec4 px(in ivec2 p) {"
+    "\n" "  return texelFetch(uTex, clamp(p, ivec2(0), textureSize(uTex, 0) - 1), 0);"
+    "\n" "}"
+    "\n" "void main() {"
+    "\n" "  ivec2 o = ivec2(gl_FragCoord.xy);"
+    "\n" "  ivec2 p = o / uFactor;"
+    "\n" "  ivec2 s = o - p * uFactor;"
+    "\n" "  vec4 A = px(p + ivec2(-1,-1)), B = px(p + ivec2(0,-1)), C = px(p + ivec2(1,-1));"
+    "\n" "  vec4 D = px(p + ivec2(-1, 0)), E = px(p),               F = px(p + ivec2(1, 0));"
+    "\n" "  vec4 G = px(p + ivec2(-1, 1)), H = px(p + ivec2(0, 1)), I = px(p + ivec2(1, 1));"
+    "\n" "  bool db = (D == B) && (B != F) && (D != H);"
+    "\n" "  bool bf = (B == F) && (B != D) && (F != H);"
+    "\n" "  bool dh = (D == H) && (D != B) && (H != F);"
+    "\n" "  bool hf = (H == F) && (D != H) && (B != F);"
+    "\n" "  vec4 c = E;"
+    "\n" "  if (uFactor == 2) {"
+    "\n" "    int i = s.y * 2 + s.x;"
+    "\n" "    if      (i == 0) { if (db) { c = D; } }"
+    "\n" "    else if (i == 1) { if (bf) { c = F; } }"
+    "\n" "    else if (i == 2) { if (dh) { c = D; } }"
+    "\n" "    else             { if (hf) { c = F; } }"
+    "\n" "  } else {"
+    "\n" "    int i = s.y * 3 + s.x;"
+    "\n" "    if      (i == 0) { if (db) { c = D; } }"
+    "\n" "    else if (i == 1) { if ((db && (E != C)) || (bf && (E != A))) { c = B; } }"
+    "\n" "    else if (i == 2) { if (bf) { c = F; } }"
+    "\n" "    else if (i == 3) { if ((db && (E != G)) || (dh && (E != A))) { c = D; } }"
+    "\n" "    else if (i == 5) { if ((bf && (E != I)) || (hf && (E != C))) { c = F; } }"
+    "\n" "    else if (i == 6) { if (dh) { c = D; } }"
+    "\n" "    else if (i == 7) { if ((dh && (E != I)) || (hf && (E != G))) { c = H; } }"
+    "\n" "    else if (i == 8) { if (hf) { c = F; } }"
+    "\n" "  }"
+    "\n" "  oColor = c;"
+    "\n" "}"
+    "\n");
+    if (!fs.good()) {
+        fprintf(stderr, "upscaler fragment shader compilation failed\n");
+        return false;
+    }
+    m_prog.link(vs, fs);
+    if (!m_prog.good()) {
+        fprintf(stderr, "upscaler program linking failed\n");
+        return false;
+    }
+    m_locFactor = m_prog.getUniformLocation("uFactor");
+    return m_fbo.init();
+}
+
+void Upscaler::free() {
+    if (GLutil::initialized) {
+        for (int i = 0;  i < 2;  ++i) {
+            if (m_tex[i]) { glDeleteTextures(1, &m_tex[i]); }
+        }
+    }
+    m_tex[0] = m_tex[1] = 0;
+    m_fbo.free();
+    m_prog.free();
+    m_valid = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+GLuint Upscaler::get(GLuint srcTex, uint32_t serial, Filter filter, int &width, int &height) {
+    if ((filter == Filter::None) || !m_prog.good()) { return srcTex; }
+    if (!m_valid || (serial != m_serial) || (filter != m_filter) || (width != m_srcWidth) || (height != m_srcHeight)) {
+        // source or filter changed -> render a new version
+        m_valid     = true;
+        m_serial    = serial;
+        m_filter    = filter;
+        m_srcWidth  = width;
+        m_srcHeight = height;
+        m_failed    = !run(srcTex, filter, width, height);
+    }
+    if (m_failed) { return srcTex; }
+    width  = m_dstWidth;
+    height = m_dstHeight;
+    return m_tex[0];
+}
+
+bool Upscaler::run(GLuint srcTex, Filter filter, int width, int height) {
+    const int* passes = getDesc(filter).passes;
+    int numPasses = 0;
+    while (passes[numPasses]) { ++numPasses; }
+    int factor = scaleFactor(filter);
+    int maxTexSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
+    if ((width < 1) || (height < 1) || ((width * factor) > maxTexSize) || ((height * factor) > maxTexSize)) {
+        #ifndef NDEBUG
+            printf("upscaler: %dx%d image can't be upscaled by %dx, texture would be too large\n", width, height, factor);
+        #endif
+        return false;
+    }
+    #ifndef NDEBUG
+        double t0 = glfwGetTime();
+    #endif
+
+    // save the state we're going to mess with
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    // run the passes; the final pass always renders into m_tex[0], so
+    // for an even number of passes, start with the intermediate texture
+    GLutil::clearError();
+    m_prog.use();
+    GLuint src = srcTex;
+    int dst = (numPasses & 1) ^ 1;
+    bool ok = true;
+    for (int i = 0;  ok && (i < numPasses);  ++i) {
+        if (!m_tex[dst]) {
+            glGenTextures(1, &m_tex[dst]);
+        }
+        ok = runPass(src, m_tex[dst], passes[i], width, height);
+        src = m_tex[dst];
+        dst ^= 1;
+        width  *= passes[i];
+        height *= passes[i];
+    }
+    m_fbo.end();
+    glUseProgram(0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    // create mipmaps for the final result
+    if (ok) {
+        glBindTexture(GL_TEXTURE_2D, m_tex[0]);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        ok = !GLutil::checkError("upscaler mipmap generation");
+    }
+    if (ok) {
+        m_dstWidth  = width;
+        m_dstHeight = height;
+    }
+    #ifndef NDEBUG
+        printf("upscaler: %s %s -> %dx%d in %.1f ms\n", filterName(filter), ok ? "OK" : "FAILED", width, height, (glfwGetTime() - t0) * 1000.0);
+    #endif
+    return ok;
+}
+
+bool Upscaler::runPass(GLuint srcTex, GLuint dstTex, int factor, int width, int height) {
+    // allocate the target texture
+    width  *= factor;
+    height *= factor;
+    glBindTexture(GL_TEXTURE_2D, dstTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (GLutil::checkError("upscaler texture allocation")) { return false; }
+
+    // render into it
+    if (!m_fbo.begin(dstTex)) {
+        #ifndef NDEBUG
+            printf("upscaler: incomplete framebuffer (status 0x%04X)\n", m_fbo.status);
+        #endif
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    glBindTexture(GL_TEXTURE_2D, srcTex);
+    glUniform1i(m_locFactor, factor);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return !GLutil::checkError("upscaler pass");
+}
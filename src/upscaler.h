@@ -0,0 +1,76 @@
+// SPDX-FileCopyrightText: 2024 Martin J. Fiedler <keyj@emphy.de>
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+#include <cstdint>
+
+#include "gl_header.h"
+#include "gl_util.h"
+
+//! GPU pixel-art upscaler; renders the upscaled image once into a cached
+//! texture, so the per-frame cost doesn't depend on the filter complexity
+class Upscaler {
+
+public:  // types
+
+    //! available upscaling filters
+    enum class Filter : uint8_t {
+        None = 0,  //!< no upscaling, display the original image
+        Scale2x,   //!< Scale2x / AdvMAME2x
+        Scale3x,   //!< Scale3x / AdvMAME3x
+        Scale4x,   //!< Scale2x, applied twice
+    };
+    static constexpr int numFilters = 4;
+
+public:  // methods
+
+    inline Upscaler() = default;
+    inline ~Upscaler() { free(); }
+
+    //! get a filter's human-readable name
+    static const char* filterName(Filter filter);
+
+    //! get a filter's name as used in configuration files
+    static const char* filterID(Filter filter);
+
+    //! look up a filter by its configuration file name; return false if not found
+    static bool filterFromID(const char* id, Filter &filter);
+
+    //! get a filter's overall scaling factor
+    static int scaleFactor(Filter filter);
+
+    //! compile the shaders; must be called with a valid OpenGL context
+    bool init();
+
+    //! free all OpenGL resources
+    void free();
+
+    //! forget the cached result (e.g. because the source texture changed)
+    inline void invalidate() { m_valid = false; }
+
+    //! get the texture to display for a source image, running the filter
+    //! if the source or filter changed since the last call; the source is
+    //! identified by a serial number that shall change whenever its contents
+    //! change. If upscaling isn't possible, the source texture is returned.
+    //! \param width  [in/out] width of the source image / returned texture
+    //! \param height [in/out] height of the source image / returned texture
+    GLuint get(GLuint srcTex, uint32_t serial, Filter filter, int &width, int &height);
+
+private:
+    GLutil::Program m_prog;
+    GLint m_locFactor = -1;
+    GLutil::FBO m_fbo;
+    GLuint m_tex[2] = { 0, 0 };  //!< result texture and intermediate texture for multi-pass filters
+
+    // cache state
+    bool m_valid = false;   //!< the following fields describe the cached result
+    bool m_failed = false;  //!< upscaling failed for this source/filter combination
+    uint32_t m_serial = 0;
+    Filter m_filter = Filter::None;
+    int m_srcWidth = 0, m_srcHeight = 0;
+    int m_dstWidth = 0, m_dstHeight = 0;
+
+    bool run(GLuint srcTex, Filter filter, int width, int height);
+    bool runPass(GLuint srcTex, GLuint dstTex, int factor, int width, int height);
+};